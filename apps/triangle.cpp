@@ -26,60 +26,6 @@ struct screen_render
    fluffy::render::vertice_2d V2{};
 };
 
-//-----------------------------------------------------------------------------
-auto Fillrender(SDL_Surface* screenSurface,            //!<
-                fluffy::render::vertice_2d const& V0,  //!<
-                fluffy::render::vertice_2d const& V1,  //!<
-                fluffy::render::vertice_2d const& V2,  //!<
-                Uint32 Color,                          //!<
-                bool UseColorGradient                  //!<
-                )                                      //!<
-    -> void
-{
-   auto BB = fluffy::render::BoundingBox(V0, V1, V2);
-   // Draw on the surface
-   for (int Y = BB.Min.Y; Y < BB.Max.Y; ++Y)
-   {
-      bool InsideDetected{};
-
-      for (int X = BB.Min.X; X < BB.Max.X; ++X)
-      {
-         auto AreaParallelPiped = fluffy::render::EdgeCross(V0, V1, V2);
-         if (AreaParallelPiped <= fluffy::math3d::EPSILON) continue;  // dont want to divide by Zero.
-
-         fluffy::render::vertice_2d const P{static_cast<fluffy::math3d::FLOAT>(X),
-                                            static_cast<fluffy::math3d::FLOAT>(Y)};
-
-         /** Find cross products between the edges and the point P. These are the Barycentric weights. */
-         auto const W0 = fluffy::render::EdgeCross(V1, V2, P);
-         auto const W1 = fluffy::render::EdgeCross(V0, V1, P);
-         auto const W2 = fluffy::render::EdgeCross(V2, V0, P);
-
-         /** Compute the Barycentric coordinates */
-         auto const Alfa = W0 / AreaParallelPiped;
-         auto const Beta = W1 / AreaParallelPiped;
-         auto const Gamma = W2 / AreaParallelPiped;
-
-         // if (fluffy::render::Isinside(P, V0, V1, V2))
-         if (W0 >= 0 && W1 >= 0 && W2 >= 0)  // then point is on the inside
-         {
-            InsideDetected = true;
-            if (UseColorGradient)
-               Color = uint8_t(Alfa * 0xFF) << 16 | uint8_t(Beta * 0xFF) << 8 | uint8_t(Gamma * 0xFF);
-            ((Uint32*)screenSurface->pixels)[Y * screenSurface->w + X] = Color;
-         }
-         else if (InsideDetected)  // break to do the next Y.
-         {
-            break;
-         }
-         else  // continue with the next X.
-         {
-            continue;
-         }
-      }
-   }
-}
-
 //-----------------------------------------------------------------------------
 void Render(SDL_Surface* screenSurface, std::vector<screen_render>& vrenders)
 {
@@ -90,7 +36,8 @@ void Render(SDL_Surface* screenSurface, std::vector<screen_render>& vrenders)
    {
       render.V1 = fluffy::render::Rotate(render.V0, render.V1, Angle);
       render.V2 = fluffy::render::Rotate(render.V0, render.V2, Angle);
-      Fillrender(screenSurface, render.V0, render.V1, render.V2, render.Color, render.UseColorGradient);
+      fluffy::render::FillTriangle(screenSurface, render.V0, render.V1, render.V2, render.Color,
+                                   render.UseColorGradient);
       fluffy::render::DrawLine(screenSurface, render.V0, render.V1, render.Color, render.UseColorGradient);
       fluffy::render::DrawLine(screenSurface, render.V0, render.V2, render.Color, render.UseColorGradient);
       fluffy::render::DrawLine(screenSurface, render.V1, render.V2, render.Color, render.UseColorGradient);
@@ -8,13 +8,24 @@
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 
+#include <algorithm>
 #include <array>
+#include <cstdio>
+#include <cstdlib>
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <span>
+#include <string_view>
 #include <vector>
 
 #include "../src/lib/drawprimitives.hpp"
+#include "../src/lib/framepipeline.hpp"
+#include "../src/lib/frameprofiler.hpp"
+#include "../src/lib/framescheduler.hpp"
+#include "../src/lib/memcheck.hpp"
+#include "../src/lib/mesh.hpp"
 #include "../src/lib/splines.hpp"
 #include "../src/lib/triangle2d.hpp"
 #include "SDL_platform.h"
@@ -65,15 +76,60 @@ screen_dimension gScreenDimension{};
 constexpr bool UseColorGradient = true;
 constexpr bool NoColorGradient = false;
 
+/**
+ * The phases of a frame that are timed by the profiler.
+ */
+enum zone : std::uint32_t
+{
+   ZONE_PROCESS_STATE = 0,   //!< Simulation thread.
+   ZONE_SCREEN_OBJECTS = 1,  //!<
+   ZONE_TEXT = 2,            //!<
+   ZONE_SPLINES = 3,         //!<
+   ZONE_TRIANGLES = 4,       //!<
+   ZONE_CIRCLES = 5,         //!<
+   ZONE_LINES = 6,           //!<
+   ZONE_PRESENT = 7,         //!<
+   NUM_ZONES = 8,            //!<
+};
+
+static char const *pStringifyZone[NUM_ZONES] = {
+    "state",      //!<
+    "screenobj",  //!<
+    "text",       //!<
+    "splines",    //!<
+    "triangles",  //!<
+    "circles",    //!<
+    "lines",      //!<
+    "present"     //!<
+};
+
+/**
+ * Shared by the simulation and the render thread. Too large to live on the stack.
+ */
+fluffy::timing::frame_profiler gProfiler{};
+
 struct cube
 {
    Uint32 Color{};
    bool UseColorGradient{};
    bool Rotate{};
-   fluffy::math3d::tup V[8]{};
+   bool Filled{};  //!< Draw the faces with depth test in addition to the wireframe.
+   fluffy::render::mesh Mesh{};                           //!< The 8 corners and the 12 triangles of the faces.
+   std::vector<fluffy::render::vertice_3d> vProjected{};  //!< Mesh vertices on the screen, see TransformMesh().
    fluffy::render::vertice_2d Pixel[8]{};
 };
 
+/**
+ * State owned by the simulation thread. A copy is published to the renderer every frame.
+ * A spline never changes after it has been created, so the splines are shared instead of copied.
+ */
+struct scene
+{
+   app_state AppState{};
+   std::vector<cube> vCubes{};
+   std::vector<std::shared_ptr<fluffy::splines::spline_catmull_rom const>> vSplineCatmullRom{};
+};
+
 struct fps_info
 {
    uint32_t StartTime{};      // When the current second started
@@ -101,33 +157,35 @@ struct screen_objects
    fluffy::math3d::FLOAT t{};
    fluffy::math3d::FLOAT tdirection{1};
    fluffy::render::text_fmt TextSplineInfo{};
+   fluffy::render::glyph_atlas GlyphAtlas{};
    std::vector<fluffy::math3d::tup> vSpline{};
 
-   std::vector<cube> vCubes{};
    std::vector<fluffy::render::text_fmt> vTextObjects{};
    std::string ResourcePath{};
 
    fps_info FpsInfo{};
+   fluffy::timing::frame_scheduler Scheduler{};
+   std::int64_t ZoneP99NS[NUM_ZONES]{};  //!< Updated with the FPS, once per second.
 
    fluffy::splines::spline_catmull_rom Spline1{};
-   std::vector<fluffy::splines::spline_catmull_rom> vSplineCatmullRom{};
-   app_state AppState{};
+
+   std::vector<fluffy::render::vertice_2d> vPoints{};        //!< Scratch for DrawPoints(), reused every frame.
+   std::vector<Uint32> vPointColors{};                       //!< Scratch for DrawPoints(), reused every frame.
+   std::vector<fluffy::render::vertice_3d> vMeshVertices{};  //!< Scratch for DrawMesh() and DrawWireframe().
 };
 
 /**
  * Handle state changes.
  */
-void ProcessState(screen_objects &ScreenObjects)
+void ProcessState(scene &Scene, std::mt19937 &Generator)
 {
-   auto CreateSpline = [](fluffy::math3d::tup const &Color) -> fluffy::splines::spline_catmull_rom
+   auto CreateSpline = [&Generator](fluffy::math3d::tup const &Color) -> fluffy::splines::spline_catmull_rom
    {
       std::vector<fluffy::math3d::tup> vP{};
       /**
        * Generate some random real numbers for the points of a spline.
        */
       {
-         std::random_device RandomDevice{};       // Will be used to obtain a seed for the random number engine
-         std::mt19937 Generator(RandomDevice());  // Standard mersenne_twister_engine seeded with rd()
          std::uniform_real_distribution<> Distribution(2.0, 6.0);
 
          fluffy::math3d::FLOAT XOffs{1};
@@ -143,22 +201,30 @@ void ProcessState(screen_objects &ScreenObjects)
          }
          auto Spline = fluffy::splines::InitCatmullRom(vP);
 
-         constexpr fluffy::math3d::FLOAT Deltat = 0.0001;
-         fluffy::math3d::FLOAT t = 0;
+         /**
+          * Sample at t = 0, 0.0001, ... with forward differences, i.e the points
+          * SplineValueCatmullRom() gives at those t.
+          */
+         constexpr std::size_t NUM_SAMPLES = 10000;
+         std::vector<fluffy::math3d::tup> vSamples(NUM_SAMPLES);
+         fluffy::splines::TessellateCatmullRom(Spline, vSamples);
 
-         while (t < fluffy::math3d::FLOAT(1))
+         auto const NumSegments = Spline.vMatSeg.size();
+         Spline.vSpline.resize(NUM_SAMPLES);
+         for (std::size_t Idx = 0; Idx < NUM_SAMPLES; ++Idx)
          {
-            auto SplineValue = fluffy::splines::SplineValueCatmullRom(Spline, t);
+            auto &SplineValue = Spline.vSpline[Idx];
+            SplineValue.P = vSamples[Idx];
             SplineValue.Col = Color;
-            Spline.vSpline.push_back(SplineValue);
-            t += Deltat;
+            SplineValue.t = fluffy::math3d::FLOAT(Idx) / fluffy::math3d::FLOAT(NUM_SAMPLES);
+            SplineValue.Idx = std::min(Idx * NumSegments / NUM_SAMPLES, NumSegments - 1);
          }
 
          return Spline;
       }
    };
 
-   auto &SO = ScreenObjects;
+   auto &SO = Scene;
    auto &AS = SO.AppState;
    if (AS.State == app_state::NOT_INITIALIZED)
    {
@@ -168,7 +234,8 @@ void ProcessState(screen_objects &ScreenObjects)
    {
       AS.State = app_state::UPDATE;
       AS.Count = 0;
-      SO.vSplineCatmullRom.push_back(CreateSpline({1, 1, 1, 0}));
+      SO.vSplineCatmullRom.push_back(std::make_shared<fluffy::splines::spline_catmull_rom const>(
+          CreateSpline({1, 1, 1, 0})));
    }
    else if (AS.State == app_state::TIMEOUT)
    {
@@ -187,7 +254,8 @@ void ProcessState(screen_objects &ScreenObjects)
       AS.tColorLerp > 1 ? AS.tColorLerp = 0 : AS.tColorLerp += DeltatColor;
       auto ColorCatmR = fluffy::math3d::Lerp({0, 0.5, 0.5}, {1, 1, 1}, AS.tColorLerp);
       ColorCatmR = fluffy::math3d::Normalize(ColorCatmR);
-      SO.vSplineCatmullRom.push_back(CreateSpline(ColorCatmR));
+      SO.vSplineCatmullRom.push_back(std::make_shared<fluffy::splines::spline_catmull_rom const>(
+          CreateSpline(ColorCatmR)));
    }
    else if (AS.State == app_state::UPDATE)
    {
@@ -207,34 +275,47 @@ void ProcessState(screen_objects &ScreenObjects)
 }
 
 /**
- * Do clever things with the screen objects.
+ * Create the cube in screen ScreenCoord. Each corner is projected once, however many faces share it.
  */
-void ProcessScreenObjects(screen_objects &ScreenObjects)
+void ProjectCube(cube &Cube, fluffy::math3d::matrix const &MatrixConversion)
 {
-   if (!ScreenObjects.vCubes.empty())
+   fluffy::render::TransformMesh(Cube.Mesh, MatrixConversion, Cube.vProjected);
+   for (size_t Idx = 0; Idx < std::size(Cube.Pixel) && Idx < Cube.vProjected.size(); ++Idx)
+   {
+      Cube.Pixel[Idx] = {Cube.vProjected[Idx].X, Cube.vProjected[Idx].Y};
+   }
+}
+
+/**
+ * Advance the simulation by one frame. Runs on the simulation thread.
+ */
+void Simulate(scene &Scene, fluffy::math3d::matrix const &MatrixConversion, std::mt19937 &Generator)
+{
+   {
+      fluffy::timing::profile_zone Zone(gProfiler, ZONE_PROCESS_STATE);
+      ProcessState(Scene, Generator);
+   }
+
+   if (!Scene.vCubes.empty())
    {
       // auto M = fluffy::math3d::RotateZ(fluffy::math3d::Deg2Rad(0.1));
-      auto &Cube = ScreenObjects.vCubes[0];
-      auto ZNext = Cube.V[4].Z + 01.0;
+      auto &Cube = Scene.vCubes[0];
+      auto ZNext = Cube.Mesh.Z[4] + 01.0;
       if (ZNext > 50) ZNext = 11;
-      Cube.V[4].Z = ZNext;
-      Cube.V[5].Z = ZNext;
-      Cube.V[6].Z = ZNext;
-      Cube.V[7].Z = ZNext;
+      Cube.Mesh.Z[4] = ZNext;
+      Cube.Mesh.Z[5] = ZNext;
+      Cube.Mesh.Z[6] = ZNext;
+      Cube.Mesh.Z[7] = ZNext;
 
-      /**
-       * Create the cube in screen ScreenCoord
-       */
-      for (size_t Idx = 0;                              //!<
-           Idx < sizeof(cube::V) / sizeof(cube::V[0]);  //!<
-           ++Idx                                        //!<
-      )
-      {
-         auto P = ScreenObjects.MatrixConversion * Cube.V[Idx];
-         Cube.Pixel[Idx] = {P.X, P.Y};
-      }
+      ProjectCube(Cube, MatrixConversion);
    }
+}
 
+/**
+ * Do clever things with the screen objects.
+ */
+void ProcessScreenObjects(screen_objects &ScreenObjects)
+{
 #if 0
    if (!ScreenObjects.vTextObjects.empty())
    {
@@ -260,7 +341,20 @@ void ProcessScreenObjects(screen_objects &ScreenObjects)
       {
          ScreenObjects.FpsInfo.FPS = (float)ScreenObjects.FpsInfo.FrameCount;  // fps will be the number of frames
                                                                                // rendered in the past second
-         ScreenObjects.FpsInfo.Output.Text = std::to_string(int(ScreenObjects.FpsInfo.FPS)) + "fps";
+         auto &Output = ScreenObjects.FpsInfo.Output;
+         fluffy::render::Clear(Output.Text);
+         fluffy::render::AppendInt(Output.Text, int(ScreenObjects.FpsInfo.FPS));
+         auto const &Scheduler = ScreenObjects.Scheduler;
+         fluffy::render::Append(Output.Text, "fps late p50/p99 ");
+         fluffy::render::AppendFixed(Output.Text, fluffy::timing::LatenessPercentileNS(Scheduler, 50) / 1e6, 2);
+         fluffy::render::Append(Output.Text, "/");
+         fluffy::render::AppendFixed(Output.Text, fluffy::timing::LatenessPercentileNS(Scheduler, 99) / 1e6, 2);
+         fluffy::render::Append(Output.Text, "ms");
+         Output.Dirty = true;
+         for (std::uint32_t Zone = 0; Zone < NUM_ZONES; ++Zone)
+         {
+            ScreenObjects.ZoneP99NS[Zone] = fluffy::timing::ZonePercentileNS(gProfiler, Zone, 99);
+         }
          ScreenObjects.FpsInfo.FrameCount = 0;
          ScreenObjects.FpsInfo.StartTime = CurrentTime;
       }
@@ -269,13 +363,14 @@ void ProcessScreenObjects(screen_objects &ScreenObjects)
 
 /**
  */
-void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
+void Render(fluffy::render::render_target &RenderTarget, screen_objects &ScreenObjects, scene const &Scene)
 {
-   ProcessState(ScreenObjects);
-
    auto UpdateTextObjects = ScreenObjects.vSpline.empty();
 
-   ProcessScreenObjects(ScreenObjects);
+   {
+      fluffy::timing::profile_zone Zone(gProfiler, ZONE_SCREEN_OBJECTS);
+      ProcessScreenObjects(ScreenObjects);
+   }
 
    /**
     * Set up text for the different points of the spline.
@@ -285,6 +380,7 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
    {
       fluffy::render::text_fmt TextObject{};
       TextObject.ptrFont = ScreenObjects.TextSplineInfo.ptrFont;
+      TextObject.ptrAtlas = ScreenObjects.TextSplineInfo.ptrAtlas;
 
       auto SetPointText = [&](fluffy::math3d::matrix const &MatrixConversion,
                               std::vector<fluffy::math3d::tup> const &SplineCtrlPoints,
@@ -293,7 +389,8 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
          auto const NumElem = SplineCtrlPoints.size();
          if (Idx >= NumElem) return;
 
-         TextObject.Text = "P" + std::to_string(Idx);
+         TextObject.Text = "P";
+         fluffy::render::AppendInt(TextObject.Text, Idx);
          auto V = MatrixConversion * SplineCtrlPoints[Idx];
          TextObject.Position.x = V.X;
          TextObject.Position.y = V.Y;
@@ -315,12 +412,17 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
    /**
     * Do the actual printing of the Text objects.
     */
-   for (auto &TextObject : ScreenObjects.vTextObjects)
    {
-      fluffy::render::Text(screenSurface, TextObject);
+      fluffy::timing::profile_zone Zone(gProfiler, ZONE_TEXT);
+      for (auto &TextObject : ScreenObjects.vTextObjects)
+      {
+         fluffy::render::Text(RenderTarget, TextObject);
+      }
    }
 
    {
+      fluffy::timing::profile_zone Zone(gProfiler, ZONE_SPLINES);
+
       /**
        * Draw the spline and the corresponding control points.
        * 1. A lambda for ease of drawing.
@@ -328,7 +430,25 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
        * 3. The control points.
        */
 
-      auto PlotPoint = [&](fluffy::math3d::tup const &Point, int Color = 0xFFFFFF, int RadiusInPixels = 2) -> void
+      auto ProjectPoint = [&](fluffy::math3d::tup const &Point) -> fluffy::render::vertice_2d
+      {
+         auto ProjectedPoint = ScreenObjects.MatrixProjection * (ScreenObjects.MatrixScreen * Point);
+         return fluffy::render::vertice_2d{ProjectedPoint.X, ProjectedPoint.Y};
+      };
+
+      /**
+       * Draw many points with the same radius in one call. Colors holds one color or one per point.
+       */
+      auto PlotPoints = [&](auto const &Points, auto ToPoint, std::span<Uint32 const> Colors, int RadiusInPixels,
+                            fluffy::render::blend_mode Blend = fluffy::render::blend_mode::OPAQUE) -> void
+      {
+         ScreenObjects.vPoints.clear();
+         for (auto const &Point : Points) ScreenObjects.vPoints.push_back(ProjectPoint(ToPoint(Point)));
+         fluffy::render::DrawPoints(RenderTarget, ScreenObjects.vPoints, RadiusInPixels, Colors, Blend);
+      };
+
+      auto PlotPoint = [&](fluffy::math3d::tup const &Point, Uint32 Color = 0xFFFFFF, int RadiusInPixels = 2,
+                           fluffy::render::blend_mode Blend = fluffy::render::blend_mode::OPAQUE) -> void
       {
          auto ScreenPoint = ScreenObjects.MatrixScreen * Point;
          auto ProjectedPoint = ScreenObjects.MatrixProjection * ScreenPoint;
@@ -348,7 +468,7 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
             std::cout << "Calc3: " << ScreenPoint << std::endl;
             std::cout << "Calc4: " << ProjectedPoint << std::endl;
          }
-         fluffy::render::DrawCircle(screenSurface, Vert, RadiusInPixels, Color, NoColorGradient);
+         fluffy::render::DrawCircle(RenderTarget, Vert, RadiusInPixels, Color, NoColorGradient, Blend);
       };
 
       {
@@ -373,24 +493,31 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
          t += (Dir * 0.001);
          fluffy::render::text_fmt tTxt{};
          tTxt.ptrFont = ScreenObjects.TextSplineInfo.ptrFont;
+         tTxt.ptrAtlas = ScreenObjects.TextSplineInfo.ptrAtlas;
          if (tTxt.ptrFont != nullptr)
          {
             tTxt.Position.x = 0;
             tTxt.Position.y = 40;
-            tTxt.Text = "t=" + std::to_string(t) + ". Z=" + std::to_string(Z) +
-                        ". P:" + std::to_string(SplineValue.P.X) + " " + std::to_string(SplineValue.P.Y) + " " +
-                        std::to_string(SplineValue.P.Z);
-            fluffy::render::Text(screenSurface, tTxt);
+            auto &Txt = tTxt.Text;
+            fluffy::render::Append(Txt, "t=");
+            fluffy::render::AppendFixed(Txt, t);
+            fluffy::render::Append(Txt, ". Z=");
+            fluffy::render::AppendFixed(Txt, Z);
+            fluffy::render::Append(Txt, ". P:");
+            fluffy::render::AppendFixed(Txt, SplineValue.P.X);
+            fluffy::render::Append(Txt, " ");
+            fluffy::render::AppendFixed(Txt, SplineValue.P.Y);
+            fluffy::render::Append(Txt, " ");
+            fluffy::render::AppendFixed(Txt, SplineValue.P.Z);
+            fluffy::render::Text(RenderTarget, tTxt);
          }
       }
 
       /**
        * Draw the actual spline between the points.
        */
-      for (auto const &Point : ScreenObjects.vSpline)
-      {
-         PlotPoint(Point, 0xFF);
-      }
+      Uint32 const SplineColor[] = {0xFF};
+      PlotPoints(ScreenObjects.vSpline, [](fluffy::math3d::tup const &P) { return P; }, SplineColor, 2);
 
       for (auto const &Point : ScreenObjects.Spline1.CtrlPoints)
       {
@@ -418,35 +545,42 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
             return Col;
          };
 
-         fluffy::math3d::FLOAT NumSplines = ScreenObjects.vSplineCatmullRom.size();
+         fluffy::math3d::FLOAT NumSplines = Scene.vSplineCatmullRom.size();
          fluffy::math3d::FLOAT DeltaColor = (SplineColorTo - SplineColorFrom) / NumSplines;
-         fluffy::math3d::FLOAT DeltaAlpha = fluffy::math3d::FLOAT(1) / ScreenObjects.vSplineCatmullRom.size();
+         fluffy::math3d::FLOAT DeltaAlpha = fluffy::math3d::FLOAT(1) / Scene.vSplineCatmullRom.size();
          fluffy::math3d::FLOAT Alpha{DeltaAlpha};
 
-         for (auto const &Spline : ScreenObjects.vSplineCatmullRom)
+         for (auto const &ptrSpline : Scene.vSplineCatmullRom)
          {
+            auto const &Spline = *ptrSpline;
             for (auto const &CtrlPoint : Spline.CtrlPoints)
             {
                constexpr int Radius = 5;
                PlotPoint(CtrlPoint, CtrlPointColor, Radius);
             }
 
+            /**
+             * The older splines fade out by blending with an alpha that grows with the age of the spline.
+             */
+            ScreenObjects.vPointColors.clear();
             for (auto const &SplineValue : Spline.vSpline)
             {
-               constexpr int Radius = 1;
                auto Col = SplineValue.Col;
-               Col.W = Alpha;
-               PlotPoint(SplineValue.P, ldaConvCol(Col), Radius);
+               Col.W = std::min(Alpha, fluffy::math3d::FLOAT(1));
+               ScreenObjects.vPointColors.push_back(ldaConvCol(Col));
             }
 
+            constexpr int Radius = 0;  // A single pixel, like DrawCircle() with radius 1.
+            PlotPoints(
+                Spline.vSpline, [](auto const &SplineValue) { return SplineValue.P; }, ScreenObjects.vPointColors,
+                Radius, fluffy::render::blend_mode::ALPHA);
+
             Alpha += DeltaAlpha;
          }
       }
 
-      for (auto const &SplineValue : ScreenObjects.Spline1.vSpline)
-      {
-         PlotPoint(SplineValue.P, 0xFF);
-      }
+      PlotPoints(
+          ScreenObjects.Spline1.vSpline, [](auto const &SplineValue) { return SplineValue.P; }, SplineColor, 2);
 
       /**
        * Draw the control points to show how the spline is pulled and pushed.
@@ -472,55 +606,71 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
    /**
     * Draw all the cubes.
     */
-   for (auto &Cube : ScreenObjects.vCubes)
+   for (auto const &SceneCube : Scene.vCubes)
    {
+      /** The snapshot is shared with the simulation, so rotate a copy of the corners. */
+      auto const &Cube = SceneCube;
+      decltype(Cube.Pixel) Pixel{};
+      std::copy(std::begin(Cube.Pixel), std::end(Cube.Pixel), Pixel);
       if (Cube.Rotate)
       {
          fluffy::math3d::FLOAT Angle = fluffy::math3d::Deg2Rad(0.1);
-         Cube.Pixel[1] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[1], Angle);
-         Cube.Pixel[2] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[2], Angle);
-         Cube.Pixel[3] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[3], Angle);
-         Cube.Pixel[4] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[4], Angle);
-         Cube.Pixel[5] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[5], Angle);
-         Cube.Pixel[6] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[6], Angle);
-         Cube.Pixel[7] = fluffy::render::Rotate(Cube.Pixel[0], Cube.Pixel[7], Angle);
+         Pixel[1] = fluffy::render::Rotate(Pixel[0], Pixel[1], Angle);
+         Pixel[2] = fluffy::render::Rotate(Pixel[0], Pixel[2], Angle);
+         Pixel[3] = fluffy::render::Rotate(Pixel[0], Pixel[3], Angle);
+         Pixel[4] = fluffy::render::Rotate(Pixel[0], Pixel[4], Angle);
+         Pixel[5] = fluffy::render::Rotate(Pixel[0], Pixel[5], Angle);
+         Pixel[6] = fluffy::render::Rotate(Pixel[0], Pixel[6], Angle);
+         Pixel[7] = fluffy::render::Rotate(Pixel[0], Pixel[7], Angle);
+      }
+
+      /**
+       * Fill the faces of the cube. The faces turned away are culled and the depth buffer sorts out the rest.
+       */
+      auto &vVertices = ScreenObjects.vMeshVertices;
+      vVertices.assign(Cube.vProjected.begin(), Cube.vProjected.end());
+      for (size_t Idx = 0; Idx < std::size(Pixel) && Idx < vVertices.size(); ++Idx)
+      {
+         vVertices[Idx].X = Pixel[Idx].X;
+         vVertices[Idx].Y = Pixel[Idx].Y;
+      }
+
+      if (Cube.Filled)
+      {
+         fluffy::timing::profile_zone Zone(gProfiler, ZONE_TRIANGLES);
+         fluffy::render::DrawMesh(RenderTarget, Cube.Mesh, vVertices);
       }
 
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[0], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[1], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[2], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[3], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[4], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[5], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[6], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawCircle(screenSurface, Cube.Pixel[7], 4, Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[0], Cube.Pixel[2], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[0], Cube.Pixel[4], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[0], Cube.Pixel[1], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[1], Cube.Pixel[3], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[1], Cube.Pixel[5], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[2], Cube.Pixel[3], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[2], Cube.Pixel[6], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[3], Cube.Pixel[7], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[4], Cube.Pixel[5], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[4], Cube.Pixel[6], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[5], Cube.Pixel[7], Cube.Color, Cube.UseColorGradient);
-      fluffy::render::DrawLine(screenSurface, Cube.Pixel[6], Cube.Pixel[7], Cube.Color, Cube.UseColorGradient);
+      {
+         fluffy::timing::profile_zone Zone(gProfiler, ZONE_CIRCLES);
+         for (auto const &Vert : Pixel)
+         {
+            fluffy::render::DrawCircle(RenderTarget, Vert, 4, Cube.Color, Cube.UseColorGradient);
+         }
+      }
+      {
+         fluffy::timing::profile_zone Zone(gProfiler, ZONE_LINES);
+         fluffy::render::DrawWireframe(RenderTarget, Cube.Mesh, vVertices, Cube.Color, Cube.UseColorGradient);
+      }
 
       /**
        * Display position info.
        */
       if (!ScreenObjects.vTextObjects.empty())
       {
+         fluffy::timing::profile_zone Zone(gProfiler, ZONE_TEXT);
          auto &BaseTO = ScreenObjects.vTextObjects[0];
          fluffy::render::text_fmt PosInfo{};
          PosInfo.ptrFont = BaseTO.ptrFont;
-         PosInfo.Position.x = Cube.Pixel[7].X;
-         PosInfo.Position.y = Cube.Pixel[7].Y;
-         auto strX = std::to_string(PosInfo.Position.x);
-         auto strY = std::to_string(PosInfo.Position.y);
-         PosInfo.Text = "(" + strX + "," + strY + ")";
-         fluffy::render::Text(screenSurface, PosInfo);
+         PosInfo.ptrAtlas = BaseTO.ptrAtlas;
+         PosInfo.Position.x = Pixel[7].X;
+         PosInfo.Position.y = Pixel[7].Y;
+         fluffy::render::Append(PosInfo.Text, "(");
+         fluffy::render::AppendInt(PosInfo.Text, PosInfo.Position.x);
+         fluffy::render::Append(PosInfo.Text, ",");
+         fluffy::render::AppendInt(PosInfo.Text, PosInfo.Position.y);
+         fluffy::render::Append(PosInfo.Text, ")");
+         fluffy::render::Text(RenderTarget, PosInfo);
          // TTF_SetFontSizeDPI(PosInfo.ptrFont, 14, 140, 140);
       }
    }
@@ -529,10 +679,56 @@ void Render(SDL_Surface *screenSurface, screen_objects &ScreenObjects)
    /**
     * Display the FPS.
     */
-   fluffy::render::Text(screenSurface, ScreenObjects.FpsInfo.Output);
+   {
+      fluffy::timing::profile_zone Zone(gProfiler, ZONE_TEXT);
+      fluffy::render::Text(RenderTarget, ScreenObjects.FpsInfo.Output);
+   }
 }
 
-auto InitScreenObjects(screen_objects &ScreenObjects) -> void
+/**
+ * Draw one bar per profiler zone in the lower left corner. The bar is the time spent in the
+ * zone in the last frame, the full width is one frame period. The tick marks the p99.
+ */
+void DrawProfilerOverlay(fluffy::render::render_target &RenderTarget, screen_objects &ScreenObjects)
+{
+   constexpr int BAR_HEIGHT = 6;
+   constexpr int ROW_HEIGHT = 14;
+   constexpr fluffy::math3d::FLOAT BAR_WIDTH = 200;
+   constexpr fluffy::math3d::FLOAT LABEL_WIDTH = 90;
+
+   auto const PeriodNS = ScreenObjects.Scheduler.PeriodNS > 0 ? ScreenObjects.Scheduler.PeriodNS : 16666667;
+   auto ToWidth = [&](std::int64_t NS) -> fluffy::math3d::FLOAT
+   { return std::min(BAR_WIDTH, BAR_WIDTH * fluffy::math3d::FLOAT(NS) / fluffy::math3d::FLOAT(PeriodNS)); };
+
+   fluffy::math3d::FLOAT const X0 = 10 + LABEL_WIDTH;
+   fluffy::math3d::FLOAT Y = gScreenDimension.PixelHeight - 10 - NUM_ZONES * ROW_HEIGHT;
+
+   for (std::uint32_t Zone = 0; Zone < NUM_ZONES; ++Zone, Y += ROW_HEIGHT)
+   {
+      fluffy::render::text_fmt Label{};
+      Label.ptrFont = ScreenObjects.FpsInfo.Output.ptrFont;
+      Label.ptrAtlas = ScreenObjects.FpsInfo.Output.ptrAtlas;
+      if (Label.ptrFont != nullptr)
+      {
+         Label.Position.x = 10;
+         Label.Position.y = int(Y) - ROW_HEIGHT / 2;
+         Label.Text = pStringifyZone[Zone];
+         fluffy::render::Text(RenderTarget, Label);
+      }
+
+      auto const Width = ToWidth(fluffy::timing::ZoneLastFrameNS(gProfiler, Zone));
+      Uint32 const Color = Width >= BAR_WIDTH ? 0xFF4040 : 0x40C040;
+      for (int Row = 0; Row < BAR_HEIGHT; ++Row)
+      {
+         fluffy::render::DrawLine(RenderTarget, {X0, Y + Row}, {X0 + Width, Y + Row}, Color, NoColorGradient);
+      }
+
+      auto const P99 = X0 + ToWidth(ScreenObjects.ZoneP99NS[Zone]);
+      fluffy::render::DrawLine(RenderTarget, {P99, Y - 2}, {P99, Y + BAR_HEIGHT + 1}, 0xFFFFFF, NoColorGradient);
+   }
+}
+
+auto InitScreenObjects(screen_objects &ScreenObjects, scene &Scene) -> void
 {
    ScreenObjects.Projection = fluffy::render::Projection(gScreenDimension.PixelWidth, gScreenDimension.PixelHeight,
                                                          fluffy::math3d::Deg2Rad(ScreenObjects.FOV), -10, 100);
@@ -544,27 +740,46 @@ auto InitScreenObjects(screen_objects &ScreenObjects) -> void
    Cube.Color = 0xFF0000;
    Cube.Rotate = true;
    Cube.UseColorGradient = UseColorGradient;
-   Cube.V[0] = fluffy::math3d::Point(-1, 1, 10);   //!< a or 0
-   Cube.V[1] = fluffy::math3d::Point(1, 1, 10);    //!< b or 1
-   Cube.V[2] = fluffy::math3d::Point(-1, -1, 10);  //!< c or 2
-   Cube.V[3] = fluffy::math3d::Point(1, -1, 10);   //!< d or 3
-   Cube.V[4] = fluffy::math3d::Point(3, 1, 21);    //!< e or 4
-   Cube.V[5] = fluffy::math3d::Point(5, 1, 21);    //!< f or 5
-   Cube.V[6] = fluffy::math3d::Point(3, -1, 21);   //!< g or 6
-   Cube.V[7] = fluffy::math3d::Point(5, -1, 21);   //!< h or 7
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(-1, 1, 10), {1, 0, 0, 0});        //!< a or 0
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(1, 1, 10), {0, 1, 0, 0});         //!< b or 1
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(-1, -1, 10), {0, 0, 1, 0});       //!< c or 2
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(1, -1, 10), {1, 1, 0, 0});        //!< d or 3
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(3, 1, 21), {1, 0, 1, 0});         //!< e or 4
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(5, 1, 21), {0, 1, 1, 0});         //!< f or 5
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(3, -1, 21), {1, 1, 1, 0});        //!< g or 6
+   fluffy::render::AddVertex(Cube.Mesh, fluffy::math3d::Point(5, -1, 21), {0.5, 0.5, 0.5, 0});  //!< h or 7
 
    /**
-    * Create the cube in screen ScreenCoord
+    * The faces are wound so that they are clockwise on the screen when seen from the outside,
+    * so the faces turned away from the eye are culled.
     */
-   for (size_t Idx = 0;                              //!<
-        Idx < sizeof(cube::V) / sizeof(cube::V[0]);  //!<
-        ++Idx                                        //!<
-   )
+   static constexpr uint32_t Faces[6][4] = {
+       {0, 2, 3, 1},  //!< Front
+       {4, 5, 7, 6},  //!< Back
+       {0, 1, 5, 4},  //!< Top
+       {2, 6, 7, 3},  //!< Bottom
+       {0, 4, 6, 2},  //!< Left
+       {1, 3, 7, 5}   //!< Right
+   };
+   for (auto const &Face : Faces)
    {
-      auto P = ScreenObjects.MatrixConversion * Cube.V[Idx];
-      Cube.Pixel[Idx] = {P.X, P.Y};
+      fluffy::render::AddTriangle(Cube.Mesh, Face[0], Face[1], Face[2]);
+      fluffy::render::AddTriangle(Cube.Mesh, Face[0], Face[2], Face[3]);
    }
-   ScreenObjects.vCubes.push_back(Cube);
+
+   /**
+    * The outline is the twelve sides of the cube, not the diagonals splitting the faces.
+    */
+   static constexpr uint32_t Edges[12][2] = {{0, 1}, {0, 2}, {0, 4}, {1, 3}, {1, 5}, {2, 3},
+                                             {2, 6}, {3, 7}, {4, 5}, {4, 6}, {5, 7}, {6, 7}};
+   for (auto const &Edge : Edges)
+   {
+      fluffy::render::AddEdge(Cube.Mesh, Edge[0], Edge[1]);
+   }
+   Cube.Filled = true;
+
+   ProjectCube(Cube, ScreenObjects.MatrixConversion);
+   Scene.vCubes.push_back(Cube);
 
    /**
     * Create the spline to be rendered.
@@ -572,13 +787,87 @@ auto InitScreenObjects(screen_objects &ScreenObjects) -> void
    ScreenObjects.Spline1 = fluffy::splines::SplineTestCatmullRom();
 }
 
+/**
+ * Print the result of --bench as JSON. Allocations are only counted when built with FLUFFY_OVR_MEMALLOC,
+ * otherwise allocations_per_frame is null.
+ */
+auto PrintBenchReport(FILE *ptrOut,                         //!< stdout, or the file given with --bench-out.
+                      std::vector<std::int64_t> &vFrameNS,  //!< Sorted in place.
+                      std::int64_t TotalNS,                 //!<
+                      std::uint64_t NumPrimitives,          //!<
+                      std::size_t NumAllocations,           //!<
+                      std::uint32_t Seed                    //!<
+                      )                                     //!<
+    -> void
+{
+   if (vFrameNS.empty()) return;
+   std::sort(vFrameNS.begin(), vFrameNS.end());
+   auto Percentile = [&](double Pct) -> double
+   {
+      auto const Rank = static_cast<std::size_t>(Pct / 100.0 * double(vFrameNS.size() - 1) + 0.5);
+      return vFrameNS[Rank] / 1e6;
+   };
+
+   auto const NumFrames = vFrameNS.size();
+   auto const Seconds = TotalNS / 1e9;
+   std::fprintf(ptrOut, "{\n");
+   std::fprintf(ptrOut, "  \"frames\": %zu,\n", NumFrames);
+   std::fprintf(ptrOut, "  \"seed\": %u,\n", Seed);
+   std::fprintf(ptrOut, "  \"video_driver\": \"%s\",\n", SDL_GetCurrentVideoDriver());
+   std::fprintf(ptrOut, "  \"seconds\": %.6f,\n", Seconds);
+   std::fprintf(ptrOut, "  \"fps\": %.2f,\n", NumFrames / Seconds);
+   std::fprintf(ptrOut, "  \"frame_ms\": {\"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+                Percentile(50), Percentile(90), Percentile(99), vFrameNS.back() / 1e6);
+   std::fprintf(ptrOut, "  \"primitives\": %llu,\n", (unsigned long long)NumPrimitives);
+   std::fprintf(ptrOut, "  \"primitives_per_second\": %.0f,\n", NumPrimitives / Seconds);
+   if (fluffy::memcheck::IsActive())
+   {
+      std::fprintf(ptrOut, "  \"allocations_per_frame\": %.3f,\n", double(NumAllocations) / NumFrames);
+   }
+   else
+   {
+      std::fprintf(ptrOut, "  \"allocations_per_frame\": null,\n");
+   }
+   std::fprintf(ptrOut, "  \"zones_ms\": {");
+   for (std::uint32_t Zone = 0; Zone < NUM_ZONES; ++Zone)
+   {
+      std::fprintf(ptrOut, "%s\n    \"%s\": {\"p50\": %.4f, \"p99\": %.4f}", Zone ? "," : "", pStringifyZone[Zone],
+                   fluffy::timing::ZonePercentileNS(gProfiler, Zone, 50) / 1e6,
+                   fluffy::timing::ZonePercentileNS(gProfiler, Zone, 99) / 1e6);
+   }
+   std::fprintf(ptrOut, "\n  }\n}\n");
+   std::fflush(ptrOut);
+}
+
 };  // namespace
 
 //-----------------------------------------------------------------------------
 int main(int argc, char *args[])
 {
+   /**
+    * Headless benchmark, e.g --bench 1000. Renders 1000 frames as fast as possible without a
+    * display and prints a JSON report when done, on stdout or to the file given with --bench-out.
+    * Nothing else is printed on stdout in this mode, the logs go to stderr.
+    */
+   int BenchFrames{};
+   char const *ptrBenchOut{};
+   for (int Idx = 1; Idx + 1 < argc; ++Idx)
+   {
+      if (std::string_view(args[Idx]) == "--bench") BenchFrames = std::max(0, std::atoi(args[Idx + 1]));
+      if (std::string_view(args[Idx]) == "--bench-out") ptrBenchOut = args[Idx + 1];
+   }
+   bool const Bench = BenchFrames > 0;
+
    // Initialize SDL
-   if (SDL_Init(SDL_INIT_VIDEO) < 0)
+   if (Bench) SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+   auto InitResult = SDL_Init(SDL_INIT_VIDEO);
+   if (InitResult < 0 && Bench)
+   {
+      SDL_Log("No offscreen video driver, trying dummy. SDL_Error: %s.", SDL_GetError());
+      SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+      InitResult = SDL_Init(SDL_INIT_VIDEO);
+   }
+   if (InitResult < 0)
    {
       SDL_Log("SDL could not initialize! SDL_Error: %s.", SDL_GetError());
       return 1;
@@ -658,6 +947,13 @@ int main(int argc, char *args[])
    ScreenObjects.TextSplineInfo.ptrFont = ptrFont;
    ScreenObjects.FpsInfo.Output.ptrFont = ptrFont;
 
+   /**
+    * Rasterize the glyphs once. The per frame text is then composed from the atlas.
+    */
+   ScreenObjects.GlyphAtlas = fluffy::render::CreateGlyphAtlas(ptrFont);
+   ScreenObjects.TextSplineInfo.ptrAtlas = &ScreenObjects.GlyphAtlas;
+   ScreenObjects.FpsInfo.Output.ptrAtlas = &ScreenObjects.GlyphAtlas;
+
    SDL_Color textColor = {255, 255, 255};
    SDL_Surface *ptrTextSurface = TTF_RenderUTF8_Solid(ptrFont, "Hello, SDL!", textColor);
    if (ptrTextSurface == nullptr)
@@ -686,22 +982,97 @@ int main(int argc, char *args[])
       return 1;
    }
 
+   /**
+    * Attach a depth buffer to the window surface.
+    */
+   fluffy::render::render_target RenderTarget{};
+   fluffy::render::InitRenderTarget(RenderTarget, ptrScreenSurface);
+
    // Main loop flag
    bool Quit{};
 
    // Event handler
    SDL_Event e{};
 
-   InitScreenObjects(ScreenObjects);
+   scene Scene{};
+   InitScreenObjects(ScreenObjects, Scene);
+
+   /**
+    * The benchmark uses a fixed seed so that every run draws the same splines.
+    */
+   constexpr std::uint32_t BENCH_SEED = 5489;
+   std::uint32_t const Seed = Bench ? BENCH_SEED : std::random_device{}();
+   std::mt19937 Generator(Seed);
+
+   /**
+    * The simulation of the next frame runs on its own thread while this frame is rendered
+    * and presented here on the main thread.
+    */
+   fluffy::pipeline::frame_pipeline<scene> Pipeline{};
+   fluffy::pipeline::StartPipeline(Pipeline,
+                                   [&Scene, &Generator, MatrixConversion = ScreenObjects.MatrixConversion](scene &Next)
+                                   {
+                                      Simulate(Scene, MatrixConversion, Generator);
+                                      Next = Scene;
+                                   });
+
+   /**
+    * Target frame rate, e.g --fps 144.
+    */
+   double TargetFPS{60};
+   for (int Idx = 1; Idx + 1 < argc; ++Idx)
+   {
+      if (std::string_view(args[Idx]) == "--fps") TargetFPS = std::atof(args[Idx + 1]);
+   }
+   fluffy::timing::InitFrameScheduler(ScreenObjects.Scheduler, TargetFPS);
+
+   /**
+    * Per phase timing, written to a CSV file on exit when asked for, e.g --profile-csv frames.csv.
+    */
+   char const *ptrProfileCSV{};
+   for (int Idx = 1; Idx + 1 < argc; ++Idx)
+   {
+      if (std::string_view(args[Idx]) == "--profile-csv") ptrProfileCSV = args[Idx + 1];
+   }
+   for (std::uint32_t Zone = 0; Zone < NUM_ZONES; ++Zone)
+   {
+      fluffy::timing::SetZoneName(gProfiler, Zone, pStringifyZone[Zone]);
+   }
+
+   /**
+    * Capture the rendered frames on a writer thread, e.g --capture-ppm frames/f_ or
+    * --capture-y4m "|ffmpeg -i - out.mp4". Frames are dropped when the writer falls behind.
+    */
+   fluffy::capture::frame_capture Capture{};
+   for (int Idx = 1; Idx + 1 < argc; ++Idx)
+   {
+      auto const Option = std::string_view(args[Idx]);
+      if (Option != "--capture-ppm" && Option != "--capture-y4m") continue;
+
+      auto const Format =
+          Option == "--capture-ppm" ? fluffy::capture::capture_format::PPM : fluffy::capture::capture_format::Y4M;
+      if (!fluffy::capture::StartCapture(Capture, Format, args[Idx + 1], ptrScreenSurface->w, ptrScreenSurface->h,
+                                         int(TargetFPS + 0.5)))
+      {
+         SDL_Log("Could not start the capture to %s.", args[Idx + 1]);
+      }
+   }
 
    int ScanCount{};
    SDL_bool IsFullscreen{};
    Uint32 fullscreenFlag = SDL_WINDOW_FULLSCREEN;
 
+   std::vector<std::int64_t> vBenchFrameNS{};
+   vBenchFrameNS.reserve(BenchFrames);
+   auto const BenchAllocations = fluffy::memcheck::NumAllocations();
+   auto const BenchPrimitives = RenderTarget.NumPrimitives;
+   auto const BenchStartNS = fluffy::timing::NowNS();
+
    // Main loop
    while (!Quit)
    {
-      auto CurrentTimeNSBegin = SDL_GetTicksNS();
+      auto const FrameStartNS = fluffy::timing::NowNS();
+      fluffy::timing::BeginProfilerFrame(gProfiler);
 
       // Handle events on queue
       while (SDL_PollEvent(&e) != 0)
@@ -738,6 +1109,7 @@ int main(int argc, char *args[])
                      SDL_Quit();
                      return 1;
                   }
+                  fluffy::render::InitRenderTarget(RenderTarget, ptrScreenSurface);
                }
             }
             break;
@@ -756,11 +1128,14 @@ int main(int argc, char *args[])
          SDL_LockSurface(ptrScreenSurface);
       }
 
-      // Clear the screen to black
-      SDL_FillSurfaceRect(ptrScreenSurface, NULL, SDL_MapRGB(ptrScreenSurface->format, 0, 0, 0));
+      // Clear what was drawn in the previous frame to black
+      fluffy::render::BeginFrame(RenderTarget, SDL_MapRGB(ptrScreenSurface->format, 0, 0, 0));
 
       // Do the rendering
-      Render(ptrScreenSurface, ScreenObjects);
+      auto const *ptrScene = fluffy::pipeline::AcquireFrame(Pipeline);
+      if (ptrScene) Render(RenderTarget, ScreenObjects, *ptrScene);
+      DrawProfilerOverlay(RenderTarget, ScreenObjects);
+      fluffy::render::CaptureSurface(Capture, ptrScreenSurface);
 
       ++ScanCount;
 
@@ -770,26 +1145,59 @@ int main(int argc, char *args[])
          SDL_UnlockSurface(ptrScreenSurface);
       }
 
-      // Update the surface
-      SDL_UpdateWindowSurface(ptrWindow);
+      // Update the parts of the window that have changed
+      {
+         fluffy::timing::profile_zone Zone(gProfiler, ZONE_PRESENT);
+         fluffy::render::PresentFrame(RenderTarget, ptrWindow);
+      }
 
       /**
-       * Compute the remaining time to reach the desired framerate.
+       * Wait for the deadline of the next frame, except when benchmarking.
        */
+      if (Bench)
       {
-         auto CurrentTimeNSEnd = SDL_GetTicksNS();
-         auto TimeSpent = CurrentTimeNSEnd - CurrentTimeNSBegin;
+         vBenchFrameNS.push_back(fluffy::timing::NowNS() - FrameStartNS);
+         if (int(vBenchFrameNS.size()) >= BenchFrames) Quit = true;
+      }
+      else
+      {
+         fluffy::timing::WaitForNextFrame(ScreenObjects.Scheduler);
+      }
+   }
+   auto const BenchTotalNS = fluffy::timing::NowNS() - BenchStartNS;
+   auto const BenchNumAllocations = fluffy::memcheck::NumAllocations() - BenchAllocations;
 
-         constexpr fluffy::math3d::FLOAT FPS = 61;
-         constexpr fluffy::math3d::FLOAT DesiredFrameTime =
-             fluffy::math3d::FLOAT(1000) / fluffy::math3d::FLOAT(FPS) * 1000000;
+   /**
+    * The benchmark does not wait for the scheduler, so it has no statistics to report.
+    */
+   if (!Bench)
+   {
+      auto const &Scheduler = ScreenObjects.Scheduler;
+      SDL_Log("Frames: %llu. Dropped: %llu. Lateness p50: %.3f ms, p99: %.3f ms, max: %.3f ms.",
+              (unsigned long long)Scheduler.NumFrames, (unsigned long long)Scheduler.NumDropped,
+              fluffy::timing::LatenessPercentileNS(Scheduler, 50) / 1e6,
+              fluffy::timing::LatenessPercentileNS(Scheduler, 99) / 1e6, Scheduler.MaxLatenessNS / 1e6);
+   }
 
-         auto TimeRemaining = DesiredFrameTime - TimeSpent;
-         Uint32 Delay = std::max(Uint32(5), std::min(Uint32(100), Uint32(TimeRemaining / 1000000)));
+   fluffy::pipeline::StopPipeline(Pipeline);
 
-         // Wait for a bit
-         SDL_Delay(Delay);  // roughly X frames per second
-      }
+   if (Capture.Writer.joinable())
+   {
+      fluffy::capture::StopCapture(Capture);
+      SDL_Log("Capture: %llu frames written, %llu dropped, %llu rejected, %llu failed.",
+              (unsigned long long)Capture.NumWritten, (unsigned long long)Capture.NumDropped,
+              (unsigned long long)Capture.NumRejected, (unsigned long long)Capture.NumFailed);
+   }
+
+   for (std::uint32_t Zone = 0; Zone < NUM_ZONES; ++Zone)
+   {
+      SDL_Log("Zone %-10s p50: %.3f ms, p99: %.3f ms.", pStringifyZone[Zone],
+              fluffy::timing::ZonePercentileNS(gProfiler, Zone, 50) / 1e6,
+              fluffy::timing::ZonePercentileNS(gProfiler, Zone, 99) / 1e6);
+   }
+   if (ptrProfileCSV && !fluffy::timing::WriteProfileCSV(gProfiler, ptrProfileCSV))
+   {
+      SDL_Log("Could not write the profile to %s.", ptrProfileCSV);
    }
 
    // Destroy resources
@@ -800,7 +1208,24 @@ int main(int argc, char *args[])
    // Quit SDL subsystems
    SDL_Quit();
 
-   std::cout << "Cleanup complete. All good." << std::endl;
+   if (!Bench)
+   {
+      std::cout << "Cleanup complete. All good." << std::endl;
+      return 0;
+   }
+
+   /**
+    * The report is the only output on stdout, so it can be piped straight into a JSON tool.
+    */
+   FILE *ptrBenchFile = ptrBenchOut ? std::fopen(ptrBenchOut, "w") : stdout;
+   if (!ptrBenchFile)
+   {
+      SDL_Log("Could not open %s for the benchmark report.", ptrBenchOut);
+      return 1;
+   }
+   PrintBenchReport(ptrBenchFile, vBenchFrameNS, BenchTotalNS, RenderTarget.NumPrimitives - BenchPrimitives,
+                    BenchNumAllocations, Seed);
+   if (ptrBenchFile != stdout) std::fclose(ptrBenchFile);
 
    return 0;
 }
@@ -0,0 +1,208 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "blend.hpp"
+
+namespace
+{
+using fluffy::render::blend_mode;
+
+#if defined(__AVX2__)
+/**
+ * Blend 8 pixels. S holds the source pixels and A the source alpha broadcast to all channels, both as 16 bit lanes
+ * split in a low and a high half the same way as _mm256_unpacklo/hi_epi8 splits the destination.
+ */
+inline auto Blend8(__m256i D, __m256i SLo, __m256i SHi, __m256i ALo, __m256i AHi, blend_mode Blend) -> __m256i
+{
+   auto const Zero = _mm256_setzero_si256();
+   auto const Round = _mm256_set1_epi16(128);
+   auto const AlphaMask = _mm256_set1_epi32(int(0xFF000000));
+
+   auto Div255 = [&](__m256i T) -> __m256i
+   {
+      T = _mm256_add_epi16(T, Round);
+      return _mm256_srli_epi16(_mm256_add_epi16(T, _mm256_srli_epi16(T, 8)), 8);
+   };
+
+   if (Blend == blend_mode::ALPHA)
+   {
+      auto const Max = _mm256_set1_epi16(255);
+      auto const DLo = _mm256_unpacklo_epi8(D, Zero);
+      auto const DHi = _mm256_unpackhi_epi8(D, Zero);
+      auto const TLo =
+          _mm256_add_epi16(_mm256_mullo_epi16(SLo, ALo), _mm256_mullo_epi16(DLo, _mm256_sub_epi16(Max, ALo)));
+      auto const THi =
+          _mm256_add_epi16(_mm256_mullo_epi16(SHi, AHi), _mm256_mullo_epi16(DHi, _mm256_sub_epi16(Max, AHi)));
+      auto const Result = _mm256_packus_epi16(Div255(TLo), Div255(THi));
+      return _mm256_or_si256(_mm256_andnot_si256(AlphaMask, Result), _mm256_and_si256(AlphaMask, D));
+   }
+
+   auto const Add = _mm256_packus_epi16(Div255(_mm256_mullo_epi16(SLo, ALo)), Div255(_mm256_mullo_epi16(SHi, AHi)));
+   return _mm256_adds_epu8(D, _mm256_andnot_si256(AlphaMask, Add));
+}
+
+inline auto AlphaBroadcast(__m256i S16) -> __m256i
+{
+   return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(S16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#elif defined(__SSE2__)
+/**
+ * Blend 4 pixels. See the AVX2 version above.
+ */
+inline auto Blend4(__m128i D, __m128i SLo, __m128i SHi, __m128i ALo, __m128i AHi, blend_mode Blend) -> __m128i
+{
+   auto const Zero = _mm_setzero_si128();
+   auto const Round = _mm_set1_epi16(128);
+   auto const AlphaMask = _mm_set1_epi32(int(0xFF000000));
+
+   auto Div255 = [&](__m128i T) -> __m128i
+   {
+      T = _mm_add_epi16(T, Round);
+      return _mm_srli_epi16(_mm_add_epi16(T, _mm_srli_epi16(T, 8)), 8);
+   };
+
+   if (Blend == blend_mode::ALPHA)
+   {
+      auto const Max = _mm_set1_epi16(255);
+      auto const DLo = _mm_unpacklo_epi8(D, Zero);
+      auto const DHi = _mm_unpackhi_epi8(D, Zero);
+      auto const TLo = _mm_add_epi16(_mm_mullo_epi16(SLo, ALo), _mm_mullo_epi16(DLo, _mm_sub_epi16(Max, ALo)));
+      auto const THi = _mm_add_epi16(_mm_mullo_epi16(SHi, AHi), _mm_mullo_epi16(DHi, _mm_sub_epi16(Max, AHi)));
+      auto const Result = _mm_packus_epi16(Div255(TLo), Div255(THi));
+      return _mm_or_si128(_mm_andnot_si128(AlphaMask, Result), _mm_and_si128(AlphaMask, D));
+   }
+
+   auto const Add = _mm_packus_epi16(Div255(_mm_mullo_epi16(SLo, ALo)), Div255(_mm_mullo_epi16(SHi, AHi)));
+   return _mm_adds_epu8(D, _mm_andnot_si128(AlphaMask, Add));
+}
+
+inline auto AlphaBroadcast(__m128i S16) -> __m128i
+{
+   return _mm_shufflehi_epi16(_mm_shufflelo_epi16(S16, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+};  // end of anonymous namespace
+
+namespace fluffy
+{
+namespace render
+{
+//------------------------------------------------------------------------------
+auto BlendSpan(uint32_t* ptrDst, std::size_t Num, uint32_t Color, blend_mode Blend) -> void
+{
+   if (Blend == blend_mode::OPAQUE)
+   {
+      std::fill(ptrDst, ptrDst + Num, Color);
+      return;
+   }
+
+   std::size_t Idx{};
+
+#if defined(__AVX2__)
+   {
+      auto const S16 = _mm256_unpacklo_epi8(_mm256_set1_epi32(int(Color)), _mm256_setzero_si256());
+      auto const A16 = _mm256_set1_epi16(short(Color >> 24));
+      for (; Idx + 8 <= Num; Idx += 8)
+      {
+         auto* ptr = reinterpret_cast<__m256i*>(ptrDst + Idx);
+         _mm256_storeu_si256(ptr, Blend8(_mm256_loadu_si256(ptr), S16, S16, A16, A16, Blend));
+      }
+   }
+#elif defined(__SSE2__)
+   {
+      auto const S16 = _mm_unpacklo_epi8(_mm_set1_epi32(int(Color)), _mm_setzero_si128());
+      auto const A16 = _mm_set1_epi16(short(Color >> 24));
+      for (; Idx + 4 <= Num; Idx += 4)
+      {
+         auto* ptr = reinterpret_cast<__m128i*>(ptrDst + Idx);
+         _mm_storeu_si128(ptr, Blend4(_mm_loadu_si128(ptr), S16, S16, A16, A16, Blend));
+      }
+   }
+#endif
+
+   for (; Idx < Num; ++Idx) WritePixel(ptrDst + Idx, Color, Blend);
+}
+
+//------------------------------------------------------------------------------
+auto BlendSpan(uint32_t* ptrDst, uint32_t const* ptrSrc, std::size_t Num, blend_mode Blend) -> void
+{
+   if (Blend == blend_mode::OPAQUE)
+   {
+      std::memcpy(ptrDst, ptrSrc, Num * sizeof(uint32_t));
+      return;
+   }
+
+   std::size_t Idx{};
+
+#if defined(__AVX2__)
+   {
+      auto const Zero = _mm256_setzero_si256();
+      for (; Idx + 8 <= Num; Idx += 8)
+      {
+         auto* ptr = reinterpret_cast<__m256i*>(ptrDst + Idx);
+         auto const S = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ptrSrc + Idx));
+         auto const SLo = _mm256_unpacklo_epi8(S, Zero);
+         auto const SHi = _mm256_unpackhi_epi8(S, Zero);
+         _mm256_storeu_si256(ptr, Blend8(_mm256_loadu_si256(ptr), SLo, SHi, AlphaBroadcast(SLo), AlphaBroadcast(SHi),
+                                         Blend));
+      }
+   }
+#elif defined(__SSE2__)
+   {
+      auto const Zero = _mm_setzero_si128();
+      for (; Idx + 4 <= Num; Idx += 4)
+      {
+         auto* ptr = reinterpret_cast<__m128i*>(ptrDst + Idx);
+         auto const S = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ptrSrc + Idx));
+         auto const SLo = _mm_unpacklo_epi8(S, Zero);
+         auto const SHi = _mm_unpackhi_epi8(S, Zero);
+         _mm_storeu_si128(ptr, Blend4(_mm_loadu_si128(ptr), SLo, SHi, AlphaBroadcast(SLo), AlphaBroadcast(SHi), Blend));
+      }
+   }
+#endif
+
+   for (; Idx < Num; ++Idx) WritePixel(ptrDst + Idx, ptrSrc[Idx], Blend);
+}
+
+//------------------------------------------------------------------------------
+auto LerpColor(uint32_t const* ptrColor1, uint32_t const* ptrColor2, uint32_t* ptrOut, std::size_t Num, float t)
+    -> void
+{
+   auto const t8 = t <= 0.f ? 0u : t >= 1.f ? 256u : static_cast<uint32_t>(t * 256.f);
+   for (std::size_t Idx = 0; Idx < Num; ++Idx)
+   {
+      ptrOut[Idx] = LerpColor8(ptrColor1[Idx], ptrColor2[Idx], t8);
+   }
+}
+
+};  // end of namespace render
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
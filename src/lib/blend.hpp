@@ -0,0 +1,132 @@
+#ifndef SRC_LIB_BLEND_HPP_1F6A8D42_93C5_4E07_B8A2_D54E6C1B7F90
+#define SRC_LIB_BLEND_HPP_1F6A8D42_93C5_4E07_B8A2_D54E6C1B7F90
+
+/**
+ * Blend mode aware pixel writers and color interpolation for 32 bit pixels.
+ * The source alpha is taken from the top byte of the color, i.e 0xAARRGGBB.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fluffy
+{
+namespace render
+{
+enum class blend_mode
+{
+   OPAQUE = 0,    //!< Store the color as is, including the top byte.
+   ALPHA = 1,     //!< Src * A + Dst * (1 - A). The destination keeps its own alpha.
+   ADDITIVE = 2,  //!< Dst + Src * A, saturated per channel. The destination keeps its own alpha.
+};
+
+/**
+ * Divide by 255 with rounding for X in the range 0..255*255.
+ * NOTE: The SIMD span functions use the same formula, so all paths give identical pixels.
+ */
+inline auto Div255(uint32_t X) -> uint32_t
+{
+   X += 128;
+   return (X + (X >> 8)) >> 8;
+}
+
+//------------------------------------------------------------------------------
+inline auto BlendPixel(uint32_t Dst, uint32_t Src, blend_mode Blend) -> uint32_t
+{
+   if (Blend == blend_mode::OPAQUE) return Src;
+
+   auto const A = Src >> 24;
+   uint32_t Result = Dst & 0xFF000000;
+
+   for (int Shift = 0; Shift < 24; Shift += 8)
+   {
+      auto const S = (Src >> Shift) & 0xFF;
+      auto const D = (Dst >> Shift) & 0xFF;
+      uint32_t C{};
+      if (Blend == blend_mode::ALPHA)
+      {
+         C = Div255(S * A + D * (255 - A));
+      }
+      else
+      {
+         C = D + Div255(S * A);
+         if (C > 255) C = 255;
+      }
+      Result |= C << Shift;
+   }
+
+   return Result;
+}
+
+//------------------------------------------------------------------------------
+inline auto WritePixel(uint32_t* ptrDst, uint32_t Color, blend_mode Blend) -> void
+{
+   *ptrDst = BlendPixel(*ptrDst, Color, Blend);
+}
+
+/**
+ * Blend one color into Num consecutive pixels.
+ * Uses AVX2 (8 pixels) or SSE2 (4 pixels) per step when the library is compiled for it.
+ */
+auto BlendSpan(uint32_t* ptrDst, std::size_t Num, uint32_t Color, blend_mode Blend) -> void;
+
+/**
+ * Blend Num source pixels, each with its own alpha, into Num destination pixels.
+ */
+auto BlendSpan(uint32_t* ptrDst, uint32_t const* ptrSrc, std::size_t Num, blend_mode Blend) -> void;
+
+/**
+ * Do a Linear Interpolation between two colors, all four channels, with t8 in 0..256 (t * 256).
+ * The channels are computed two at the time (SWAR) as 0x00AA00GG and 0x00RR00BB,
+ * so there is no per channel float math.
+ */
+inline auto LerpColor8(uint32_t Color1, uint32_t Color2, uint32_t t8) -> uint32_t
+{
+   constexpr uint32_t MASK = 0x00FF00FF;
+   auto const RB = ((Color1 & MASK) * (256 - t8) + (Color2 & MASK) * t8) >> 8;
+   auto const AG = (((Color1 >> 8) & MASK) * (256 - t8) + ((Color2 >> 8) & MASK) * t8) >> 8;
+   return (RB & MASK) | ((AG & MASK) << 8);
+}
+
+/**
+ * Do a Linear Interpolation between two colors, all four channels.
+ * t is quantized to 1/256 steps, see LerpColor8().
+ */
+inline auto LerpColor(uint32_t Color1, uint32_t Color2, float t) -> uint32_t
+{
+   auto const t8 = t <= 0.f ? 0u : t >= 1.f ? 256u : static_cast<uint32_t>(t * 256.f);
+   return LerpColor8(Color1, Color2, t8);
+}
+
+/**
+ * Batch version: ptrOut[i] = LerpColor(ptrColor1[i], ptrColor2[i], t).
+ */
+auto LerpColor(uint32_t const* ptrColor1, uint32_t const* ptrColor2, uint32_t* ptrOut, std::size_t Num, float t)
+    -> void;
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
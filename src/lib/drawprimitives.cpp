@@ -3,62 +3,550 @@
  * Copyright : Willy Clarke.
  */
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 #include "drawprimitives.hpp"
 
+namespace
+{
+/**
+ * Decode one UTF-8 code point and move the pointer past it.
+ * Malformed sequences are returned as the missing glyph.
+ */
+auto NextCodePoint(char const*& ptrText) -> Uint32
+{
+   auto const Lead = static_cast<Uint8>(*ptrText++);
+   if (Lead < 0x80) return Lead;
+
+   int NumContinuation{};
+   Uint32 CodePoint{};
+   if ((Lead & 0xE0) == 0xC0)
+   {
+      NumContinuation = 1;
+      CodePoint = Lead & 0x1F;
+   }
+   else if ((Lead & 0xF0) == 0xE0)
+   {
+      NumContinuation = 2;
+      CodePoint = Lead & 0x0F;
+   }
+   else if ((Lead & 0xF8) == 0xF0)
+   {
+      NumContinuation = 3;
+      CodePoint = Lead & 0x07;
+   }
+   else
+   {
+      return fluffy::render::glyph_atlas::MISSING_GLYPH;
+   }
+
+   while (NumContinuation--)
+   {
+      auto const Next = static_cast<Uint8>(*ptrText);
+      if ((Next & 0xC0) != 0x80) return fluffy::render::glyph_atlas::MISSING_GLYPH;
+      CodePoint = (CodePoint << 6) | (Next & 0x3F);
+      ++ptrText;
+   }
+
+   return CodePoint;
+}
+
+/**
+ * Compose the text from the glyphs in the atlas. Returns the region covered by the glyph cells.
+ */
+template <fluffy::render::pixel_format FORMAT>
+auto TextFromAtlas(SDL_Surface* screenSurface,                //!<
+                   fluffy::render::glyph_atlas const& Atlas,  //!<
+                   fluffy::render::text_fmt const& TextFmt    //!<
+                   )                                          //!<
+    -> SDL_Rect
+{
+   using fluffy::render::glyph_atlas;
+
+   auto const Color = fluffy::render::pixel_traits<FORMAT>::Encode(
+       Uint32(0xFF) << 24 | Uint32(TextFmt.Color.r) << 16 | Uint32(TextFmt.Color.g) << 8 | TextFmt.Color.b);
+   auto const& Clip = screenSurface->clip_rect;
+   auto const PenY = TextFmt.Position.y;
+   auto PenX = TextFmt.Position.x;
+   int PrvIdx{-1};
+   auto Left = PenX;
+   auto Right = PenX;
+
+   char const* ptrText = TextFmt.Text.c_str();
+   while (*ptrText)
+   {
+      auto CodePoint = NextCodePoint(ptrText);
+      if (CodePoint < glyph_atlas::FIRST_GLYPH || CodePoint > glyph_atlas::LAST_GLYPH)
+      {
+         CodePoint = glyph_atlas::MISSING_GLYPH;
+      }
+
+      int const Idx = CodePoint - glyph_atlas::FIRST_GLYPH;
+      if (PrvIdx >= 0 && !Atlas.Kerning.empty()) PenX += Atlas.Kerning[PrvIdx * glyph_atlas::NUM_GLYPHS + Idx];
+
+      auto const& Glyph = Atlas.Glyphs[Idx];
+      Left = std::min(Left, PenX + Glyph.OffsetX);
+      Right = std::max(Right, PenX + Glyph.OffsetX + Glyph.W);
+
+      auto const XBegin = std::max(0, Clip.x - (PenX + Glyph.OffsetX));
+      auto const XEnd = std::min(Glyph.W, Clip.x + Clip.w - (PenX + Glyph.OffsetX));
+      auto const YBegin = std::max(0, Clip.y - PenY);
+      auto const YEnd = std::min(Glyph.H, Clip.y + Clip.h - PenY);
+
+      for (int Y = YBegin; Y < YEnd; ++Y)
+      {
+         auto const* ptrSrc = &Atlas.Mask[size_t(Glyph.Y + Y) * size_t(Atlas.Width) + size_t(Glyph.X)];
+         auto* ptrDst = fluffy::render::PixelRow<FORMAT>(screenSurface, PenY + Y) + PenX + Glyph.OffsetX;
+         for (int X = XBegin; X < XEnd; ++X)
+         {
+            if (ptrSrc[X]) ptrDst[X] = Color;
+         }
+      }
+
+      PenX += Glyph.Advance;
+      PrvIdx = Idx;
+   }
+
+   return SDL_Rect{Left, PenY, Right - Left, Atlas.Height};
+}
+
+/**
+ * Draw the text and return the region it covers. An empty rect is returned when nothing is drawn.
+ */
+auto DrawText(SDL_Surface* screenSurface,        //!<
+              fluffy::render::text_fmt& TextFmt  //!<
+              )                                  //!<
+    -> SDL_Rect
+{
+   if (TextFmt.Text.empty()) return SDL_Rect{};
+
+   if (TextFmt.ptrAtlas)
+   {
+      SDL_Rect Covered{};
+      auto const& Atlas = *TextFmt.ptrAtlas;
+      fluffy::render::DispatchPixelFormat(screenSurface, [&](auto Format)
+                          { Covered = TextFromAtlas<decltype(Format)::value>(screenSurface, Atlas, TextFmt); });
+      return Covered;
+   }
+
+   if (TextFmt.ptrFont == nullptr) return SDL_Rect{};
+
+   if (TextFmt.Dirty && TextFmt.ptrSurface)
+   {
+      SDL_DestroySurface(TextFmt.ptrSurface);
+      TextFmt.ptrSurface = nullptr;
+   }
+
+   if (TextFmt.ptrSurface == nullptr)
+   {
+      TextFmt.ptrSurface = TTF_RenderUTF8_Solid(TextFmt.ptrFont, TextFmt.Text.c_str(), TextFmt.Color);
+   }
+
+   if (TextFmt.ptrSurface == nullptr) return SDL_Rect{};
+
+   SDL_Rect const Covered{TextFmt.Position.x, TextFmt.Position.y, TextFmt.ptrSurface->w, TextFmt.ptrSurface->h};
+   SDL_BlitSurface(TextFmt.ptrSurface, NULL, screenSurface, &TextFmt.Position);
+   return Covered;
+}
+
+/**
+ * Clip Rect to the surface. The result has zero size when they do not overlap.
+ */
+auto ClipRect(SDL_Rect const& Rect,  //!<
+              int Width,             //!<
+              int Height             //!<
+              )                      //!<
+    -> SDL_Rect
+{
+   auto const X0 = std::max(Rect.x, 0);
+   auto const Y0 = std::max(Rect.y, 0);
+   auto const X1 = std::min(Rect.x + Rect.w, Width);
+   auto const Y1 = std::min(Rect.y + Rect.h, Height);
+   if (X1 <= X0 || Y1 <= Y0) return SDL_Rect{};
+   return SDL_Rect{X0, Y0, X1 - X0, Y1 - Y0};
+}
+
+/**
+ * True when the rects overlap or share an edge, i.e when the union does not add much area.
+ */
+auto Touches(SDL_Rect const& A, SDL_Rect const& B) -> bool
+{
+   return A.x <= B.x + B.w && B.x <= A.x + A.w && A.y <= B.y + B.h && B.y <= A.y + A.h;
+}
+
+auto Union(SDL_Rect const& A, SDL_Rect const& B) -> SDL_Rect
+{
+   auto const X0 = std::min(A.x, B.x);
+   auto const Y0 = std::min(A.y, B.y);
+   auto const X1 = std::max(A.x + A.w, B.x + B.w);
+   auto const Y1 = std::max(A.y + A.h, B.y + B.h);
+   return SDL_Rect{X0, Y0, X1 - X0, Y1 - Y0};
+}
+
+/**
+ * A disc as one span per row, relative to the center pixel.
+ * A pixel is covered when its center is within Radius + 0.5 of the center pixel's center.
+ */
+struct point_stamp
+{
+   struct row
+   {
+      int DY{};   //!<
+      int DX{};   //!< First pixel of the span.
+      int Len{};  //!<
+   };
+
+   std::vector<row> Rows{};  //!<
+};
+
+auto PointStamp(int Radius) -> point_stamp const&
+{
+   using fluffy::render::MAX_POINT_RADIUS;
+
+   static std::array<point_stamp, MAX_POINT_RADIUS + 1> const Stamps = []()
+   {
+      std::array<point_stamp, MAX_POINT_RADIUS + 1> Result{};
+      for (int R = 0; R <= MAX_POINT_RADIUS; ++R)
+      {
+         auto const RSquared = (R + 0.5) * (R + 0.5);
+         for (int DY = -R; DY <= R; ++DY)
+         {
+            auto const Half = static_cast<int>(std::sqrt(RSquared - DY * DY));
+            Result[R].Rows.push_back({DY, -Half, 2 * Half + 1});
+         }
+      }
+      return Result;
+   }();
+
+   return Stamps[std::clamp(Radius, 0, MAX_POINT_RADIUS)];
+}
+
+/**
+ * Region covered by the pixels that DrawLine() and DrawCircle() may touch around two points.
+ */
+auto RectAround(fluffy::render::vertice_2d const& V0,  //!<
+                fluffy::render::vertice_2d const& V1   //!<
+                )                                      //!<
+    -> SDL_Rect
+{
+   auto const X0 = static_cast<int>(std::floor(std::min(V0.X, V1.X)));
+   auto const Y0 = static_cast<int>(std::floor(std::min(V0.Y, V1.Y)));
+   auto const X1 = static_cast<int>(std::floor(std::max(V0.X, V1.X)));
+   auto const Y1 = static_cast<int>(std::floor(std::max(V0.Y, V1.Y)));
+   return SDL_Rect{X0, Y0, X1 - X0 + 1, Y1 - Y0 + 1};
+}
+
+/**
+ * Size the levels of the pyramid for a depth buffer of Width x Height pixels.
+ */
+auto InitDepthPyramid(fluffy::render::depth_pyramid& Pyramid,  //!<
+                      int Width,                               //!<
+                      int Height                               //!<
+                      )                                        //!<
+    -> void
+{
+   using fluffy::render::depth_pyramid;
+
+   Pyramid.Levels.clear();
+   if (Width <= 0 || Height <= 0) return;
+
+   auto CellsW = (Width + depth_pyramid::TILE - 1) / depth_pyramid::TILE;
+   auto CellsH = (Height + depth_pyramid::TILE - 1) / depth_pyramid::TILE;
+   for (;;)
+   {
+      auto& Level = Pyramid.Levels.emplace_back();
+      Level.Width = CellsW;
+      Level.Height = CellsH;
+      Level.Farthest.resize(size_t(CellsW) * size_t(CellsH));
+      Level.Nearest.resize(size_t(CellsW) * size_t(CellsH));
+      if (CellsW == 1 && CellsH == 1) break;
+      CellsW = (CellsW + 1) / 2;
+      CellsH = (CellsH + 1) / 2;
+   }
+}
+
+/**
+ * Everything infinitely far away, as the depth buffer after ClearDepthBuffer().
+ */
+auto ClearDepthPyramid(fluffy::render::depth_pyramid& Pyramid) -> void
+{
+   for (auto& Level : Pyramid.Levels)
+   {
+      std::fill(Level.Farthest.begin(), Level.Farthest.end(), 0.f);
+      std::fill(Level.Nearest.begin(), Level.Nearest.end(), 0.f);
+   }
+}
+
+/**
+ * Recompute the level 0 cells under Rect from the depth buffer, and their parents from them.
+ */
+auto UpdatePyramidRect(fluffy::render::depth_pyramid& Pyramid,     //!<
+                       fluffy::render::depth_buffer const& Depth,  //!<
+                       SDL_Rect const& Rect                        //!<
+                       )                                           //!<
+    -> void
+{
+   using fluffy::render::depth_pyramid;
+
+   auto const Clipped = ClipRect(Rect, Depth.Width, Depth.Height);
+   if (Clipped.w == 0 || Pyramid.Levels.empty()) return;
+
+   auto CellX0 = Clipped.x / depth_pyramid::TILE;
+   auto CellY0 = Clipped.y / depth_pyramid::TILE;
+   auto CellX1 = (Clipped.x + Clipped.w - 1) / depth_pyramid::TILE;
+   auto CellY1 = (Clipped.y + Clipped.h - 1) / depth_pyramid::TILE;
+
+   auto& Base = Pyramid.Levels[0];
+   for (int CellY = CellY0; CellY <= CellY1; ++CellY)
+   {
+      auto const Y0 = CellY * depth_pyramid::TILE;
+      auto const Y1 = std::min(Y0 + depth_pyramid::TILE, Depth.Height);
+      for (int CellX = CellX0; CellX <= CellX1; ++CellX)
+      {
+         auto const X0 = CellX * depth_pyramid::TILE;
+         auto const X1 = std::min(X0 + depth_pyramid::TILE, Depth.Width);
+         auto Farthest = std::numeric_limits<float>::max();
+         auto Nearest = 0.f;
+         for (int Y = Y0; Y < Y1; ++Y)
+         {
+            auto const* ptrRow = &Depth.Data[size_t(Y) * size_t(Depth.Width)];
+            for (int X = X0; X < X1; ++X)
+            {
+               Farthest = std::min(Farthest, ptrRow[X]);
+               Nearest = std::max(Nearest, ptrRow[X]);
+            }
+         }
+         auto const Cell = size_t(CellY) * size_t(Base.Width) + size_t(CellX);
+         Base.Farthest[Cell] = Farthest;
+         Base.Nearest[Cell] = Nearest;
+      }
+   }
+
+   for (size_t L = 1; L < Pyramid.Levels.size(); ++L)
+   {
+      auto const& Child = Pyramid.Levels[L - 1];
+      auto& Level = Pyramid.Levels[L];
+      CellX0 /= 2, CellY0 /= 2, CellX1 /= 2, CellY1 /= 2;
+      for (int CellY = CellY0; CellY <= CellY1; ++CellY)
+      {
+         for (int CellX = CellX0; CellX <= CellX1; ++CellX)
+         {
+            auto Farthest = std::numeric_limits<float>::max();
+            auto Nearest = 0.f;
+            for (int Y = 2 * CellY; Y < std::min(2 * CellY + 2, Child.Height); ++Y)
+            {
+               for (int X = 2 * CellX; X < std::min(2 * CellX + 2, Child.Width); ++X)
+               {
+                  auto const ChildCell = size_t(Y) * size_t(Child.Width) + size_t(X);
+                  Farthest = std::min(Farthest, Child.Farthest[ChildCell]);
+                  Nearest = std::max(Nearest, Child.Nearest[ChildCell]);
+               }
+            }
+            auto const Cell = size_t(CellY) * size_t(Level.Width) + size_t(CellX);
+            Level.Farthest[Cell] = Farthest;
+            Level.Nearest[Cell] = Nearest;
+         }
+      }
+   }
+}
+};  // end of anonymous namespace
+
 namespace fluffy
 {
 namespace render
 {
+namespace
+{
 //-----------------------------------------------------------------------------
-auto DrawLine(SDL_Surface* screenSurface,            //!<
-              fluffy::render::vertice_2d const& V0,  //!<
-              fluffy::render::vertice_2d const& V1,  //!<
-              Uint32 Color,                          //!<
-              bool UseColorGradient                  //!<
-              )                                      //!<
+template <pixel_format FORMAT>
+auto DrawLineAs(SDL_Surface* screenSurface,               //!<
+                fluffy::render::vertice_2d const& V0,     //!<
+                fluffy::render::vertice_2d const& V1,     //!<
+                Uint32 Color,                             //!<
+                bool UseColorGradient,                    //!<
+                blend_mode Blend,                         //!<
+                fluffy::math3d::FLOAT GradientBegin = 0,  //!< Part of the gradient at V0,
+                fluffy::math3d::FLOAT GradientEnd = 1     //!< and at V1, for clipped lines.
+                )                                         //!<
     -> void
 {
    /* Compute number of pixels based on line length. */
    auto NumPixels = fluffy::render::Length(V0, V1);
    if (NumPixels < fluffy::math3d::FLOAT(1)) return;
 
+   /**
+    * Step the position and the color gradient incrementally, so there are no divides per pixel.
+    * The gradient channels are 0..255 in 16.16 fixed point.
+    */
+   auto const Step = fluffy::render::Vector(V0, V1) * (fluffy::math3d::FLOAT(1) / NumPixels);
+   auto const GradientScale = fluffy::math3d::FLOAT(0xFF << 16);
+   auto const AlfaStep = static_cast<int32_t>(GradientScale * (GradientEnd - GradientBegin) / NumPixels);
+   auto Alfa = static_cast<int32_t>(GradientScale * GradientBegin);
+   int32_t Gamma = (0xFF << 16) - Alfa;
+
+   auto P = V0;
    fluffy::math3d::FLOAT Idx{};
 
    while (Idx < NumPixels)
    {
-      auto P = V0 + fluffy::render::Vector(V0, V1) * (Idx / NumPixels);
-
       auto X = static_cast<int>(P.X);
       auto Y = static_cast<int>(P.Y);
       if (UseColorGradient)
       {
-         auto Alfa = Idx / NumPixels;
-         auto Gamma = 1 - Idx / NumPixels;
-         auto Beta = std::abs(Alfa - Gamma);
-         Color = uint8_t(Alfa * 0xFF) << 16 | uint8_t(Beta * 0xFF) << 8 | uint8_t(Gamma * 0xFF);
+         auto const Beta = std::abs(Alfa - Gamma);
+         Color = (Color & 0xFF000000) | (Alfa >> 16) << 16 | (Beta >> 16) << 8 | (Gamma >> 16);
       }
 
       /**
        * Check that the pixel is inside the rectangle. Stop drawing when this happens.
        */
-      if (X > screenSurface->clip_rect.w || Y > screenSurface->clip_rect.h) break;
+      if (X >= screenSurface->clip_rect.w || Y >= screenSurface->clip_rect.h) break;
       if (X < 0 || Y < 0) break;
 
-      ((Uint32*)screenSurface->pixels)[Y * screenSurface->w + X] = Color;
+      WritePixelAs<FORMAT>(PixelRow<FORMAT>(screenSurface, Y) + X, Color, Blend);
+
+      P = P + Step;
+      Alfa += AlfaStep;
+      Gamma -= AlfaStep;
       ++Idx;
    }
 }
+};  // end of anonymous namespace
 
+//-----------------------------------------------------------------------------
+auto DrawLine(SDL_Surface* screenSurface,            //!<
+              fluffy::render::vertice_2d const& V0,  //!<
+              fluffy::render::vertice_2d const& V1,  //!<
+              Uint32 Color,                          //!<
+              bool UseColorGradient,                 //!<
+              blend_mode Blend                       //!<
+              )                                      //!<
+    -> void
+{
+   DispatchPixelFormat(screenSurface, [&](auto Format)
+                       { DrawLineAs<decltype(Format)::value>(screenSurface, V0, V1, Color, UseColorGradient, Blend); });
+}
+
+namespace
+{
 //------------------------------------------------------------------------------
-auto DrawCircle(SDL_Surface* screenSurface,                //!<
-                fluffy::render::vertice_2d const& Center,  //!<
-                fluffy::math3d::FLOAT Radius,              //!<
-                Uint32 Color,                              //!<
-                bool UseColorGradient                      //!<
-                )                                          //!<
+/**
+ * Clip the line V0 -> V1 to the surface with the Liang-Barsky algorithm. T0 and T1 are set to
+ * where the clipped line starts and ends, as parts of the whole line. Returns false if nothing is left.
+ */
+auto ClipLine(SDL_Surface const* screenSurface,      //!<
+              fluffy::render::vertice_2d const& V0,  //!<
+              fluffy::render::vertice_2d const& V1,  //!<
+              fluffy::math3d::FLOAT& T0,             //!<
+              fluffy::math3d::FLOAT& T1              //!<
+              )                                      //!<
+    -> bool
+{
+   using fluffy::math3d::FLOAT;
+
+   /** Stay a bit inside the far edges, pixels are found by truncating the position. */
+   auto const XMax = FLOAT(screenSurface->clip_rect.w) - FLOAT(1) / 1024;
+   auto const YMax = FLOAT(screenSurface->clip_rect.h) - FLOAT(1) / 1024;
+   auto const DX = V1.X - V0.X;
+   auto const DY = V1.Y - V0.Y;
+
+   T0 = 0;
+   T1 = 1;
+   auto Clip = [&](FLOAT P, FLOAT Q) -> bool
+   {
+      if (P == 0) return Q >= 0;
+      auto const T = Q / P;
+      if (P < 0)
+         T0 = std::max(T0, T);
+      else
+         T1 = std::min(T1, T);
+      return T0 <= T1;
+   };
+
+   return Clip(-DX, V0.X) && Clip(DX, XMax - V0.X) && Clip(-DY, V0.Y) && Clip(DY, YMax - V0.Y);
+}
+
+//------------------------------------------------------------------------------
+template <pixel_format FORMAT>
+auto DrawEdgesAs(SDL_Surface* screenSurface,            //!<
+                 std::span<vertice_3d const> Vertices,  //!<
+                 std::span<uint32_t const> Edges,       //!<
+                 Uint32 Color,                          //!<
+                 bool UseColorGradient,                 //!<
+                 blend_mode Blend,                      //!<
+                 SDL_Rect& Covered                      //!< Union of the lines drawn.
+                 )                                      //!<
+    -> std::size_t
+{
+   using fluffy::math3d::FLOAT;
+
+   std::size_t NumDrawn{};
+   auto Min = vertice_2d{std::numeric_limits<FLOAT>::max(), std::numeric_limits<FLOAT>::max()};
+   auto Max = vertice_2d{std::numeric_limits<FLOAT>::lowest(), std::numeric_limits<FLOAT>::lowest()};
+
+   for (std::size_t Idx = 0; Idx + 1 < Edges.size(); Idx += 2)
+   {
+      auto const I0 = Edges[Idx];
+      auto const I1 = Edges[Idx + 1];
+      if (I0 >= Vertices.size() || I1 >= Vertices.size()) continue;
+      if (Vertices[I0].W <= 0 || Vertices[I1].W <= 0) continue;
+
+      vertice_2d const V0{Vertices[I0].X, Vertices[I0].Y};
+      vertice_2d const V1{Vertices[I1].X, Vertices[I1].Y};
+      FLOAT T0{}, T1{};
+      if (!ClipLine(screenSurface, V0, V1, T0, T1)) continue;
+
+      auto const Delta = Vector(V0, V1);
+      auto const C0 = V0 + Delta * T0;
+      auto const C1 = V0 + Delta * T1;
+      DrawLineAs<FORMAT>(screenSurface, C0, C1, Color, UseColorGradient, Blend, T0, T1);
+      ++NumDrawn;
+
+      Min = {std::min({Min.X, C0.X, C1.X}), std::min({Min.Y, C0.Y, C1.Y})};
+      Max = {std::max({Max.X, C0.X, C1.X}), std::max({Max.Y, C0.Y, C1.Y})};
+   }
+
+   Covered = NumDrawn ? RectAround(Min, Max) : SDL_Rect{};
+   return NumDrawn;
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto DrawEdges(SDL_Surface* screenSurface,            //!<
+               std::span<vertice_3d const> Vertices,  //!<
+               std::span<uint32_t const> Edges,       //!<
+               Uint32 Color,                          //!<
+               bool UseColorGradient,                 //!<
+               blend_mode Blend                       //!<
+               )                                      //!<
+    -> std::size_t
+{
+   std::size_t NumDrawn{};
+   SDL_Rect Covered{};
+   DispatchPixelFormat(screenSurface,
+                       [&](auto Format)
+                       {
+                          NumDrawn = DrawEdgesAs<decltype(Format)::value>(screenSurface, Vertices, Edges, Color,
+                                                                          UseColorGradient, Blend, Covered);
+                       });
+   return NumDrawn;
+}
+
+namespace
+{
+//------------------------------------------------------------------------------
+template <pixel_format FORMAT>
+auto DrawCircleAs(SDL_Surface* screenSurface,                //!<
+                  fluffy::render::vertice_2d const& Center,  //!<
+                  fluffy::math3d::FLOAT Radius,              //!<
+                  Uint32 Color,                              //!<
+                  bool UseColorGradient,                     //!<
+                  blend_mode Blend                           //!<
+                  )                                          //!<
     -> void
 {
    auto NumPixels = Radius * fluffy::math3d::FLOAT(2) * M_PI;
@@ -79,46 +567,946 @@ auto DrawCircle(SDL_Surface* screenSurface,                //!<
       /**
        * Check that the pixel is inside the rectangle. Stop drawing when this happens.
        */
-      if (X > screenSurface->clip_rect.w || Y > screenSurface->clip_rect.h) break;
+      if (X >= screenSurface->clip_rect.w || Y >= screenSurface->clip_rect.h) break;
       if (X < 0 || Y < 0) break;
 
       if (UseColorGradient)
       {
-         DrawLine(screenSurface, Center, V1, Color, UseColorGradient);
+         DrawLineAs<FORMAT>(screenSurface, Center, V1, Color, UseColorGradient, Blend);
       }
-      ((Uint32*)screenSurface->pixels)[Y * screenSurface->w + X] = Color;
+      WritePixelAs<FORMAT>(PixelRow<FORMAT>(screenSurface, Y) + X, Color, Blend);
 
       if (Radius < 2) break;
 
       Angle += AngleDelta;
    }
 }
+};  // end of anonymous namespace
 
-//-----------------------------------------------------------------------------
-auto Text(SDL_Surface* screenSurface,  //!<
-          text_fmt& TextFmt            //!<
-          )                            //!<
+//------------------------------------------------------------------------------
+auto DrawCircle(SDL_Surface* screenSurface,                //!<
+                fluffy::render::vertice_2d const& Center,  //!<
+                fluffy::math3d::FLOAT Radius,              //!<
+                Uint32 Color,                              //!<
+                bool UseColorGradient,                     //!<
+                blend_mode Blend                           //!<
+                )                                          //!<
     -> void
 {
-   if (TextFmt.Text.empty()) return;
+   DispatchPixelFormat(
+       screenSurface, [&](auto Format)
+       { DrawCircleAs<decltype(Format)::value>(screenSurface, Center, Radius, Color, UseColorGradient, Blend); });
+}
 
-   if (TextFmt.ptrFont == nullptr) return;
+//------------------------------------------------------------------------------
+auto SetPalette332(SDL_Surface* ptrSurface) -> int
+{
+   if (ptrSurface == nullptr || ptrSurface->format == nullptr || ptrSurface->format->palette == nullptr) return -1;
 
-   if (TextFmt.Dirty && TextFmt.ptrSurface)
+   SDL_Color Colors[256]{};
+   for (int Idx = 0; Idx < 256; ++Idx)
    {
-      SDL_DestroySurface(TextFmt.ptrSurface);
-      TextFmt.ptrSurface = nullptr;
+      auto const Color = Palette332(static_cast<uint8_t>(Idx));
+      Colors[Idx] = SDL_Color{Uint8(Color >> 16), Uint8(Color >> 8), Uint8(Color), 0xFF};
    }
+   return SDL_SetPaletteColors(ptrSurface->format->palette, Colors, 0, 256);
+}
 
-   if (TextFmt.ptrSurface == nullptr)
+//------------------------------------------------------------------------------
+auto DrawLine(render_target& Target,                 //!<
+              fluffy::render::vertice_2d const& V0,  //!<
+              fluffy::render::vertice_2d const& V1,  //!<
+              Uint32 Color,                          //!<
+              bool UseColorGradient,                 //!<
+              blend_mode Blend                       //!<
+              )                                      //!<
+    -> void
+{
+   if (Target.ptrSurface == nullptr) return;
+   DrawLine(Target.ptrSurface, V0, V1, Color, UseColorGradient, Blend);
+   ++Target.NumPrimitives;
+   MarkDirty(Target, RectAround(V0, V1));
+}
+
+//------------------------------------------------------------------------------
+auto DrawEdges(render_target& Target,                 //!<
+               std::span<vertice_3d const> Vertices,  //!<
+               std::span<uint32_t const> Edges,       //!<
+               Uint32 Color,                          //!<
+               bool UseColorGradient,                 //!<
+               blend_mode Blend                       //!<
+               )                                      //!<
+    -> std::size_t
+{
+   if (Target.ptrSurface == nullptr) return 0;
+
+   std::size_t NumDrawn{};
+   SDL_Rect Covered{};
+   DispatchPixelFormat(Target.ptrSurface,
+                       [&](auto Format)
+                       {
+                          NumDrawn = DrawEdgesAs<decltype(Format)::value>(Target.ptrSurface, Vertices, Edges, Color,
+                                                                          UseColorGradient, Blend, Covered);
+                       });
+   Target.NumPrimitives += NumDrawn;
+   if (NumDrawn) MarkDirty(Target, Covered);
+   return NumDrawn;
+}
+
+//------------------------------------------------------------------------------
+auto DrawCircle(render_target& Target,                     //!<
+                fluffy::render::vertice_2d const& Center,  //!<
+                fluffy::math3d::FLOAT Radius,              //!<
+                Uint32 Color,                              //!<
+                bool UseColorGradient,                     //!<
+                blend_mode Blend                           //!<
+                )                                          //!<
+    -> void
+{
+   if (Target.ptrSurface == nullptr) return;
+   DrawCircle(Target.ptrSurface, Center, Radius, Color, UseColorGradient, Blend);
+   ++Target.NumPrimitives;
+   fluffy::render::vertice_2d const Extent{Radius + 1, Radius + 1};
+   MarkDirty(Target, RectAround(Center - Extent, Center + Extent));
+}
+
+namespace
+{
+//------------------------------------------------------------------------------
+template <pixel_format FORMAT>
+auto DrawPointsAs(SDL_Surface* screenSurface,          //!<
+                  std::span<vertice_2d const> Points,  //!<
+                  int Radius,                          //!<
+                  std::span<Uint32 const> Colors,      //!<
+                  blend_mode Blend                     //!<
+                  )                                    //!<
+    -> std::size_t
+{
+   std::size_t NumDrawn{};
+   auto const& Stamp = PointStamp(Radius);
+   auto const R = std::clamp(Radius, 0, MAX_POINT_RADIUS);
+   auto const PerPointColor = Colors.size() > 1;
+   auto const NumPoints = PerPointColor ? std::min(Points.size(), Colors.size()) : Points.size();
+
+   auto const& Clip = screenSurface->clip_rect;
+   auto const ClipX1 = Clip.x + Clip.w;
+   auto const ClipY1 = Clip.y + Clip.h;
+
+   /**
+    * Opaque spans are plain fills. Blended spans go through the SIMD BlendSpan() once they
+    * are at least one SSE2 register wide, shorter ones are blended inline.
+    */
+   constexpr int MIN_SIMD_SPAN = 4;
+   auto WriteSpan = [&](int Y, int X0, int X1, Uint32 Color) -> void
    {
-      TextFmt.ptrSurface = TTF_RenderUTF8_Solid(TextFmt.ptrFont, TextFmt.Text.c_str(), TextFmt.Color);
+      auto* ptrDst = PixelRow<FORMAT>(screenSurface, Y) + X0;
+      if (Blend == blend_mode::OPAQUE)
+      {
+         std::fill_n(ptrDst, X1 - X0, pixel_traits<FORMAT>::Encode(Color));
+         return;
+      }
+      if (X1 - X0 >= MIN_SIMD_SPAN)
+      {
+         WriteSpanAs<FORMAT>(ptrDst, std::size_t(X1 - X0), Color, Blend);
+         return;
+      }
+      for (int X = X0; X < X1; ++X, ++ptrDst) WritePixelAs<FORMAT>(ptrDst, Color, Blend);
+   };
+
+   /**
+    * Coarse clipping of the whole stamp is done in floating point, so that only values in the
+    * int range are converted. NaN fails both comparisons and is skipped as well.
+    */
+   using fluffy::math3d::FLOAT;
+   auto const MinX = FLOAT(Clip.x - R);
+   auto const MaxX = FLOAT(ClipX1 + R);
+   auto const MinY = FLOAT(Clip.y - R);
+   auto const MaxY = FLOAT(ClipY1 + R);
+
+   for (std::size_t Idx = 0; Idx < NumPoints; ++Idx)
+   {
+      auto const PX = std::floor(Points[Idx].X);
+      auto const PY = std::floor(Points[Idx].Y);
+      if (!(PX >= MinX && PX < MaxX && PY >= MinY && PY < MaxY)) continue;
+
+      auto const X = static_cast<int>(PX);
+      auto const Y = static_cast<int>(PY);
+      auto const Inside = X - R >= Clip.x && X + R < ClipX1 && Y - R >= Clip.y && Y + R < ClipY1;
+      ++NumDrawn;
+
+      auto const Color = PerPointColor ? Colors[Idx] : Colors[0];
+
+      if (Inside)
+      {
+         for (auto const& Row : Stamp.Rows) WriteSpan(Y + Row.DY, X + Row.DX, X + Row.DX + Row.Len, Color);
+         continue;
+      }
+
+      for (auto const& Row : Stamp.Rows)
+      {
+         auto const YRow = Y + Row.DY;
+         if (YRow < Clip.y || YRow >= ClipY1) continue;
+         auto const X0 = std::max(X + Row.DX, Clip.x);
+         auto const X1 = std::min(X + Row.DX + Row.Len, ClipX1);
+         if (X0 < X1) WriteSpan(YRow, X0, X1, Color);
+      }
+   }
+   return NumDrawn;
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto DrawPoints(SDL_Surface* screenSurface,          //!<
+                std::span<vertice_2d const> Points,  //!<
+                int Radius,                          //!<
+                std::span<Uint32 const> Colors,      //!<
+                blend_mode Blend                     //!<
+                )                                    //!<
+    -> void
+{
+   if (Colors.empty()) return;
+   DispatchPixelFormat(screenSurface, [&](auto Format)
+                       { DrawPointsAs<decltype(Format)::value>(screenSurface, Points, Radius, Colors, Blend); });
+}
+
+//------------------------------------------------------------------------------
+auto DrawPoints(render_target& Target,               //!<
+                std::span<vertice_2d const> Points,  //!<
+                int Radius,                          //!<
+                std::span<Uint32 const> Colors,      //!<
+                blend_mode Blend                     //!<
+                )                                    //!<
+    -> void
+{
+   if (Target.ptrSurface == nullptr || Points.empty() || Colors.empty()) return;
+
+   /**
+    * Only the points that are at least partly inside the clip rectangle are counted.
+    */
+   std::size_t NumDrawn{};
+   DispatchPixelFormat(Target.ptrSurface,
+                       [&](auto Format)
+                       {
+                          NumDrawn = DrawPointsAs<decltype(Format)::value>(Target.ptrSurface, Points, Radius, Colors,
+                                                                           Blend);
+                       });
+   Target.NumPrimitives += NumDrawn;
+   if (NumDrawn == 0) return;
+
+   /**
+    * NaN never wins std::min() or std::max() against a number, and the box is clamped to
+    * just outside the surface before RectAround() converts it to int.
+    */
+   using fluffy::math3d::FLOAT;
+   constexpr auto LARGE = std::numeric_limits<FLOAT>::max();
+   vertice_2d Min{LARGE, LARGE};
+   vertice_2d Max{-LARGE, -LARGE};
+   for (auto const& P : Points)
+   {
+      Min.X = std::min(Min.X, P.X);
+      Min.Y = std::min(Min.Y, P.Y);
+      Max.X = std::max(Max.X, P.X);
+      Max.Y = std::max(Max.Y, P.Y);
+   }
+
+   auto const R = static_cast<FLOAT>(std::clamp(Radius, 0, MAX_POINT_RADIUS));
+   vertice_2d const Lo{-1, -1};
+   vertice_2d const Hi{FLOAT(Target.ptrSurface->w), FLOAT(Target.ptrSurface->h)};
+   auto Clamp = [&](vertice_2d const& V) -> vertice_2d
+   { return vertice_2d{std::clamp(V.X, Lo.X, Hi.X), std::clamp(V.Y, Lo.Y, Hi.Y)}; };
+   MarkDirty(Target, RectAround(Clamp(Min - vertice_2d{R, R}), Clamp(Max + vertice_2d{R, R})));
+}
+
+//------------------------------------------------------------------------------
+auto InitRenderTarget(render_target& Target,      //!<
+                      SDL_Surface* screenSurface  //!<
+                      )                           //!<
+    -> void
+{
+   Target.ptrSurface = screenSurface;
+   Target.Dirty.FullFrame = true;
+   Target.Dirty.Current.clear();
+   Target.Dirty.Previous.clear();
+   Target.Dirty.Current.reserve(dirty_rects::MAX_RECTS);
+   Target.Dirty.Previous.reserve(dirty_rects::MAX_RECTS);
+   Target.Dirty.Present.reserve(2 * dirty_rects::MAX_RECTS);
+   if (screenSurface == nullptr) return;
+
+   auto& Depth = Target.Depth;
+   if (Depth.Width != screenSurface->w || Depth.Height != screenSurface->h)
+   {
+      Depth.Width = screenSurface->w;
+      Depth.Height = screenSurface->h;
+      auto const NumBlocks = (Depth.Width + depth_buffer::SPAN_BLOCK - 1) / depth_buffer::SPAN_BLOCK;
+      Depth.Data.resize(size_t(Depth.Width) * size_t(Depth.Height));
+      Depth.Farthest.resize(size_t(NumBlocks) * size_t(Depth.Height));
+      InitDepthPyramid(Target.Pyramid, Depth.Width, Depth.Height);
+   }
+
+   ClearDepthBuffer(Depth);
+   ClearDepthPyramid(Target.Pyramid);
+}
+
+//------------------------------------------------------------------------------
+auto ClearDepthBuffer(depth_buffer& Depth) -> void
+{
+   std::fill(Depth.Data.begin(), Depth.Data.end(), 0.f);
+   std::fill(Depth.Farthest.begin(), Depth.Farthest.end(), 0.f);
+}
+
+//------------------------------------------------------------------------------
+auto ClearDepthBuffer(depth_buffer& Depth,  //!<
+                      SDL_Rect const& Rect  //!<
+                      )                     //!<
+    -> void
+{
+   auto const Clipped = ClipRect(Rect, Depth.Width, Depth.Height);
+   if (Clipped.w == 0) return;
+
+   /**
+    * A block that is only partly cleared gets 0 as farthest value, which is always conservative.
+    */
+   auto const NumBlocks = (Depth.Width + depth_buffer::SPAN_BLOCK - 1) / depth_buffer::SPAN_BLOCK;
+   auto const BlockBegin = Clipped.x / depth_buffer::SPAN_BLOCK;
+   auto const BlockEnd = (Clipped.x + Clipped.w - 1) / depth_buffer::SPAN_BLOCK + 1;
+   for (int Y = Clipped.y; Y < Clipped.y + Clipped.h; ++Y)
+   {
+      auto* ptrRow = &Depth.Data[size_t(Y) * size_t(Depth.Width)];
+      std::fill(ptrRow + Clipped.x, ptrRow + Clipped.x + Clipped.w, 0.f);
+      auto* ptrFarthestRow = &Depth.Farthest[size_t(Y) * size_t(NumBlocks)];
+      std::fill(ptrFarthestRow + BlockBegin, ptrFarthestRow + BlockEnd, 0.f);
+   }
+}
+
+//------------------------------------------------------------------------------
+auto UpdateDepthPyramid(render_target& Target) -> void
+{
+   for (auto const& Rect : Target.Dirty.Current) UpdatePyramidRect(Target.Pyramid, Target.Depth, Rect);
+}
+
+//------------------------------------------------------------------------------
+auto TestBoundingBox(render_target const& Target,             //!<
+                     math3d::matrix const& MatrixConversion,  //!<
+                     math3d::tup const& Min,                  //!<
+                     math3d::tup const& Max                   //!<
+                     )                                        //!<
+    -> visibility
+{
+   using fluffy::math3d::FLOAT;
+
+   auto const& Levels = Target.Pyramid.Levels;
+   auto const& Depth = Target.Depth;
+   if (Levels.empty()) return visibility::VISIBLE;
+
+   /**
+    * Screen rect of the corners and the range of 1/w they span.
+    */
+   auto XMin = std::numeric_limits<FLOAT>::max();
+   auto YMin = std::numeric_limits<FLOAT>::max();
+   auto XMax = std::numeric_limits<FLOAT>::lowest();
+   auto YMax = std::numeric_limits<FLOAT>::lowest();
+   auto BoxNearest = FLOAT(0);
+   auto BoxFarthest = std::numeric_limits<FLOAT>::max();
+   for (int Corner = 0; Corner < 8; ++Corner)
+   {
+      auto const P = math3d::Point((Corner & 1) ? Max.X : Min.X, (Corner & 2) ? Max.Y : Min.Y,
+                                   (Corner & 4) ? Max.Z : Min.Z);
+      auto const V = ProjectVertice(MatrixConversion, P, {});
+      if (V.W <= math3d::EPSILON) return visibility::VISIBLE;
+
+      XMin = std::min(XMin, V.X);
+      YMin = std::min(YMin, V.Y);
+      XMax = std::max(XMax, V.X);
+      YMax = std::max(YMax, V.Y);
+      BoxNearest = std::max(BoxNearest, 1 / V.W);
+      BoxFarthest = std::min(BoxFarthest, 1 / V.W);
+   }
+
+   /**
+    * Pixel X covers [X, X + 1), so the pixels that can be hit are floor(XMin) .. floor(XMax).
+    */
+   auto const X0 = std::max(FLOAT(0), std::floor(XMin));
+   auto const Y0 = std::max(FLOAT(0), std::floor(YMin));
+   auto const X1 = std::min(FLOAT(Depth.Width - 1), std::floor(XMax));
+   auto const Y1 = std::min(FLOAT(Depth.Height - 1), std::floor(YMax));
+   if (X0 > X1 || Y0 > Y1) return visibility::HIDDEN;
+
+   auto CellX0 = int(X0) / depth_pyramid::TILE;
+   auto CellY0 = int(Y0) / depth_pyramid::TILE;
+   auto CellX1 = int(X1) / depth_pyramid::TILE;
+   auto CellY1 = int(Y1) / depth_pyramid::TILE;
+   size_t L = 0;
+   while (L + 1 < Levels.size() && (CellX1 - CellX0 + 1) * (CellY1 - CellY0 + 1) > depth_pyramid::MAX_CELLS)
+   {
+      CellX0 /= 2, CellY0 /= 2, CellX1 /= 2, CellY1 /= 2;
+      ++L;
+   }
+
+   auto const& Level = Levels[L];
+   bool Hidden = true;
+   bool InFront = true;
+   for (int CellY = CellY0; CellY <= CellY1 && (Hidden || InFront); ++CellY)
+   {
+      for (int CellX = CellX0; CellX <= CellX1; ++CellX)
+      {
+         auto const Cell = size_t(CellY) * size_t(Level.Width) + size_t(CellX);
+         Hidden = Hidden && FLOAT(Level.Farthest[Cell]) > BoxNearest;
+         InFront = InFront && FLOAT(Level.Nearest[Cell]) < BoxFarthest;
+      }
+   }
+
+   if (Hidden) return visibility::HIDDEN;
+   return InFront ? visibility::IN_FRONT : visibility::VISIBLE;
+}
+
+//------------------------------------------------------------------------------
+auto MarkDirty(render_target& Target,  //!<
+               SDL_Rect const& Rect    //!<
+               )                       //!<
+    -> void
+{
+   auto& Dirty = Target.Dirty;
+   if (Target.ptrSurface == nullptr) return;
+
+   auto const Clipped = ClipRect(Rect, Target.ptrSurface->w, Target.ptrSurface->h);
+   if (Clipped.w == 0) return;
+
+   /**
+    * Consecutive primitives are often close to each other, so look from the back.
+    */
+   for (auto It = Dirty.Current.rbegin(); It != Dirty.Current.rend(); ++It)
+   {
+      if (Touches(*It, Clipped))
+      {
+         *It = Union(*It, Clipped);
+         return;
+      }
    }
 
-   if (TextFmt.ptrSurface)
+   if (Dirty.Current.size() < dirty_rects::MAX_RECTS)
    {
-      SDL_BlitSurface(TextFmt.ptrSurface, NULL, screenSurface, &TextFmt.Position);
+      Dirty.Current.push_back(Clipped);
+      return;
    }
+
+   auto Bounds = Clipped;
+   for (auto const& R : Dirty.Current) Bounds = Union(Bounds, R);
+   Dirty.Current.clear();
+   Dirty.Current.push_back(Bounds);
+}
+
+//------------------------------------------------------------------------------
+auto BeginFrame(render_target& Target,  //!<
+                Uint32 ClearColor       //!<
+                )                       //!<
+    -> void
+{
+   auto* ptrSurface = Target.ptrSurface;
+   if (ptrSurface == nullptr) return;
+
+   auto& Dirty = Target.Dirty;
+   std::swap(Dirty.Previous, Dirty.Current);
+   Dirty.Current.clear();
+   ClearDepthPyramid(Target.Pyramid);
+
+   if (Dirty.FullFrame)
+   {
+      SDL_FillSurfaceRect(ptrSurface, NULL, ClearColor);
+      ClearDepthBuffer(Target.Depth);
+      return;
+   }
+
+   for (auto const& Rect : Dirty.Previous)
+   {
+      SDL_FillSurfaceRect(ptrSurface, &Rect, ClearColor);
+      ClearDepthBuffer(Target.Depth, Rect);
+   }
+}
+
+//------------------------------------------------------------------------------
+auto PresentFrame(render_target& Target,  //!<
+                  SDL_Window* ptrWindow   //!<
+                  )                       //!<
+    -> int
+{
+   auto& Dirty = Target.Dirty;
+   if (Target.ptrSurface == nullptr) return SDL_UpdateWindowSurface(ptrWindow);
+
+   if (Dirty.FullFrame)
+   {
+      /**
+       * The whole surface was cleared by BeginFrame(), partial updates can be used from the next frame.
+       */
+      Dirty.FullFrame = false;
+      return SDL_UpdateWindowSurface(ptrWindow);
+   }
+
+   Dirty.Present.clear();
+   Dirty.Present.insert(Dirty.Present.end(), Dirty.Previous.begin(), Dirty.Previous.end());
+   Dirty.Present.insert(Dirty.Present.end(), Dirty.Current.begin(), Dirty.Current.end());
+   if (Dirty.Present.empty()) return 0;
+
+   /**
+    * Pushing many rects that cover most of the window costs more than one full update.
+    */
+   std::size_t Area{};
+   for (auto const& Rect : Dirty.Present) Area += std::size_t(Rect.w) * std::size_t(Rect.h);
+   if (2 * Area > std::size_t(Target.ptrSurface->w) * std::size_t(Target.ptrSurface->h))
+   {
+      return SDL_UpdateWindowSurface(ptrWindow);
+   }
+
+   return SDL_UpdateWindowSurfaceRects(ptrWindow, Dirty.Present.data(), static_cast<int>(Dirty.Present.size()));
+}
+
+//------------------------------------------------------------------------------
+auto CaptureSurface(capture::frame_capture& Capture,  //!<
+                    SDL_Surface* ptrSurface           //!<
+                    )                                 //!<
+    -> bool
+{
+   bool Captured{};
+   DispatchPixelFormat(ptrSurface,
+                       [&](auto Format)
+                       {
+                          Captured = capture::CaptureFrame(Capture, ptrSurface->pixels, ptrSurface->pitch,
+                                                           decltype(Format)::value, ptrSurface->w, ptrSurface->h);
+                       });
+   return Captured;
+}
+
+//------------------------------------------------------------------------------
+auto ProjectVertice(math3d::matrix const& MatrixConversion,  //!<
+                    math3d::tup const& P,                    //!<
+                    math3d::tup const& Col                   //!<
+                    )                                        //!<
+    -> vertice_3d
+{
+   auto const V = MatrixConversion * P;
+   return vertice_3d{V.X, V.Y, V.W, Col};
+}
+
+namespace
+{
+//------------------------------------------------------------------------------
+template <pixel_format FORMAT>
+auto FillTriangleAs(SDL_Surface* screenSurface,  //!<
+                    vertice_2d const& V0,        //!<
+                    vertice_2d const& V1,        //!<
+                    vertice_2d const& V2,        //!<
+                    Uint32 Color,                //!<
+                    bool UseColorGradient        //!<
+                    )                            //!<
+    -> void
+{
+   /**
+    * Snap to 1/16 pixel so the edge functions are exact integers. A zero area is then really zero,
+    * and the top-left rule decides who owns pixels exactly on an edge shared with a neighbour.
+    */
+   auto const F0 = ToFixed(V0);
+   auto const F1 = ToFixed(V1);
+   auto const F2 = ToFixed(V2);
+
+   auto const AreaParallelPiped = EdgeCross(F0, F1, F2);
+   if (AreaParallelPiped <= 0) return;  // degenerate or facing away.
+
+   /** Pixels on an edge that is not top-left have W == 0 and are pushed out by the bias. */
+   int64_t const Bias0 = IsTopLeft(F1, F2) ? 0 : -1;
+   int64_t const Bias1 = IsTopLeft(F0, F1) ? 0 : -1;
+   int64_t const Bias2 = IsTopLeft(F2, F0) ? 0 : -1;
+
+   /**
+    * The edge functions are linear in X, so they are stepped with one add per pixel.
+    * The gradient channels are the barycentric weights scaled to 0..255 in 16.16 fixed point.
+    */
+   constexpr int64_t ONE = vertice_2d_fx::ONE;
+   auto const W0StepX = int64_t(F1.Y - F2.Y) * ONE;
+   auto const W1StepX = int64_t(F0.Y - F1.Y) * ONE;
+   auto const W2StepX = int64_t(F2.Y - F0.Y) * ONE;
+
+   /**
+    * The channels start at the first covered pixel of a row, where each weight is in 0..Area,
+    * and not at the bounding box where a thin triangle has weights far outside the int32 range.
+    * The covered pixels of a row are contiguous and their weights stay in 0..Area, so a step
+    * larger than the full channel range means there is at most one covered pixel in the row,
+    * and the step is never used. Clamped like that, the steps and the channels fit in 32 bits.
+    */
+   constexpr fluffy::math3d::FLOAT FULL = 0xFF << 16;
+   auto const Scale = FULL / fluffy::math3d::FLOAT(AreaParallelPiped);
+   auto ToChannel = [Scale](int64_t W) -> int32_t { return static_cast<int32_t>(fluffy::math3d::FLOAT(W) * Scale); };
+   auto ToStep = [Scale, FULL](int64_t WStepX) -> int32_t
+   { return static_cast<int32_t>(std::clamp(fluffy::math3d::FLOAT(WStepX) * Scale, -FULL, FULL)); };
+   auto const RStepX = UseColorGradient ? ToStep(W0StepX) : 0;
+   auto const GStepX = UseColorGradient ? ToStep(W1StepX) : 0;
+   auto const BStepX = UseColorGradient ? ToStep(W2StepX) : 0;
+
+   /** Clamp to 255.99 so rounding at the edges never spills into the next channel. */
+   auto Channel = [](int32_t Value) -> Uint32 { return Uint32(std::clamp(Value, 0, 0xFFFFFF) >> 16); };
+
+   /**
+    * Pixels are sampled at their integer coordinate. The bounding box is rounded inwards to the
+    * samples it covers, the shift rounds towards minus infinity.
+    */
+   constexpr int SHIFT = vertice_2d_fx::SUBPIXEL_BITS;
+   auto const YBegin = std::max((std::min({F0.Y, F1.Y, F2.Y}) + ONE - 1) >> SHIFT, int64_t(0));
+   auto const YEnd = std::min(int64_t(std::max({F0.Y, F1.Y, F2.Y}) >> SHIFT), int64_t(screenSurface->h) - 1);
+   auto const XBegin = std::max((std::min({F0.X, F1.X, F2.X}) + ONE - 1) >> SHIFT, int64_t(0));
+   auto const XEnd = std::min(int64_t(std::max({F0.X, F1.X, F2.X}) >> SHIFT), int64_t(screenSurface->w) - 1);
+
+   for (auto Y = YBegin; Y <= YEnd; ++Y)
+   {
+      bool InsideDetected{};
+      auto* ptrRow = PixelRow<FORMAT>(screenSurface, int(Y));
+
+      auto X = XBegin;
+      vertice_2d_fx const P{static_cast<int32_t>(X * ONE), static_cast<int32_t>(Y * ONE)};
+
+      /** Find cross products between the edges and the point P. These are the Barycentric weights. */
+      auto W0 = EdgeCross(F1, F2, P);
+      auto W1 = EdgeCross(F0, F1, P);
+      auto W2 = EdgeCross(F2, F0, P);
+
+      int32_t R{}, G{}, B{};
+
+      for (; X <= XEnd; ++X)
+      {
+         if ((W0 + Bias0) >= 0 && (W1 + Bias1) >= 0 && (W2 + Bias2) >= 0)  // then point is on the inside
+         {
+            if (UseColorGradient)
+            {
+               if (!InsideDetected)
+               {
+                  R = ToChannel(W0);
+                  G = ToChannel(W1);
+                  B = ToChannel(W2);
+               }
+               Color = Channel(R) << 16 | Channel(G) << 8 | Channel(B);
+               R += RStepX;
+               G += GStepX;
+               B += BStepX;
+            }
+            InsideDetected = true;
+            ptrRow[X] = pixel_traits<FORMAT>::Encode(Color);
+         }
+         else if (InsideDetected)  // break to do the next Y.
+         {
+            break;
+         }
+
+         W0 += W0StepX;
+         W1 += W1StepX;
+         W2 += W2StepX;
+      }
+   }
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto FillTriangle(SDL_Surface* screenSurface,  //!<
+                  vertice_2d const& V0,        //!<
+                  vertice_2d const& V1,        //!<
+                  vertice_2d const& V2,        //!<
+                  Uint32 Color,                //!<
+                  bool UseColorGradient        //!<
+                  )                            //!<
+    -> void
+{
+   DispatchPixelFormat(
+       screenSurface, [&](auto Format)
+       { FillTriangleAs<decltype(Format)::value>(screenSurface, V0, V1, V2, Color, UseColorGradient); });
+}
+
+namespace
+{
+//------------------------------------------------------------------------------
+template <pixel_format FORMAT>
+auto DrawTriangleAs(render_target& Target,  //!<
+                    vertice_3d const& V0,   //!<
+                    vertice_3d const& V1,   //!<
+                    vertice_3d const& V2    //!<
+                    )                       //!<
+    -> bool
+{
+   using fluffy::math3d::FLOAT;
+
+   auto* ptrSurface = Target.ptrSurface;
+   auto& Depth = Target.Depth;
+   if (ptrSurface == nullptr || Depth.Data.empty()) return false;
+   if (V0.W <= FLOAT(0) || V1.W <= FLOAT(0) || V2.W <= FLOAT(0)) return false;
+
+   /**
+    * Order the vertices counter clockwise so that the edge functions are positive on the inside.
+    */
+   vertice_3d const* pV[3] = {&V0, &V1, &V2};
+   auto Area = EdgeCross(vertice_2d{V0.X, V0.Y}, vertice_2d{V1.X, V1.Y}, vertice_2d{V2.X, V2.Y});
+   if (std::abs(Area) <= fluffy::math3d::EPSILON) return false;
+   if (Area < 0)
+   {
+      std::swap(pV[1], pV[2]);
+      Area = -Area;
+   }
+
+   /**
+    * Edge k is opposite to vertice k, written as E(x,y) = A * x + B * y + C.
+    * The barycentric weight of vertice k is E_k / Area.
+    */
+   FLOAT EA[3]{}, EB[3]{}, EC[3]{};
+   for (int k = 0; k < 3; ++k)
+   {
+      auto const& Va = *pV[(k + 1) % 3];
+      auto const& Vb = *pV[(k + 2) % 3];
+      EA[k] = Va.Y - Vb.Y;
+      EB[k] = Vb.X - Va.X;
+      EC[k] = -EA[k] * Va.X - EB[k] * Va.Y;
+   }
+
+   /**
+    * 1/w and Col/w are affine in screen space. Set up the plane equation
+    * f(x,y) = fx * x + fy * y + f0 for each of them.
+    */
+   struct plane
+   {
+      FLOAT Fx{}, Fy{}, F0{};
+      auto At(FLOAT X, FLOAT Y) const -> FLOAT { return Fx * X + Fy * Y + F0; }
+   };
+
+   auto MakePlane = [&](FLOAT F0, FLOAT F1, FLOAT F2) -> plane
+   {
+      FLOAT const F[3] = {F0, F1, F2};
+      plane Plane{};
+      for (int k = 0; k < 3; ++k)
+      {
+         Plane.Fx += EA[k] * F[k] / Area;
+         Plane.Fy += EB[k] * F[k] / Area;
+         Plane.F0 += EC[k] * F[k] / Area;
+      }
+      return Plane;
+   };
+
+   FLOAT const InvW[3] = {1 / pV[0]->W, 1 / pV[1]->W, 1 / pV[2]->W};
+   auto const PlaneInvW = MakePlane(InvW[0], InvW[1], InvW[2]);
+   auto const PlaneR = MakePlane(pV[0]->Col.R * InvW[0], pV[1]->Col.R * InvW[1], pV[2]->Col.R * InvW[2]);
+   auto const PlaneG = MakePlane(pV[0]->Col.G * InvW[0], pV[1]->Col.G * InvW[1], pV[2]->Col.G * InvW[2]);
+   auto const PlaneB = MakePlane(pV[0]->Col.B * InvW[0], pV[1]->Col.B * InvW[1], pV[2]->Col.B * InvW[2]);
+
+   /**
+    * Clip the bounding box to the surface and the depth buffer.
+    */
+   auto const BB = BoundingBox({V0.X, V0.Y}, {V1.X, V1.Y}, {V2.X, V2.Y});
+   auto const Width = std::min(ptrSurface->w, Depth.Width);
+   auto const Height = std::min(ptrSurface->h, Depth.Height);
+   auto const YMin = std::max(0, static_cast<int>(std::floor(BB.Min.Y)));
+   auto const YMax = std::min(Height - 1, static_cast<int>(std::ceil(BB.Max.Y)));
+   auto const XMinBB = std::max(0, static_cast<int>(std::floor(BB.Min.X)));
+   auto const XMaxBB = std::min(Width - 1, static_cast<int>(std::ceil(BB.Max.X)));
+   if (YMin > YMax || XMinBB > XMaxBB) return false;
+
+   MarkDirty(Target, SDL_Rect{XMinBB, YMin, XMaxBB - XMinBB + 1, YMax - YMin + 1});
+
+   auto const NumBlocks = (Depth.Width + depth_buffer::SPAN_BLOCK - 1) / depth_buffer::SPAN_BLOCK;
+
+   bool Rasterized{};
+   auto ToByte = [](FLOAT C) -> Uint32 { return Uint32(std::clamp(C, FLOAT(0), FLOAT(1)) * FLOAT(0xFF)); };
+
+   for (int Y = YMin; Y <= YMax; ++Y)
+   {
+      /**
+       * Sample at the pixel centers. Solve E_k(x) >= 0 for each edge to find the span.
+       */
+      auto const Yc = FLOAT(Y) + FLOAT(0.5);
+      int XL = XMinBB;
+      int XR = XMaxBB;
+      for (int k = 0; k < 3 && XL <= XR; ++k)
+      {
+         auto const RowC = EB[k] * Yc + EC[k];
+         if (EA[k] > 0)
+            XL = std::max(XL, static_cast<int>(std::ceil(-RowC / EA[k] - FLOAT(0.5))));
+         else if (EA[k] < 0)
+            XR = std::min(XR, static_cast<int>(std::floor(-RowC / EA[k] - FLOAT(0.5))));
+         else if (RowC < 0)
+            XR = XL - 1;
+      }
+      if (XL > XR) continue;
+      Rasterized = true;
+
+      auto* ptrDepthRow = &Depth.Data[size_t(Y) * size_t(Depth.Width)];
+      auto* ptrFarthestRow = &Depth.Farthest[size_t(Y) * size_t(NumBlocks)];
+      auto* ptrPixelRow = PixelRow<FORMAT>(ptrSurface, Y);
+
+      /**
+       * Walk the span one depth block at the time.
+       */
+      int X = XL;
+      while (X <= XR)
+      {
+         auto const Block = X / depth_buffer::SPAN_BLOCK;
+         auto const XEnd = std::min(XR, (Block + 1) * depth_buffer::SPAN_BLOCK - 1);
+
+         auto const Xc = FLOAT(X) + FLOAT(0.5);
+         auto const InvWBegin = PlaneInvW.At(Xc, Yc);
+         auto const InvWEnd = InvWBegin + PlaneInvW.Fx * FLOAT(XEnd - X);
+
+         /**
+          * Early depth rejection. 1/w is linear along the span so the closest point is at one of the ends.
+          */
+         if (float(std::max(InvWBegin, InvWEnd)) <= ptrFarthestRow[Block])
+         {
+            X = XEnd + 1;
+            continue;
+         }
+
+         FLOAT IW = InvWBegin;
+         FLOAT R = PlaneR.At(Xc, Yc);
+         FLOAT G = PlaneG.At(Xc, Yc);
+         FLOAT B = PlaneB.At(Xc, Yc);
+         bool Written{};
+
+         for (; X <= XEnd; ++X)
+         {
+            if (float(IW) > ptrDepthRow[X])
+            {
+               ptrDepthRow[X] = float(IW);
+               auto const W = FLOAT(1) / IW;
+               ptrPixelRow[X] = pixel_traits<FORMAT>::Encode(ToByte(R * W) << 16 | ToByte(G * W) << 8 | ToByte(B * W));
+               Written = true;
+            }
+            IW += PlaneInvW.Fx;
+            R += PlaneR.Fx;
+            G += PlaneG.Fx;
+            B += PlaneB.Fx;
+         }
+
+         /**
+          * Refresh the farthest value of the block after it has been written to.
+          */
+         if (Written)
+         {
+            auto const BlockBegin = Block * depth_buffer::SPAN_BLOCK;
+            auto const BlockEnd = std::min(Depth.Width, BlockBegin + depth_buffer::SPAN_BLOCK);
+            ptrFarthestRow[Block] = *std::min_element(ptrDepthRow + BlockBegin, ptrDepthRow + BlockEnd);
+         }
+      }
+   }
+   return Rasterized;
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto DrawTriangle(render_target& Target,  //!<
+                  vertice_3d const& V0,   //!<
+                  vertice_3d const& V1,   //!<
+                  vertice_3d const& V2    //!<
+                  )                       //!<
+    -> void
+{
+   bool Rasterized{};
+   DispatchPixelFormat(Target.ptrSurface, [&](auto Format)
+                       { Rasterized = DrawTriangleAs<decltype(Format)::value>(Target, V0, V1, V2); });
+   if (Rasterized) ++Target.NumPrimitives;
+}
+
+//------------------------------------------------------------------------------
+auto CreateGlyphAtlas(TTF_Font* ptrFont) -> glyph_atlas
+{
+   glyph_atlas Atlas{};
+   if (ptrFont == nullptr) return Atlas;
+
+   Atlas.ptrFont = ptrFont;
+
+   /**
+    * Render each glyph once as if it was a one character string.
+    * The cells are placed next to each other along a single row in the mask.
+    */
+   SDL_Surface* vGlyphSurface[glyph_atlas::NUM_GLYPHS]{};
+   SDL_Color const White{255, 255, 255, 255};
+
+   for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+   {
+      auto const CodePoint = glyph_atlas::FIRST_GLYPH + Idx;
+      auto& Glyph = Atlas.Glyphs[Idx];
+
+      int MinX{}, MaxX{}, MinY{}, MaxY{}, Advance{};
+      if (TTF_GlyphMetrics32(ptrFont, CodePoint, &MinX, &MaxX, &MinY, &MaxY, &Advance) == 0)
+      {
+         Glyph.OffsetX = std::min(0, MinX);
+         Glyph.Advance = Advance;
+      }
+
+      vGlyphSurface[Idx] = TTF_RenderGlyph32_Solid(ptrFont, CodePoint, White);
+      if (vGlyphSurface[Idx] == nullptr) continue;
+
+      Glyph.X = Atlas.Width;
+      Glyph.W = vGlyphSurface[Idx]->w;
+      Glyph.H = vGlyphSurface[Idx]->h;
+      Atlas.Width += Glyph.W;
+      Atlas.Height = std::max(Atlas.Height, Glyph.H);
+   }
+
+   /**
+    * Copy the coverage into the mask. Solid glyphs are 8 bit with index 0 as the background.
+    */
+   Atlas.Mask.assign(size_t(Atlas.Width) * size_t(Atlas.Height), 0);
+   for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+   {
+      auto* ptrSurface = vGlyphSurface[Idx];
+      if (ptrSurface == nullptr) continue;
+
+      auto const& Glyph = Atlas.Glyphs[Idx];
+      auto const BytesPerPixel = ptrSurface->format->BytesPerPixel;
+      for (int Y = 0; Y < Glyph.H; ++Y)
+      {
+         auto const* ptrRow = static_cast<Uint8 const*>(ptrSurface->pixels) + Y * ptrSurface->pitch;
+         for (int X = 0; X < Glyph.W; ++X)
+         {
+            bool Covered{};
+            if (BytesPerPixel == 1)
+               Covered = ptrRow[X] != 0;
+            else
+               Covered = reinterpret_cast<Uint32 const*>(ptrRow)[X] != 0;
+            Atlas.Mask[size_t(Glyph.Y + Y) * size_t(Atlas.Width) + size_t(Glyph.X + X)] = Covered;
+         }
+      }
+
+      SDL_DestroySurface(ptrSurface);
+   }
+
+   /**
+    * Look up the kerning for all pairs up front.
+    */
+   Atlas.Kerning.assign(size_t(glyph_atlas::NUM_GLYPHS) * glyph_atlas::NUM_GLYPHS, 0);
+   if (TTF_GetFontKerning(ptrFont))
+   {
+      for (int Prv = 0; Prv < glyph_atlas::NUM_GLYPHS; ++Prv)
+      {
+         for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+         {
+            Atlas.Kerning[Prv * glyph_atlas::NUM_GLYPHS + Idx] = static_cast<Sint16>(TTF_GetFontKerningSizeGlyphs32(
+                ptrFont, glyph_atlas::FIRST_GLYPH + Prv, glyph_atlas::FIRST_GLYPH + Idx));
+         }
+      }
+   }
+
+   return Atlas;
+}
+
+//-----------------------------------------------------------------------------
+auto Text(SDL_Surface* screenSurface,  //!<
+          text_fmt& TextFmt            //!<
+          )                            //!<
+    -> void
+{
+   DrawText(screenSurface, TextFmt);
+}
+
+//------------------------------------------------------------------------------
+auto Text(render_target& Target,  //!<
+          text_fmt& TextFmt       //!<
+          )                       //!<
+    -> void
+{
+   if (Target.ptrSurface == nullptr) return;
+   MarkDirty(Target, DrawText(Target.ptrSurface, TextFmt));
+   ++Target.NumPrimitives;
 }
 
 //------------------------------------------------------------------------------
@@ -131,7 +1519,7 @@ std::string GetResourcePath(const std::string& subDir = "")
    if (basePath)
    {
       std::string StrBasePath(basePath);
-      std::cout << __PRETTY_FUNCTION__ << " -> basePath:" << StrBasePath << std::endl;
+      SDL_Log("%s -> basePath: %s", __PRETTY_FUNCTION__, StrBasePath.c_str());
       ResourceBasePath = StrBasePath;
 
       SDL_free(basePath);
@@ -159,26 +1547,6 @@ std::string GetResourcePath(const std::string& subDir = "")
    // If a subdirectory is specified, append it to the base path
    return subDir.empty() ? ResourceBasePath : ResourceBasePath + subDir + "/";
 }
-
-/**
- * Do a Linear Interpolation between two colors.
- */
-uint32_t LerpColor(uint32_t Color1, uint32_t Color2, float t)
-{
-   uint8_t R1 = (Color1 >> 16) & 0xFF;
-   uint8_t G1 = (Color1 >> 8) & 0xFF;
-   uint8_t B1 = Color1 & 0xFF;
-
-   uint8_t R2 = (Color2 >> 16) & 0xFF;
-   uint8_t G2 = (Color2 >> 8) & 0xFF;
-   uint8_t B2 = Color2 & 0xFF;
-
-   uint8_t R = R1 + (R2 - R1) * t;
-   uint8_t G = G1 + (G2 - G1) * t;
-   uint8_t B = B1 + (B2 - B1) * t;
-
-   return (R << 16) | (G << 8) | B;
-}
 };  // end of namespace render
 };  // end of namespace fluffy
 
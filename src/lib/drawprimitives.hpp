@@ -10,16 +10,57 @@
 #include <SDL3_ttf/SDL_ttf.h>
 
 #include <iostream>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "blend.hpp"
 #include "fluffymath.hpp"
+#include "framecapture.hpp"
+#include "pixelformat.hpp"
+#include "textbuffer.hpp"
 #include "triangle2d.hpp"
 
 namespace fluffy
 {
 namespace render
 {
+/**
+ * Largest radius with a precomputed stamp in DrawPoints(). Larger radii are clamped.
+ */
+constexpr int MAX_POINT_RADIUS = 64;
+
+/**
+ * Glyphs for a font rasterized once into a coverage mask.
+ * NOTE: A TTF_Font is opened at one point size, so the atlas is per font and per size.
+ *       Create a new atlas when the font size is changed.
+ */
+struct glyph_atlas
+{
+   static constexpr Uint32 FIRST_GLYPH = 32;     //!< Space.
+   static constexpr Uint32 LAST_GLYPH = 126;     //!< Tilde.
+   static constexpr Uint32 MISSING_GLYPH = '?';  //!< Used for code points outside the atlas.
+   static constexpr int NUM_GLYPHS = LAST_GLYPH - FIRST_GLYPH + 1;
+
+   struct glyph
+   {
+      int X{};        //!< Position of the glyph cell in the mask.
+      int Y{};        //!<
+      int W{};        //!< Size of the glyph cell.
+      int H{};        //!<
+      int OffsetX{};  //!< Offset from the pen position to the left side of the cell.
+      int Advance{};  //!< Pen movement after the glyph is drawn.
+   };
+
+   TTF_Font* ptrFont{nullptr};     //!< Not owned by the atlas.
+   int Width{};                    //!< Width of the mask.
+   int Height{};                   //!< Height of the mask, i.e the tallest glyph cell.
+   std::vector<Uint8> Mask{};      //!< Width * Height bytes, non zero where a glyph has coverage.
+   glyph Glyphs[NUM_GLYPHS]{};     //!<
+   std::vector<Sint16> Kerning{};  //!< NUM_GLYPHS * NUM_GLYPHS adjustments, indexed [Previous][Current].
+};
+
 struct text_fmt
 {
    text_fmt(){};
@@ -33,21 +74,162 @@ struct text_fmt
       }
    };
 
-   std::string Text{};                //!< Consider using a buffer to avoid runtime memory allocations.
+   text_buffer Text{};                //!< Fixed capacity, so updating the text does not allocate.
    SDL_Rect Position{};               //!<
    SDL_Color Color{255, 255, 255};    //!<
    SDL_Surface* ptrSurface{nullptr};  //!< Text() will allocate as needed.
    TTF_Font* ptrFont{nullptr};        //!< Must point to valid font when using the Text() function.
+   glyph_atlas const* ptrAtlas{};     //!< When set, Text() blits glyphs from the atlas and ignores ptrFont.
    bool Dirty{true};                  //!< Set when text has changed.
    bool UseColorGradient{};           //!<
 };
 
+/**
+ * Depth buffer used for per pixel visibility.
+ * NOTE: The buffer stores 1/w where w is the view space depth. 1/w is linear in screen
+ *       space, so it can be stepped along a span without divides. Larger values are
+ *       closer to the viewer and the buffer is cleared to 0, i.e infinitely far away.
+ */
+struct depth_buffer
+{
+   static constexpr int SPAN_BLOCK = 16;  //!< Pixels per block used for early depth rejection.
+
+   int Width{};                    //!<
+   int Height{};                   //!<
+   std::vector<float> Data{};      //!< Width * Height values of 1/w.
+   std::vector<float> Farthest{};  //!< Per row and SPAN_BLOCK: smallest 1/w stored in the block.
+};
+
+/**
+ * Min/max pyramid over the depth buffer, for testing whole objects before they are drawn.
+ * Level 0 has a cell per TILE x TILE pixels, and each next level halves the cells down to one.
+ * Like the depth buffer it holds 1/w, so Farthest is the smallest and Nearest the largest value.
+ */
+struct depth_pyramid
+{
+   static constexpr int TILE = 8;        //!< Pixels per side of a level 0 cell.
+   static constexpr int MAX_CELLS = 16;  //!< Cells read per test, the level is picked to match.
+
+   struct level
+   {
+      int Width{};                    //!< In cells.
+      int Height{};                   //!<
+      std::vector<float> Farthest{};  //!< Smallest 1/w in the cell.
+      std::vector<float> Nearest{};   //!< Largest 1/w in the cell.
+   };
+
+   std::vector<level> Levels{};  //!< Sized by InitRenderTarget().
+};
+
+/**
+ * Result of TestBoundingBox().
+ */
+enum class visibility
+{
+   HIDDEN = 0,    //!< Outside the surface, or behind the depth buffer everywhere it covers.
+   VISIBLE = 1,   //!< May be visible, draw it with depth test.
+   IN_FRONT = 2,  //!< In front of everything drawn where it covers, e.g nothing drawn there yet.
+};
+
+/**
+ * Regions of the surface touched by the primitives drawn through a render_target.
+ * Rects that overlap are merged, and when there are more than MAX_RECTS they are
+ * collapsed into their bounding box, so the lists stay short and never reallocate.
+ */
+struct dirty_rects
+{
+   static constexpr std::size_t MAX_RECTS = 64;  //!<
+
+   std::vector<SDL_Rect> Current{};   //!< Touched by the frame being drawn.
+   std::vector<SDL_Rect> Previous{};  //!< Touched by the frame before. Cleared by BeginFrame().
+   std::vector<SDL_Rect> Present{};   //!< Scratch list for PresentFrame().
+   bool FullFrame{true};              //!< Clear and present the whole surface, e.g after a resize.
+};
+
+/**
+ * The surface to draw on together with the buffers attached to it.
+ */
+struct render_target
+{
+   SDL_Surface* ptrSurface{nullptr};  //!< Not owned by the render target.
+   depth_buffer Depth{};              //!< Sized to match the surface by InitRenderTarget().
+   depth_pyramid Pyramid{};           //!< Updated from Depth by UpdateDepthPyramid().
+   dirty_rects Dirty{};               //!<
+   std::uint64_t NumPrimitives{};     //!< Lines, circles, triangles, texts and points drawn. For benchmarks.
+};
+
+/**
+ * A vertice after projection to the screen.
+ * X and Y are in pixels while W is the view space depth that math3d::Mul() leaves
+ * in W after the perspective divide.
+ */
+struct vertice_3d
+{
+   math3d::FLOAT X{};            //!<
+   math3d::FLOAT Y{};            //!<
+   math3d::FLOAT W{};            //!<
+   math3d::tup Col{1, 1, 1, 0};  //!< R, G, B in the range 0..1.
+};
+
 //-----------------------------------------------------------------------------
+/**
+ * Call Fn with the pixel format of the surface as a std::integral_constant, so that Fn can
+ * instantiate a raster loop for that format once per draw call, e.g
+ *    DispatchPixelFormat(ptrSurface, [&](auto Format) { Loop<decltype(Format)::value>(...); });
+ * Other 32 bit formats are drawn as XRGB8888, i.e the colors are written as is.
+ * Surfaces with any other format are not drawn on.
+ */
+template <typename FN>
+auto DispatchPixelFormat(SDL_Surface* ptrSurface, FN&& Fn) -> void
+{
+   if (ptrSurface == nullptr || ptrSurface->format == nullptr) return;
+
+   switch (ptrSurface->format->format)
+   {
+      case SDL_PIXELFORMAT_ARGB8888:
+         Fn(std::integral_constant<pixel_format, pixel_format::ARGB8888>{});
+         break;
+      case SDL_PIXELFORMAT_RGB565:
+         Fn(std::integral_constant<pixel_format, pixel_format::RGB565>{});
+         break;
+      case SDL_PIXELFORMAT_INDEX8:
+         Fn(std::integral_constant<pixel_format, pixel_format::INDEX8>{});
+         break;
+      default:
+         if (ptrSurface->format->BytesPerPixel == 4)
+         {
+            Fn(std::integral_constant<pixel_format, pixel_format::XRGB8888>{});
+         }
+         break;
+   }
+}
+
+/**
+ * First pixel of row Y. Rows are pitch bytes apart, which may be more than w pixels.
+ */
+template <pixel_format FORMAT>
+auto PixelRow(SDL_Surface* ptrSurface, int Y) -> typename pixel_traits<FORMAT>::pixel_t*
+{
+   using pixel_t = typename pixel_traits<FORMAT>::pixel_t;
+   return reinterpret_cast<pixel_t*>(static_cast<Uint8*>(ptrSurface->pixels) + Y * ptrSurface->pitch);
+}
+
+/**
+ * Load the 3-3-2 palette used for INDEX8 surfaces. Returns 0 on success like the SDL functions.
+ */
+auto SetPalette332(SDL_Surface* ptrSurface) -> int;
+
+//-----------------------------------------------------------------------------
+/**
+ * NOTE: With blend_mode::ALPHA or ADDITIVE the alpha is read from the top byte of Color.
+ *       Color is 0xAARRGGBB and is converted to the format of the surface.
+ */
 auto DrawLine(SDL_Surface* screenSurface,            //!<
               fluffy::render::vertice_2d const& V0,  //!<
               fluffy::render::vertice_2d const& V1,  //!<
               Uint32 Color,                          //!<
-              bool UseColorGradient                  //!<
+              bool UseColorGradient,                 //!<
+              blend_mode Blend = blend_mode::OPAQUE  //!<
               )                                      //!<
     -> void;
 
@@ -56,25 +238,233 @@ auto DrawCircle(SDL_Surface* screenSurface,                //!<
                 fluffy::render::vertice_2d const& Center,  //!<
                 fluffy::math3d::FLOAT Radius,              //!<
                 Uint32 Color,                              //!<
-                bool UseColorGradient                      //!<
+                bool UseColorGradient,                     //!<
+                blend_mode Blend = blend_mode::OPAQUE      //!<
                 )                                          //!<
     -> void;
 
+/**
+ * Same as the SDL_Surface versions, but the touched region is recorded with MarkDirty().
+ */
+auto DrawLine(render_target& Target,                 //!<
+              fluffy::render::vertice_2d const& V0,  //!<
+              fluffy::render::vertice_2d const& V1,  //!<
+              Uint32 Color,                          //!<
+              bool UseColorGradient,                 //!<
+              blend_mode Blend = blend_mode::OPAQUE  //!<
+              )                                      //!<
+    -> void;
+
+auto DrawCircle(render_target& Target,                     //!<
+                fluffy::render::vertice_2d const& Center,  //!<
+                fluffy::math3d::FLOAT Radius,              //!<
+                Uint32 Color,                              //!<
+                bool UseColorGradient,                     //!<
+                blend_mode Blend = blend_mode::OPAQUE      //!<
+                )                                          //!<
+    -> void;
+
+//-----------------------------------------------------------------------------
+/**
+ * Draw filled discs with the same radius at all the Points.
+ * The disc is a precomputed stamp of spans per radius, so a point costs a few span writes.
+ * Colors holds either one color used for all points, or one color per point.
+ * Points that are entirely outside the clip rect are rejected before any pixel is touched.
+ */
+auto DrawPoints(SDL_Surface* screenSurface,            //!<
+                std::span<vertice_2d const> Points,    //!<
+                int Radius,                            //!< 0 draws single pixels.
+                std::span<Uint32 const> Colors,        //!<
+                blend_mode Blend = blend_mode::OPAQUE  //!<
+                )                                      //!<
+    -> void;
+
+auto DrawPoints(render_target& Target,                 //!<
+                std::span<vertice_2d const> Points,    //!<
+                int Radius,                            //!<
+                std::span<Uint32 const> Colors,        //!<
+                blend_mode Blend = blend_mode::OPAQUE  //!<
+                )                                      //!<
+    -> void;
+
+//-----------------------------------------------------------------------------
+/**
+ * Draw a line for each pair of indices in Edges between the Vertices, all in one call.
+ * The lines are clipped to the surface, and edges with a vertex behind the eye (W <= 0) are skipped.
+ * The color gradient is the same as for DrawLine() on the whole edge, also when it is clipped.
+ * Edges are drawn as given, see DeduplicateEdges() in mesh.hpp for meshes.
+ * Returns the number of edges drawn.
+ */
+auto DrawEdges(SDL_Surface* screenSurface,            //!<
+               std::span<vertice_3d const> Vertices,  //!< E.g from TransformMesh().
+               std::span<uint32_t const> Edges,       //!< Two indices per edge.
+               Uint32 Color,                          //!<
+               bool UseColorGradient,                 //!<
+               blend_mode Blend = blend_mode::OPAQUE  //!<
+               )                                      //!<
+    -> std::size_t;
+
+auto DrawEdges(render_target& Target,                 //!<
+               std::span<vertice_3d const> Vertices,  //!<
+               std::span<uint32_t const> Edges,       //!<
+               Uint32 Color,                          //!<
+               bool UseColorGradient,                 //!<
+               blend_mode Blend = blend_mode::OPAQUE  //!<
+               )                                      //!<
+    -> std::size_t;
+
+//-----------------------------------------------------------------------------
+/**
+ * Attach a render target to a surface. The depth buffer is (re)allocated when
+ * the size of the surface has changed and is then cleared.
+ */
+auto InitRenderTarget(render_target& Target,      //!<
+                      SDL_Surface* screenSurface  //!<
+                      )                           //!<
+    -> void;
+
+auto ClearDepthBuffer(depth_buffer& Depth) -> void;
+
+/**
+ * Clear the part of the depth buffer covered by Rect.
+ * The farthest value of the blocks overlapping Rect is reset as well.
+ */
+auto ClearDepthBuffer(depth_buffer& Depth,  //!<
+                      SDL_Rect const& Rect  //!<
+                      )                     //!<
+    -> void;
+
+//-----------------------------------------------------------------------------
+/**
+ * Bring the depth pyramid up to date with the depth buffer. Only the cells under the regions
+ * drawn in this frame are recomputed, BeginFrame() resets the rest.
+ * Call it after the occluders are drawn and before the objects behind them are tested.
+ * NOTE: The pyramid is only conservative for depth written through the render target. After
+ *       a ClearDepthBuffer() call outside BeginFrame() it must not be used until the next frame.
+ */
+auto UpdateDepthPyramid(render_target& Target) -> void;
+
+/**
+ * Test the box from Min to Max against the depth pyramid, without drawing anything.
+ * MatrixConversion is the one given to TransformMesh(), so the box is in model coordinates.
+ * The eight corners are projected, and the screen rect around them at their nearest depth is
+ * compared with the finest level that covers it in at most MAX_CELLS cells.
+ * Boxes that reach behind the eye (W <= 0) are always VISIBLE.
+ */
+auto TestBoundingBox(render_target const& Target,             //!<
+                     math3d::matrix const& MatrixConversion,  //!<
+                     math3d::tup const& Min,                  //!<
+                     math3d::tup const& Max                   //!<
+                     )                                        //!<
+    -> visibility;
+
+//-----------------------------------------------------------------------------
+/**
+ * Record that Rect of the surface has been drawn to in this frame. Rect is clipped to the surface.
+ */
+auto MarkDirty(render_target& Target,  //!<
+               SDL_Rect const& Rect    //!<
+               )                       //!<
+    -> void;
+
+/**
+ * Start a new frame. Only the regions drawn in the previous frame are cleared to ClearColor,
+ * both on the surface and in the depth buffer. The depth pyramid is reset.
+ * NOTE: Everything must be drawn through the render_target overloads, anything drawn
+ *       directly on the surface is not tracked and will not be cleared.
+ */
+auto BeginFrame(render_target& Target,  //!<
+                Uint32 ClearColor       //!<
+                )                       //!<
+    -> void;
+
+/**
+ * Copy the regions drawn in this frame and the regions cleared by BeginFrame() to the window.
+ * Falls back to SDL_UpdateWindowSurface() when most of the surface is dirty.
+ * Returns 0 on success like the SDL functions.
+ */
+auto PresentFrame(render_target& Target,  //!<
+                  SDL_Window* ptrWindow   //!<
+                  )                       //!<
+    -> int;
+
+/**
+ * Queue the pixels of the surface for the capture writer. The surface must be locked if
+ * SDL_MUSTLOCK() says so. Returns false if the frame was dropped.
+ */
+auto CaptureSurface(capture::frame_capture& Capture,  //!<
+                    SDL_Surface* ptrSurface           //!<
+                    )                                 //!<
+    -> bool;
+
+/**
+ * Project a point with the combined screen and projection matrix.
+ */
+auto ProjectVertice(math3d::matrix const& MatrixConversion,  //!<
+                    math3d::tup const& P,                    //!<
+                    math3d::tup const& Col                   //!<
+                    )                                        //!<
+    -> vertice_3d;
+
+//-----------------------------------------------------------------------------
+/**
+ * Fill a clockwise triangle without depth test. The vertices are snapped to 1/16 pixel and the
+ * integer edge functions are stepped with one add per pixel. Pixels on an edge follow the top-left
+ * rule, so meshes are drawn without gaps or double hits along shared edges.
+ * With UseColorGradient the color is the barycentric weights as red, green and blue.
+ */
+auto FillTriangle(SDL_Surface* screenSurface,  //!<
+                  vertice_2d const& V0,        //!<
+                  vertice_2d const& V1,        //!<
+                  vertice_2d const& V2,        //!<
+                  Uint32 Color,                //!<
+                  bool UseColorGradient        //!<
+                  )                            //!<
+    -> void;
+
+//-----------------------------------------------------------------------------
+/**
+ * Draw a filled triangle with depth test.
+ * Depth and colors are interpolated perspective correct by stepping 1/w and Col/w
+ * along each span. Blocks of a span that are entirely behind what is already in
+ * the depth buffer are skipped without touching the pixels.
+ * NOTE: There is no near plane clipping, triangles with W <= 0 are skipped.
+ */
+auto DrawTriangle(render_target& Target,  //!<
+                  vertice_3d const& V0,   //!<
+                  vertice_3d const& V1,   //!<
+                  vertice_3d const& V2    //!<
+                  )                       //!<
+    -> void;
+
+//-----------------------------------------------------------------------------
+/**
+ * Rasterize the printable ASCII glyphs of a font and the kerning between them.
+ * This is the only place where SDL_ttf renders when text is drawn through the atlas.
+ */
+auto CreateGlyphAtlas(TTF_Font* ptrFont) -> glyph_atlas;
+
 //-----------------------------------------------------------------------------
 /**
  * Write text on the screenSurface according to the text_fmt.
  * NOTE: There are side effects when using this function with
  *       respect to the Dirty flag. When set the text_fmt object
  *       will be updated.
+ *       When ptrAtlas is set the text is composed from cached glyphs and
+ *       no surfaces are created, so changing the text costs nothing extra.
  */
 auto Text(SDL_Surface* screenSurface,  //!<
           text_fmt& TextFmt            //!<
           )                            //!<
     -> void;
 
+auto Text(render_target& Target,  //!<
+          text_fmt& TextFmt       //!<
+          )                       //!<
+    -> void;
+
 //-----------------------------------------------------------------------------
 std::string GetResourcePath(const std::string& subDir);
-uint32_t LerpColor(uint32_t Color1, uint32_t Color2, float t);
 
 };  // end of namespace render
 };  // end of namespace fluffy
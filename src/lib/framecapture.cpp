@@ -0,0 +1,320 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "framecapture.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace fluffy
+{
+namespace capture
+{
+namespace
+{
+//------------------------------------------------------------------------------
+auto BytesPerPixel(render::pixel_format Format) -> int
+{
+   switch (Format)
+   {
+      case render::pixel_format::RGB565:
+         return 2;
+      case render::pixel_format::INDEX8:
+         return 1;
+      default:
+         return 4;
+   }
+}
+
+//------------------------------------------------------------------------------
+template <render::pixel_format FORMAT>
+auto DecodeAs(std::uint8_t const* ptrSrc, std::size_t Num, std::uint32_t* ptrDst) -> void
+{
+   using traits = render::pixel_traits<FORMAT>;
+   auto const* ptrPixel = reinterpret_cast<typename traits::pixel_t const*>(ptrSrc);
+   for (std::size_t Idx = 0; Idx < Num; ++Idx) ptrDst[Idx] = traits::Decode(ptrPixel[Idx]);
+}
+
+/**
+ * Convert a captured frame to 0xAARRGGBB.
+ */
+auto Decode(capture_buffer const& Buffer, std::size_t Num, std::uint32_t* ptrDst) -> void
+{
+   auto const* ptrSrc = Buffer.Pixels.data();
+   switch (Buffer.Format)
+   {
+      case render::pixel_format::ARGB8888:
+         DecodeAs<render::pixel_format::ARGB8888>(ptrSrc, Num, ptrDst);
+         break;
+      case render::pixel_format::XRGB8888:
+         DecodeAs<render::pixel_format::XRGB8888>(ptrSrc, Num, ptrDst);
+         break;
+      case render::pixel_format::RGB565:
+         DecodeAs<render::pixel_format::RGB565>(ptrSrc, Num, ptrDst);
+         break;
+      case render::pixel_format::INDEX8:
+         DecodeAs<render::pixel_format::INDEX8>(ptrSrc, Num, ptrDst);
+         break;
+   }
+}
+
+/**
+ * Scratch owned by the writer thread, allocated once.
+ */
+struct writer_scratch
+{
+   std::vector<std::uint32_t> Colors{};  //!<
+   std::vector<std::uint8_t> Bytes{};    //!< RGB for PPM, or the Y, U and V planes for Y4M.
+};
+
+//------------------------------------------------------------------------------
+auto WritePPM(frame_capture const& Capture, std::uint64_t Frame, writer_scratch& Scratch) -> bool
+{
+   auto const Num = std::size_t(Capture.Width) * std::size_t(Capture.Height);
+   for (std::size_t Idx = 0; Idx < Num; ++Idx)
+   {
+      auto const Color = Scratch.Colors[Idx];
+      Scratch.Bytes[3 * Idx + 0] = std::uint8_t(Color >> 16);
+      Scratch.Bytes[3 * Idx + 1] = std::uint8_t(Color >> 8);
+      Scratch.Bytes[3 * Idx + 2] = std::uint8_t(Color);
+   }
+
+   char Number[32];
+   std::snprintf(Number, sizeof(Number), "%06llu.ppm", (unsigned long long)Frame);
+   auto const FileName = Capture.Path + Number;
+
+   auto* fp = std::fopen(FileName.c_str(), "wb");
+   if (!fp) return false;
+   bool Ok = std::fprintf(fp, "P6\n%d %d\n255\n", Capture.Width, Capture.Height) > 0;
+   Ok = Ok && std::fwrite(Scratch.Bytes.data(), 1, 3 * Num, fp) == 3 * Num;
+   return (std::fclose(fp) == 0) && Ok;
+}
+
+/**
+ * BT.601 full range, the same integer weights as JPEG. Saturated blue and red round up to 256 in
+ * U and V, so the chroma is clamped before it is narrowed to a byte.
+ */
+auto WriteY4M(frame_capture const& Capture, writer_scratch& Scratch) -> bool
+{
+   auto const Num = std::size_t(Capture.Width) * std::size_t(Capture.Height);
+   auto* ptrY = Scratch.Bytes.data();
+   auto* ptrU = ptrY + Num;
+   auto* ptrV = ptrU + Num;
+   for (std::size_t Idx = 0; Idx < Num; ++Idx)
+   {
+      auto const Color = Scratch.Colors[Idx];
+      int const R = (Color >> 16) & 0xFF;
+      int const G = (Color >> 8) & 0xFF;
+      int const B = Color & 0xFF;
+      ptrY[Idx] = std::uint8_t((77 * R + 150 * G + 29 * B + 128) >> 8);
+      ptrU[Idx] = std::uint8_t(std::clamp(((-43 * R - 85 * G + 128 * B + 128) >> 8) + 128, 0, 255));
+      ptrV[Idx] = std::uint8_t(std::clamp(((128 * R - 107 * G - 21 * B + 128) >> 8) + 128, 0, 255));
+   }
+
+   bool Ok = std::fputs("FRAME\n", Capture.fp) >= 0;
+   return Ok && std::fwrite(Scratch.Bytes.data(), 1, 3 * Num, Capture.fp) == 3 * Num;
+}
+
+//------------------------------------------------------------------------------
+auto WriterThread(frame_capture& Capture) -> void
+{
+#ifndef _WIN32
+   /**
+    * A pipe whose reader has exited raises SIGPIPE in the thread that writes to it, which kills
+    * the app by default. Blocked here, the write fails with EPIPE and is counted in NumFailed.
+    * All writes to the stream are made on this thread, see the fflush() below.
+    */
+   sigset_t Signals{};
+   sigemptyset(&Signals);
+   sigaddset(&Signals, SIGPIPE);
+   pthread_sigmask(SIG_BLOCK, &Signals, nullptr);
+#endif
+
+   auto const Num = std::size_t(Capture.Width) * std::size_t(Capture.Height);
+   writer_scratch Scratch{};
+   Scratch.Colors.resize(Num);
+   Scratch.Bytes.resize(3 * Num);
+
+   std::uint64_t Tail{};
+   for (;;)
+   {
+      /**
+       * Load the signal before looking at the buffers, so a frame queued after the look
+       * changes the signal and the wait below returns at once.
+       */
+      auto const Seen = Capture.Signal.load(std::memory_order_acquire);
+
+      /**
+       * Quit is loaded before the buffers as well. StopCapture() sets it after the last frame
+       * is queued, so when it is seen here the pass below still finds that frame.
+       */
+      auto const Quitting = Capture.Quit.load(std::memory_order_acquire);
+
+      for (;;)
+      {
+         auto& Buffer = Capture.Buffers[Tail % frame_capture::NUM_BUFFERS];
+         if (!Buffer.Filled.load(std::memory_order_acquire)) break;
+
+         Decode(Buffer, Num, Scratch.Colors.data());
+         auto const Frame = Buffer.Frame;
+         Buffer.Filled.store(false, std::memory_order_release);
+         ++Tail;
+
+         auto const Ok = Capture.Format == capture_format::PPM ? WritePPM(Capture, Frame, Scratch)
+                                                               : WriteY4M(Capture, Scratch);
+         (Ok ? Capture.NumWritten : Capture.NumFailed).fetch_add(1, std::memory_order_relaxed);
+      }
+
+      if (Quitting)
+      {
+         if (Capture.fp && std::fflush(Capture.fp) != 0) Capture.NumFailed.fetch_add(1, std::memory_order_relaxed);
+         return;
+      }
+      Capture.Signal.wait(Seen, std::memory_order_acquire);
+   }
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+frame_capture::~frame_capture()
+{
+   StopCapture(*this);
+}
+
+//------------------------------------------------------------------------------
+auto StartCapture(frame_capture& Capture,   //!<
+                  capture_format Format,    //!<
+                  std::string const& Path,  //!<
+                  int Width,                //!<
+                  int Height,               //!<
+                  int FramesPerSecond       //!<
+                  )                         //!<
+    -> bool
+{
+   if (Capture.Writer.joinable() || Width <= 0 || Height <= 0) return false;
+
+   Capture.Format = Format;
+   Capture.Path = Path;
+   Capture.Width = Width;
+   Capture.Height = Height;
+   Capture.NumFrames = 0;
+   Capture.Head = 0;
+   Capture.NumWritten = 0;
+   Capture.NumDropped = 0;
+   Capture.NumRejected = 0;
+   Capture.NumFailed = 0;
+   Capture.Quit = false;
+
+   if (Format == capture_format::Y4M)
+   {
+      Capture.IsPipe = !Path.empty() && Path[0] == '|';
+      Capture.fp = Capture.IsPipe ? popen(Path.c_str() + 1, "w") : std::fopen(Path.c_str(), "wb");
+      if (!Capture.fp) return false;
+      std::fprintf(Capture.fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", Width, Height,
+                   FramesPerSecond > 0 ? FramesPerSecond : 60);
+   }
+
+   auto const MaxBytes = std::size_t(Width) * std::size_t(Height) * 4;
+   for (auto& Buffer : Capture.Buffers)
+   {
+      Buffer.Pixels.resize(MaxBytes);
+      Buffer.Filled = false;
+   }
+
+   Capture.Writer = std::thread(WriterThread, std::ref(Capture));
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto CaptureFrame(frame_capture& Capture,       //!<
+                  void const* ptrPixels,        //!<
+                  int Pitch,                    //!<
+                  render::pixel_format Format,  //!<
+                  int Width,                    //!<
+                  int Height                    //!<
+                  )                             //!<
+    -> bool
+{
+   if (!Capture.Writer.joinable() || ptrPixels == nullptr) return false;
+
+   /**
+    * Buffers are taken in the same round robin order as the writer releases them. A dropped
+    * frame does not take a buffer, so the order is only advanced by the frames that are queued.
+    */
+   auto const Frame = Capture.NumFrames++;
+   auto& Buffer = Capture.Buffers[Capture.Head % frame_capture::NUM_BUFFERS];
+   if (Width != Capture.Width || Height != Capture.Height)
+   {
+      Capture.NumRejected.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+   if (Buffer.Filled.load(std::memory_order_acquire))
+   {
+      Capture.NumDropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   auto const RowBytes = std::size_t(Width) * BytesPerPixel(Format);
+   auto const* ptrSrc = static_cast<std::uint8_t const*>(ptrPixels);
+   for (int Y = 0; Y < Height; ++Y)
+   {
+      std::memcpy(Buffer.Pixels.data() + Y * RowBytes, ptrSrc + std::ptrdiff_t(Y) * Pitch, RowBytes);
+   }
+   Buffer.Format = Format;
+   Buffer.Frame = Frame;
+   Buffer.Filled.store(true, std::memory_order_release);
+   ++Capture.Head;
+
+   Capture.Signal.fetch_add(1, std::memory_order_release);
+   Capture.Signal.notify_one();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto StopCapture(frame_capture& Capture) -> void
+{
+   if (!Capture.Writer.joinable()) return;
+
+   Capture.Quit.store(true, std::memory_order_release);
+   Capture.Signal.fetch_add(1, std::memory_order_release);
+   Capture.Signal.notify_one();
+   Capture.Writer.join();
+
+   if (Capture.fp)
+   {
+      Capture.IsPipe ? pclose(Capture.fp) : std::fclose(Capture.fp);
+      Capture.fp = nullptr;
+   }
+}
+
+};  // end of namespace capture
+};  // end of namespace fluffy
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,132 @@
+#ifndef SRC_LIB_FRAMECAPTURE_HPP_D41B7E02_8C6A_4F93_B25E_19A3C0F6E7D8
+#define SRC_LIB_FRAMECAPTURE_HPP_D41B7E02_8C6A_4F93_B25E_19A3C0F6E7D8
+
+/**
+ * Asynchronous capture of rendered frames to a PPM sequence or a Y4M stream.
+ *
+ * CaptureFrame() copies the pixels into one of NUM_BUFFERS preallocated buffers and hands it
+ * to a writer thread that converts and writes it. The render thread never waits for the
+ * writer: when all the buffers are still queued the frame is dropped and counted instead.
+ * The buffers are passed round robin between exactly one capturing thread and the writer,
+ * so the hand over is a flag per buffer and no lock is needed.
+ *
+ * Usage:
+ *    frame_capture Capture{};
+ *    StartCapture(Capture, capture_format::Y4M, "|ffmpeg -i - out.mp4", Width, Height, 60);
+ *    CaptureFrame(Capture, ptrPixels, Pitch, pixel_format::XRGB8888, Width, Height);
+ *    StopCapture(Capture);
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pixelformat.hpp"
+
+namespace fluffy
+{
+namespace capture
+{
+enum class capture_format
+{
+   PPM = 0,  //!< One binary PPM file per frame, named <Path>000000.ppm, <Path>000001.ppm...
+   Y4M = 1,  //!< One 4:4:4 full range YUV4MPEG2 stream. Path is a file, or "|command" to pipe into.
+};
+
+struct capture_buffer
+{
+   std::vector<std::uint8_t> Pixels{};  //!< Rows copied from the surface without the pitch padding.
+   render::pixel_format Format{};       //!<
+   std::uint64_t Frame{};               //!< Capture sequence number, dropped frames included.
+   std::atomic<bool> Filled{};          //!< Set by CaptureFrame(), cleared by the writer.
+};
+
+struct frame_capture
+{
+   static constexpr std::size_t NUM_BUFFERS = 4;  //!<
+
+   frame_capture() = default;
+   frame_capture(frame_capture const&) = delete;
+   frame_capture& operator=(frame_capture const&) = delete;
+
+   /** Writes the queued frames and stops the writer if StopCapture() has not been called. */
+   ~frame_capture();
+
+   capture_format Format{};    //!<
+   std::string Path{};         //!<
+   int Width{};                //!< Frames with another size are rejected.
+   int Height{};               //!<
+   std::FILE* fp{};            //!< The Y4M stream.
+   bool IsPipe{};              //!<
+   std::uint64_t NumFrames{};  //!< Frames offered to CaptureFrame(). Capturing thread only.
+   std::uint64_t Head{};       //!< Frames queued for the writer. Capturing thread only.
+
+   capture_buffer Buffers[NUM_BUFFERS]{};     //!<
+   std::atomic<std::uint32_t> Signal{};       //!< Bumped to wake the writer.
+   std::atomic<bool> Quit{};                  //!<
+   std::atomic<std::uint64_t> NumWritten{};   //!<
+   std::atomic<std::uint64_t> NumDropped{};   //!< The writer was behind and all the buffers were in use.
+   std::atomic<std::uint64_t> NumRejected{};  //!< The frame did not have the size given to StartCapture().
+   std::atomic<std::uint64_t> NumFailed{};    //!< Frames that could not be written.
+   std::thread Writer{};                      //!<
+};
+
+/**
+ * Allocate the buffers, open the Y4M stream and start the writer thread.
+ * Returns false if the capture is already running or the output could not be opened.
+ */
+auto StartCapture(frame_capture& Capture,   //!<
+                  capture_format Format,    //!<
+                  std::string const& Path,  //!<
+                  int Width,                //!<
+                  int Height,               //!<
+                  int FramesPerSecond       //!< Only used in the Y4M header.
+                  )                         //!<
+    -> bool;
+
+/**
+ * Copy a frame and queue it for writing. Never blocks.
+ * Returns false if the frame was dropped or rejected.
+ */
+auto CaptureFrame(frame_capture& Capture,       //!<
+                  void const* ptrPixels,        //!<
+                  int Pitch,                    //!< Bytes between rows.
+                  render::pixel_format Format,  //!<
+                  int Width,                    //!<
+                  int Height                    //!<
+                  )                             //!<
+    -> bool;
+
+/**
+ * Write the frames that are still queued, stop the writer thread and close the output.
+ */
+auto StopCapture(frame_capture& Capture) -> void;
+
+};  // end of namespace capture
+};  // end of namespace fluffy
+#endif
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,142 @@
+#ifndef SRC_LIB_FRAMEPIPELINE_HPP_3E8B1D67_C4A2_4B95_8F07_A6D2E59C1B34
+#define SRC_LIB_FRAMEPIPELINE_HPP_3E8B1D67_C4A2_4B95_8F07_A6D2E59C1B34
+
+/**
+ * Frame pipeline where the simulation of frame N+1 runs on its own thread while
+ * frame N is rendered and presented on the calling (SDL main) thread.
+ *
+ * The two stages share two snapshot slots. The simulation writes the back slot and
+ * publishes it, the renderer acquires the published slot and only reads it. A slot is
+ * not written again until the renderer has moved on to the next one, so a snapshot
+ * never changes while it is being rendered.
+ *
+ * Usage:
+ *    frame_pipeline<scene> Pipeline{};
+ *    StartPipeline(Pipeline, [&](scene& Next) { Simulate(State); Next = State; });
+ *    while (auto const* ptrScene = AcquireFrame(Pipeline)) { Render(*ptrScene); Present(); }
+ *    StopPipeline(Pipeline);
+ *
+ * NOTE: Snapshots are copied every frame. Keep large data that does not change after it
+ *       has been created behind std::shared_ptr<T const> so the copy stays cheap.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace fluffy
+{
+namespace pipeline
+{
+template <typename SNAPSHOT>
+struct frame_pipeline
+{
+   frame_pipeline() = default;
+   frame_pipeline(frame_pipeline const&) = delete;
+   frame_pipeline& operator=(frame_pipeline const&) = delete;
+
+   /** Stops the simulation thread if StopPipeline() has not been called. */
+   ~frame_pipeline() { StopPipeline(*this); }
+
+   SNAPSHOT Slots[2]{};    //!<
+   int Front{-1};          //!< Slot held by the renderer, -1 before the first frame.
+   int Ready{-1};          //!< Slot published by the simulation and not yet acquired.
+   std::uint64_t Frame{};  //!< Number of snapshots acquired by the renderer.
+   bool Quit{};            //!<
+
+   std::mutex Mutex{};              //!<
+   std::condition_variable Cond{};  //!<
+   std::thread Simulation{};        //!<
+};
+
+//------------------------------------------------------------------------------
+/**
+ * Start the simulation thread. Simulate(SNAPSHOT& Next) is called once per frame and must
+ * fill in the complete snapshot. It runs at most one frame ahead of the renderer.
+ */
+template <typename SNAPSHOT, typename FN>
+auto StartPipeline(frame_pipeline<SNAPSHOT>& Pipeline, FN Simulate) -> void
+{
+   Pipeline.Simulation = std::thread(
+       [&Pipeline, Simulate = std::move(Simulate)]() mutable
+       {
+          int Back{0};
+          for (;;)
+          {
+             Simulate(Pipeline.Slots[Back]);
+
+             std::unique_lock<std::mutex> Lock(Pipeline.Mutex);
+             Pipeline.Ready = Back;
+             Pipeline.Cond.notify_all();
+
+             /**
+              * Wait for the renderer to take the snapshot. It then lets go of the other slot.
+              */
+             Pipeline.Cond.wait(Lock, [&Pipeline]() { return Pipeline.Quit || Pipeline.Ready == -1; });
+             if (Pipeline.Quit) return;
+             Back = 1 - Pipeline.Front;
+          }
+       });
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Release the previous snapshot and wait for the next one.
+ * Returns nullptr when the pipeline has been stopped.
+ */
+template <typename SNAPSHOT>
+auto AcquireFrame(frame_pipeline<SNAPSHOT>& Pipeline) -> SNAPSHOT const*
+{
+   std::unique_lock<std::mutex> Lock(Pipeline.Mutex);
+   Pipeline.Cond.wait(Lock, [&Pipeline]() { return Pipeline.Quit || Pipeline.Ready != -1; });
+   if (Pipeline.Quit) return nullptr;
+
+   Pipeline.Front = Pipeline.Ready;
+   Pipeline.Ready = -1;
+   ++Pipeline.Frame;
+   Pipeline.Cond.notify_all();
+   return &Pipeline.Slots[Pipeline.Front];
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Stop and join the simulation thread. Snapshots returned by AcquireFrame() stay valid
+ * until the pipeline is destroyed.
+ */
+template <typename SNAPSHOT>
+auto StopPipeline(frame_pipeline<SNAPSHOT>& Pipeline) -> void
+{
+   {
+      std::lock_guard<std::mutex> Lock(Pipeline.Mutex);
+      Pipeline.Quit = true;
+   }
+   Pipeline.Cond.notify_all();
+   if (Pipeline.Simulation.joinable()) Pipeline.Simulation.join();
+}
+
+};  // end of namespace pipeline
+};  // end of namespace fluffy
+#endif
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,205 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "frameprofiler.hpp"
+
+namespace fluffy
+{
+namespace timing
+{
+namespace
+{
+struct sample
+{
+   std::uint64_t Frame{};
+   std::uint32_t Zone{};
+   std::int64_t StartNS{};
+   std::int64_t DurationNS{};
+};
+
+/**
+ * Copy sample number Index out of the ring buffer.
+ * Returns false if the slot has been reused, or is being written, while it was read.
+ */
+auto ReadSample(frame_profiler const& Profiler, std::uint64_t Index, sample& Sample) -> bool
+{
+   auto const& Slot = Profiler.Samples[Index & (frame_profiler::CAPACITY - 1)];
+   auto const Seq = Slot.Seq.load(std::memory_order_acquire);
+   if (Seq != Index + 1) return false;
+
+   Sample.Frame = Slot.Frame.load(std::memory_order_relaxed);
+   Sample.Zone = Slot.Zone.load(std::memory_order_relaxed);
+   Sample.StartNS = Slot.StartNS.load(std::memory_order_relaxed);
+   Sample.DurationNS = Slot.DurationNS.load(std::memory_order_relaxed);
+
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return Slot.Seq.load(std::memory_order_relaxed) == Seq;
+}
+
+/**
+ * Call Fn(sample const&) for all the valid samples in the ring buffer, oldest first.
+ */
+template <typename FN>
+auto ForEachSample(frame_profiler const& Profiler, FN Fn) -> void
+{
+   auto const Head = Profiler.Head.load(std::memory_order_acquire);
+   auto const First = Head > frame_profiler::CAPACITY ? Head - frame_profiler::CAPACITY : 0;
+   sample Sample{};
+   for (auto Index = First; Index < Head; ++Index)
+   {
+      if (ReadSample(Profiler, Index, Sample)) Fn(Sample);
+   }
+}
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto SetZoneName(frame_profiler& Profiler,  //!<
+                 std::uint32_t Zone,        //!<
+                 char const* Name           //!<
+                 )                          //!<
+    -> void
+{
+   if (Zone < frame_profiler::MAX_ZONES) Profiler.ZoneNames[Zone] = Name;
+}
+
+//------------------------------------------------------------------------------
+auto BeginProfilerFrame(frame_profiler& Profiler) -> void
+{
+   Profiler.Frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+auto RecordSample(frame_profiler& Profiler,  //!<
+                  std::uint32_t Zone,        //!<
+                  std::int64_t StartNS,      //!<
+                  std::int64_t EndNS         //!<
+                  )                          //!<
+    -> void
+{
+   auto const Index = Profiler.Head.fetch_add(1, std::memory_order_relaxed);
+   auto& Slot = Profiler.Samples[Index & (frame_profiler::CAPACITY - 1)];
+
+   /**
+    * Invalidate the slot before the fields change, so a reader never mixes two samples.
+    */
+   Slot.Seq.store(0, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   Slot.Frame.store(Profiler.Frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+   Slot.Zone.store(Zone, std::memory_order_relaxed);
+   Slot.StartNS.store(StartNS, std::memory_order_relaxed);
+   Slot.DurationNS.store(EndNS - StartNS, std::memory_order_relaxed);
+   Slot.Seq.store(Index + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+auto ZoneLastFrameNS(frame_profiler const& Profiler,  //!<
+                     std::uint32_t Zone               //!<
+                     )                                //!<
+    -> std::int64_t
+{
+   auto const Frame = Profiler.Frame.load(std::memory_order_relaxed);
+   if (Frame == 0) return 0;
+
+   /**
+    * Walk backwards from the newest sample. The frames of the two threads may interleave
+    * a little at the frame boundary, so stop one frame past the one that is summed.
+    */
+   auto const LastFrame = Frame - 1;
+   auto const Head = Profiler.Head.load(std::memory_order_acquire);
+   auto const First = Head > frame_profiler::CAPACITY ? Head - frame_profiler::CAPACITY : 0;
+
+   std::int64_t Sum{};
+   sample Sample{};
+   for (auto Index = Head; Index > First; --Index)
+   {
+      if (!ReadSample(Profiler, Index - 1, Sample)) continue;
+      if (Sample.Frame + 1 < LastFrame) break;
+      if (Sample.Zone == Zone && Sample.Frame == LastFrame) Sum += Sample.DurationNS;
+   }
+   return Sum;
+}
+
+//------------------------------------------------------------------------------
+auto ZonePercentileNS(frame_profiler const& Profiler,  //!<
+                      std::uint32_t Zone,              //!<
+                      double Percentile                //!<
+                      )                                //!<
+    -> std::int64_t
+{
+   auto const Frame = Profiler.Frame.load(std::memory_order_relaxed);
+
+   /**
+    * A zone is recorded from one thread, so its samples are in frame order and the
+    * samples of one frame are next to each other.
+    */
+   std::int64_t PerFrame[frame_profiler::CAPACITY];
+   std::size_t Num{};
+   std::uint64_t CurrentFrame{};
+   ForEachSample(Profiler,
+                 [&](sample const& Sample)
+                 {
+                    if (Sample.Zone != Zone || Sample.Frame >= Frame) return;
+                    if (Num == 0 || Sample.Frame != CurrentFrame)
+                    {
+                       CurrentFrame = Sample.Frame;
+                       PerFrame[Num++] = 0;
+                    }
+                    PerFrame[Num - 1] += Sample.DurationNS;
+                 });
+   if (Num == 0) return 0;
+
+   auto const Rank = static_cast<std::size_t>(std::clamp(Percentile, 0.0, 100.0) / 100.0 * double(Num - 1) + 0.5);
+   std::nth_element(PerFrame, PerFrame + Rank, PerFrame + Num);
+   return PerFrame[Rank];
+}
+
+//------------------------------------------------------------------------------
+auto WriteProfileCSV(frame_profiler const& Profiler,  //!<
+                     char const* FileName             //!<
+                     )                                //!<
+    -> bool
+{
+   auto* fp = std::fopen(FileName, "w");
+   if (!fp) return false;
+
+   std::fprintf(fp, "frame,zone,start_ns,duration_ns\n");
+   ForEachSample(Profiler,
+                 [&](sample const& Sample)
+                 {
+                    auto const* ptrName =
+                        Sample.Zone < frame_profiler::MAX_ZONES ? Profiler.ZoneNames[Sample.Zone] : nullptr;
+                    std::fprintf(fp, "%llu,%s,%lld,%lld\n", (unsigned long long)Sample.Frame,
+                                 ptrName ? ptrName : "unnamed", (long long)Sample.StartNS,
+                                 (long long)Sample.DurationNS);
+                 });
+
+   return std::fclose(fp) == 0;
+}
+
+};  // end of namespace timing
+};  // end of namespace fluffy
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,142 @@
+#ifndef SRC_LIB_FRAMEPROFILER_HPP_7C2E9A41_5B83_4D1F_A6E0_3F98D27B4C16
+#define SRC_LIB_FRAMEPROFILER_HPP_7C2E9A41_5B83_4D1F_A6E0_3F98D27B4C16
+
+/**
+ * Per phase frame profiler.
+ * A profile_zone measures the time from its construction to the end of its scope and
+ * stores it as one sample in a ring buffer. Samples are tagged with the profiler frame,
+ * so the statistics are per frame even when a zone is entered several times in a frame.
+ *
+ * The ring buffer is lock free. Writers claim a slot with one atomic increment and publish
+ * it with a sequence number, readers skip slots that are being overwritten. Zones can
+ * therefore be recorded from the simulation thread and the render thread at the same time.
+ *
+ * Usage:
+ *    SetZoneName(Profiler, ZONE_PRESENT, "present");
+ *    BeginProfilerFrame(Profiler);
+ *    { profile_zone Zone(Profiler, ZONE_PRESENT); PresentFrame(...); }
+ *    ZonePercentileNS(Profiler, ZONE_PRESENT, 99);
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "framescheduler.hpp"
+
+namespace fluffy
+{
+namespace timing
+{
+struct profile_sample
+{
+   std::atomic<std::uint64_t> Seq{};        //!< Index + 1 of the sample in the slot, 0 while it is written.
+   std::atomic<std::uint64_t> Frame{};      //!<
+   std::atomic<std::uint32_t> Zone{};       //!<
+   std::atomic<std::int64_t> StartNS{};     //!<
+   std::atomic<std::int64_t> DurationNS{};  //!<
+};
+
+struct frame_profiler
+{
+   static constexpr std::size_t CAPACITY = 4096;  //!< Number of samples kept. Must be a power of two.
+   static constexpr std::size_t MAX_ZONES = 16;   //!<
+
+   char const* ZoneNames[MAX_ZONES]{};  //!<
+   std::atomic<std::uint64_t> Frame{};  //!< Incremented by BeginProfilerFrame().
+   std::atomic<std::uint64_t> Head{};   //!< Total number of samples recorded.
+   profile_sample Samples[CAPACITY]{};  //!< Ring buffer, indexed by sample number % CAPACITY.
+};
+
+/**
+ * Name a zone. The name must outlive the profiler, typically a string literal.
+ */
+auto SetZoneName(frame_profiler& Profiler,  //!<
+                 std::uint32_t Zone,        //!< 0..MAX_ZONES-1.
+                 char const* Name           //!<
+                 )                          //!<
+    -> void;
+
+/**
+ * Start a new frame. Samples recorded after this belong to the new frame.
+ */
+auto BeginProfilerFrame(frame_profiler& Profiler) -> void;
+
+/**
+ * Store one sample. Thread safe and wait free.
+ */
+auto RecordSample(frame_profiler& Profiler,  //!<
+                  std::uint32_t Zone,        //!<
+                  std::int64_t StartNS,      //!<
+                  std::int64_t EndNS         //!<
+                  )                          //!<
+    -> void;
+
+/**
+ * Time spent in a zone in the last completed frame.
+ */
+auto ZoneLastFrameNS(frame_profiler const& Profiler,  //!<
+                     std::uint32_t Zone               //!<
+                     )                                //!<
+    -> std::int64_t;
+
+/**
+ * Percentile, in the range 0..100, of the time spent in a zone per frame.
+ * Only the completed frames that are still in the ring buffer are used.
+ */
+auto ZonePercentileNS(frame_profiler const& Profiler,  //!<
+                      std::uint32_t Zone,              //!<
+                      double Percentile                //!<
+                      )                                //!<
+    -> std::int64_t;
+
+/**
+ * Write the samples in the ring buffer as frame,zone,start_ns,duration_ns lines.
+ * Returns false if the file could not be written.
+ */
+auto WriteProfileCSV(frame_profiler const& Profiler,  //!<
+                     char const* FileName             //!<
+                     )                                //!<
+    -> bool;
+
+/**
+ * Scoped timer. Records one sample for Zone when it goes out of scope.
+ */
+struct profile_zone
+{
+   profile_zone(frame_profiler& Profiler, std::uint32_t Zone) : Profiler(Profiler), Zone(Zone), StartNS(NowNS()) {}
+   ~profile_zone() { RecordSample(Profiler, Zone, StartNS, NowNS()); }
+
+   profile_zone(profile_zone const&) = delete;
+   profile_zone& operator=(profile_zone const&) = delete;
+
+   frame_profiler& Profiler;  //!<
+   std::uint32_t Zone{};      //!<
+   std::int64_t StartNS{};    //!<
+};
+
+};  // end of namespace timing
+};  // end of namespace fluffy
+#endif
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
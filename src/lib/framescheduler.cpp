@@ -0,0 +1,113 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "framescheduler.hpp"
+
+namespace fluffy
+{
+namespace timing
+{
+//------------------------------------------------------------------------------
+auto NowNS() -> std::int64_t
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+       .count();
+}
+
+//------------------------------------------------------------------------------
+auto InitFrameScheduler(frame_scheduler& Scheduler,  //!<
+                        double FramesPerSecond       //!<
+                        )                            //!<
+    -> void
+{
+   auto const SpinNS = Scheduler.SpinNS;
+   auto const MaxCatchUp = Scheduler.MaxCatchUp;
+   Scheduler = frame_scheduler{};
+   Scheduler.SpinNS = SpinNS;
+   Scheduler.MaxCatchUp = MaxCatchUp;
+   Scheduler.PeriodNS = FramesPerSecond > 0 ? static_cast<std::int64_t>(std::llround(1e9 / FramesPerSecond)) : 0;
+}
+
+//------------------------------------------------------------------------------
+auto WaitForNextFrame(frame_scheduler& Scheduler) -> std::int64_t
+{
+   auto Now = NowNS();
+   if (Scheduler.NextDeadlineNS == 0) Scheduler.NextDeadlineNS = Now + Scheduler.PeriodNS;
+
+   auto const Deadline = Scheduler.NextDeadlineNS;
+   if (Deadline - Now > Scheduler.SpinNS)
+   {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(Deadline - Now - Scheduler.SpinNS));
+      Now = NowNS();
+   }
+
+   while (Now < Deadline)
+   {
+      std::this_thread::yield();
+      Now = NowNS();
+   }
+
+   auto const Lateness = Now - Deadline;
+   Scheduler.LatenessNS[Scheduler.NumFrames % frame_scheduler::HISTORY] = Lateness;
+   Scheduler.MaxLatenessNS = std::max(Scheduler.MaxLatenessNS, Lateness);
+   ++Scheduler.NumFrames;
+
+   /**
+    * Stay on the grid. When too far behind, skip the missed deadlines in one go.
+    */
+   Scheduler.NextDeadlineNS += Scheduler.PeriodNS;
+   if (Scheduler.PeriodNS > 0 && Lateness > Scheduler.MaxCatchUp * Scheduler.PeriodNS)
+   {
+      auto const Missed = Lateness / Scheduler.PeriodNS;
+      Scheduler.NextDeadlineNS += Missed * Scheduler.PeriodNS;
+      Scheduler.NumDropped += static_cast<std::uint64_t>(Missed);
+   }
+
+   return Lateness;
+}
+
+//------------------------------------------------------------------------------
+auto LatenessPercentileNS(frame_scheduler const& Scheduler,  //!<
+                          double Percentile                  //!<
+                          )                                  //!<
+    -> std::int64_t
+{
+   auto const Num = static_cast<std::size_t>(std::min<std::uint64_t>(Scheduler.NumFrames, frame_scheduler::HISTORY));
+   if (Num == 0) return 0;
+
+   std::int64_t Sorted[frame_scheduler::HISTORY];
+   std::copy(Scheduler.LatenessNS, Scheduler.LatenessNS + Num, Sorted);
+
+   auto const Rank = static_cast<std::size_t>(std::clamp(Percentile, 0.0, 100.0) / 100.0 * double(Num - 1) + 0.5);
+   std::nth_element(Sorted, Sorted + Rank, Sorted + Num);
+   return Sorted[Rank];
+}
+
+};  // end of namespace timing
+};  // end of namespace fluffy
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
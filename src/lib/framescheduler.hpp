@@ -0,0 +1,84 @@
+#ifndef SRC_LIB_FRAMESCHEDULER_HPP_A5D93C28_1F7E_4B06_9C4D_82E6B07F3A15
+#define SRC_LIB_FRAMESCHEDULER_HPP_A5D93C28_1F7E_4B06_9C4D_82E6B07F3A15
+
+/**
+ * Frame pacing on a fixed grid of deadlines.
+ * The wait is a coarse sleep that stops SpinNS before the deadline, followed by yielding
+ * until the deadline has passed. Deadlines are Period apart from the first frame, so errors
+ * do not accumulate. A frame that is more than MaxCatchUp periods late skips the missed
+ * deadlines instead of running a burst of frames to catch up.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fluffy
+{
+namespace timing
+{
+struct frame_scheduler
+{
+   static constexpr std::size_t HISTORY = 256;  //!< Number of frames kept for the lateness statistics.
+
+   std::int64_t PeriodNS{};             //!<
+   std::int64_t SpinNS{1000000};        //!< Time before the deadline that is spent yielding instead of sleeping.
+   std::int64_t MaxCatchUp{2};          //!< Periods a frame may be late before deadlines are dropped.
+   std::int64_t NextDeadlineNS{};       //!< 0 until the first call to WaitForNextFrame().
+   std::uint64_t NumFrames{};           //!<
+   std::uint64_t NumDropped{};          //!< Deadlines skipped because the frames were too late.
+   std::int64_t MaxLatenessNS{};        //!<
+   std::int64_t LatenessNS[HISTORY]{};  //!< Ring buffer, indexed by NumFrames % HISTORY.
+};
+
+/**
+ * Monotonic time in nanoseconds. The same clock is used for all the deadlines.
+ */
+auto NowNS() -> std::int64_t;
+
+/**
+ * Set the target frame rate and restart the deadlines and the statistics.
+ */
+auto InitFrameScheduler(frame_scheduler& Scheduler,  //!<
+                        double FramesPerSecond       //!<
+                        )                            //!<
+    -> void;
+
+/**
+ * Wait until the deadline of the next frame and return how late the wait ended in nanoseconds.
+ * A frame that is already past its deadline does not wait at all.
+ */
+auto WaitForNextFrame(frame_scheduler& Scheduler) -> std::int64_t;
+
+/**
+ * Lateness percentile over the last HISTORY frames, Percentile in the range 0..100.
+ */
+auto LatenessPercentileNS(frame_scheduler const& Scheduler,  //!<
+                          double Percentile                  //!<
+                          )                                  //!<
+    -> std::int64_t;
+
+};  // end of namespace timing
+};  // end of namespace fluffy
+#endif
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,249 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "geometrycache.hpp"
+
+namespace fluffy
+{
+namespace cache
+{
+namespace
+{
+//------------------------------------------------------------------------------
+auto AlignUp(std::size_t Size) -> std::size_t
+{
+   return (Size + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+auto AddSection(cache_builder& Builder,  //!<
+                section_kind Kind,       //!<
+                uint32_t Id,             //!<
+                std::span<T const> Data  //!<
+                )                        //!<
+    -> void
+{
+   static_assert(std::is_trivially_copyable_v<T>, "Sections are used in place, so they must be plain data.");
+   auto const Offset = AlignUp(Builder.vData.size());
+   Builder.vData.resize(Offset + Data.size_bytes());
+   if (!Data.empty()) std::memcpy(Builder.vData.data() + Offset, Data.data(), Data.size_bytes());
+   Builder.vSections.push_back({static_cast<uint32_t>(Kind), Id, sizeof(T), 0, Offset, Data.size()});
+}
+
+//------------------------------------------------------------------------------
+auto FindSection(geometry_cache const& Cache,  //!<
+                 section_kind Kind,            //!<
+                 uint32_t Id                   //!<
+                 )                             //!<
+    -> section_entry const*
+{
+   for (auto const& Section : Cache.Sections)
+   {
+      if (Section.Kind == static_cast<uint32_t>(Kind) && Section.Id == Id) return &Section;
+   }
+   return nullptr;
+}
+
+/**
+ * The section as an array of T in the mapping. OpenCache() has checked that it is inside the file.
+ */
+template <typename T>
+auto SectionAs(geometry_cache const& Cache,  //!<
+               section_kind Kind,            //!<
+               uint32_t Id                   //!<
+               )                             //!<
+    -> std::span<T const>
+{
+   auto const* ptrSection = FindSection(Cache, Kind, Id);
+   if (!ptrSection || ptrSection->ElementSize != sizeof(T)) return {};
+   return {reinterpret_cast<T const*>(Cache.File.ptrData + ptrSection->Offset), std::size_t(ptrSection->Count)};
+}
+
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto AddMesh(cache_builder& Builder,        //!<
+             uint32_t Id,                   //!<
+             render::mesh_view const& Mesh  //!<
+             )                              //!<
+    -> void
+{
+   AddSection(Builder, section_kind::MESH_X, Id, Mesh.X);
+   AddSection(Builder, section_kind::MESH_Y, Id, Mesh.Y);
+   AddSection(Builder, section_kind::MESH_Z, Id, Mesh.Z);
+   AddSection(Builder, section_kind::MESH_COLORS, Id, Mesh.vColors);
+   AddSection(Builder, section_kind::MESH_INDICES, Id, Mesh.vIndices);
+   AddSection(Builder, section_kind::MESH_EDGES, Id, Mesh.vEdges);
+}
+
+//------------------------------------------------------------------------------
+auto AddSpline(cache_builder& Builder,                    //!<
+               uint32_t Id,                               //!<
+               splines::spline_catmull_rom const& Spline  //!<
+               )                                          //!<
+    -> void
+{
+   /**
+    * InitCatmullRom() adds an end point at each end, they are added again when loading.
+    */
+   std::span<math3d::tup const> CtrlPoints{Spline.CtrlPoints};
+   CtrlPoints = CtrlPoints.size() >= 4 ? CtrlPoints.subspan(1, CtrlPoints.size() - 2) : CtrlPoints.first(0);
+   AddSection(Builder, section_kind::SPLINE_CTRL_POINTS, Id, CtrlPoints);
+   std::span<splines::spline_catmull_rom::point const> const Samples{Spline.vSpline};
+   AddSection(Builder, section_kind::SPLINE_SAMPLES, Id, Samples);
+}
+
+//------------------------------------------------------------------------------
+auto WriteCache(cache_builder const& Builder,  //!<
+                std::string const& Path        //!<
+                )                              //!<
+    -> bool
+{
+   /** The sections are written as they are in memory, which is only the file format on little endian. */
+   if constexpr (std::endian::native != std::endian::little) return false;
+
+   file_header Header{};
+   std::memcpy(Header.Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+   Header.Version = CACHE_VERSION;
+   Header.ByteOrder = CACHE_BYTE_ORDER;
+   Header.NumSections = static_cast<uint32_t>(Builder.vSections.size());
+   Header.SectionAlign = SECTION_ALIGN;
+   auto const DataOffset = AlignUp(sizeof(file_header) + Builder.vSections.size() * sizeof(section_entry));
+   Header.FileSize = DataOffset + Builder.vData.size();
+
+   auto vSections = Builder.vSections;
+   for (auto& Section : vSections) Section.Offset += DataOffset;
+
+   auto const TmpPath = Path + ".tmp";
+   auto* fp = std::fopen(TmpPath.c_str(), "wb");
+   if (!fp) return false;
+
+   char const Padding[SECTION_ALIGN]{};
+   auto const TableEnd = sizeof(file_header) + vSections.size() * sizeof(section_entry);
+   bool Ok = std::fwrite(&Header, sizeof(Header), 1, fp) == 1;
+   Ok = Ok && std::fwrite(vSections.data(), sizeof(section_entry), vSections.size(), fp) == vSections.size();
+   Ok = Ok && std::fwrite(Padding, 1, DataOffset - TableEnd, fp) == DataOffset - TableEnd;
+   Ok = Ok && std::fwrite(Builder.vData.data(), 1, Builder.vData.size(), fp) == Builder.vData.size();
+   Ok = (std::fclose(fp) == 0) && Ok;
+
+   /** Renaming over an existing file fails on some platforms, so remove it and try again. */
+   if (Ok && std::rename(TmpPath.c_str(), Path.c_str()) != 0)
+   {
+      std::remove(Path.c_str());
+      Ok = std::rename(TmpPath.c_str(), Path.c_str()) == 0;
+   }
+   if (!Ok) std::remove(TmpPath.c_str());
+   return Ok;
+}
+
+//------------------------------------------------------------------------------
+auto OpenCache(geometry_cache& Cache,   //!<
+               std::string const& Path  //!<
+               )                        //!<
+    -> bool
+{
+   CloseCache(Cache);
+   if (!render::MapFile(Cache.File, Path)) return false;
+
+   auto Valid = [&]() -> bool
+   {
+      auto const Size = Cache.File.Size;
+      if (Size < sizeof(file_header)) return false;
+
+      auto const& Header = *reinterpret_cast<file_header const*>(Cache.File.ptrData);
+      if (std::memcmp(Header.Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || Header.Version != CACHE_VERSION ||
+          Header.ByteOrder != CACHE_BYTE_ORDER || Header.SectionAlign != SECTION_ALIGN || Header.FileSize != Size)
+         return false;
+      if (Header.NumSections > (Size - sizeof(file_header)) / sizeof(section_entry)) return false;
+
+      Cache.Sections = {reinterpret_cast<section_entry const*>(Cache.File.ptrData + sizeof(file_header)),
+                        Header.NumSections};
+      for (auto const& Section : Cache.Sections)
+      {
+         if (Section.Offset % SECTION_ALIGN != 0 || Section.Offset > Size || Section.ElementSize == 0) return false;
+         if (Section.Count > (Size - Section.Offset) / Section.ElementSize) return false;
+      }
+      return true;
+   };
+
+   if (!Valid())
+   {
+      CloseCache(Cache);
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto CloseCache(geometry_cache& Cache) -> void
+{
+   Cache.Sections = {};
+   render::UnmapFile(Cache.File);
+}
+
+//------------------------------------------------------------------------------
+auto FindMesh(geometry_cache const& Cache, uint32_t Id) -> render::mesh_view
+{
+   render::mesh_view Mesh{};
+   Mesh.X = SectionAs<math3d::FLOAT>(Cache, section_kind::MESH_X, Id);
+   Mesh.Y = SectionAs<math3d::FLOAT>(Cache, section_kind::MESH_Y, Id);
+   Mesh.Z = SectionAs<math3d::FLOAT>(Cache, section_kind::MESH_Z, Id);
+   Mesh.vColors = SectionAs<math3d::tup>(Cache, section_kind::MESH_COLORS, Id);
+   Mesh.vIndices = SectionAs<uint32_t>(Cache, section_kind::MESH_INDICES, Id);
+   Mesh.vEdges = SectionAs<uint32_t>(Cache, section_kind::MESH_EDGES, Id);
+
+   /** A mesh without colors is drawn with the default color, see TransformMesh(). */
+   auto const Num = Mesh.X.size();
+   auto const ColorsOk = Mesh.vColors.empty() || Mesh.vColors.size() == Num;
+   if (Mesh.Y.size() != Num || Mesh.Z.size() != Num || !ColorsOk || Mesh.vIndices.size() % 3 || Mesh.vEdges.size() % 2)
+      return {};
+   return Mesh;
+}
+
+//------------------------------------------------------------------------------
+auto FindSpline(geometry_cache const& Cache, uint32_t Id) -> spline_view
+{
+   spline_view Spline{};
+   Spline.CtrlPoints = SectionAs<math3d::tup>(Cache, section_kind::SPLINE_CTRL_POINTS, Id);
+   Spline.vSpline = SectionAs<splines::spline_catmull_rom::point>(Cache, section_kind::SPLINE_SAMPLES, Id);
+   return Spline;
+}
+
+//------------------------------------------------------------------------------
+auto ToSpline(spline_view const& View) -> splines::spline_catmull_rom
+{
+   auto Spline = splines::InitCatmullRom({View.CtrlPoints.begin(), View.CtrlPoints.end()});
+   Spline.vSpline.assign(View.vSpline.begin(), View.vSpline.end());
+   return Spline;
+}
+
+};  // end of namespace cache
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,193 @@
+#ifndef SRC_LIB_GEOMETRYCACHE_HPP_387DFC9A_E5F3_4663_BD29_8ADF7718106B
+#define SRC_LIB_GEOMETRYCACHE_HPP_387DFC9A_E5F3_4663_BD29_8ADF7718106B
+
+/**
+ * Binary cache of preprocessed geometry: meshes, spline control points and spline samples.
+ *
+ * The file is written once, e.g after importing a mesh or generating a spline, and is then
+ * memory mapped and used in place. Nothing is parsed when it is opened, the header and the
+ * section table are checked and the sections are handed out as spans into the mapping.
+ *
+ * Layout, all little endian:
+ *    file_header       64 bytes at offset 0.
+ *    section_entry     32 bytes each, NumSections of them just after the header.
+ *    section data      Each section starts at a multiple of SECTION_ALIGN.
+ * Each section is an array of one kind of element, tagged with the Id of the mesh or spline
+ * it belongs to. The readers ignore kinds they do not know, so sections can be added without
+ * a new version. A change to an existing section bumps CACHE_VERSION.
+ *
+ * Usage:
+ *    cache_builder Builder{};
+ *    AddMesh(Builder, 1, Mesh);
+ *    WriteCache(Builder, "assets.fgc");
+ *    ...
+ *    geometry_cache Cache{};
+ *    if (OpenCache(Cache, "assets.fgc")) DrawMesh(Target, FindMesh(Cache, 1), ...);
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "meshloader.hpp"
+#include "splines.hpp"
+
+namespace fluffy
+{
+namespace cache
+{
+constexpr char CACHE_MAGIC[8] = {'F', 'L', 'U', 'F', 'F', 'G', 'E', 'O'};
+constexpr uint32_t CACHE_VERSION = 1;
+constexpr uint32_t CACHE_BYTE_ORDER = 0x01020304;  //!< Reads as 0x04030201 with the wrong byte order.
+constexpr std::size_t SECTION_ALIGN = 64;
+
+enum class section_kind : uint32_t
+{
+   MESH_X = 1,              //!< FLOAT per vertex.
+   MESH_Y = 2,              //!< FLOAT per vertex.
+   MESH_Z = 3,              //!< FLOAT per vertex.
+   MESH_COLORS = 4,         //!< math3d::tup per vertex.
+   MESH_INDICES = 5,        //!< uint32_t, three per triangle.
+   MESH_EDGES = 6,          //!< uint32_t, two per edge.
+   SPLINE_CTRL_POINTS = 7,  //!< math3d::tup, as given to InitCatmullRom().
+   SPLINE_SAMPLES = 8,      //!< spline_catmull_rom::point.
+};
+
+struct file_header
+{
+   char Magic[8]{};          //!<
+   uint32_t Version{};       //!<
+   uint32_t ByteOrder{};     //!<
+   uint32_t NumSections{};   //!<
+   uint32_t SectionAlign{};  //!<
+   uint64_t FileSize{};      //!< Detects a truncated file.
+   uint64_t Reserved[4]{};   //!<
+};
+
+struct section_entry
+{
+   uint32_t Kind{};         //!< A section_kind.
+   uint32_t Id{};           //!< Of the mesh or spline the section belongs to.
+   uint32_t ElementSize{};  //!<
+   uint32_t Reserved{};     //!<
+   uint64_t Offset{};       //!< From the start of the file.
+   uint64_t Count{};        //!< Number of elements.
+};
+
+static_assert(sizeof(file_header) == 64);
+static_assert(sizeof(section_entry) == 32);
+
+/**
+ * Sections collected for WriteCache(). The data is copied, so the sources may go away.
+ */
+struct cache_builder
+{
+   std::vector<section_entry> vSections{};  //!< Offsets are relative to the start of vData.
+   std::vector<char> vData{};               //!<
+};
+
+/**
+ * An opened cache. The spans handed out stay valid as long as the cache is open.
+ */
+struct geometry_cache
+{
+   render::mapped_file File{};                 //!<
+   std::span<section_entry const> Sections{};  //!<
+};
+
+/**
+ * Spline as stored in the cache.
+ */
+struct spline_view
+{
+   std::span<math3d::tup const> CtrlPoints{};                      //!< Without the two added end points.
+   std::span<splines::spline_catmull_rom::point const> vSpline{};  //!<
+};
+
+//------------------------------------------------------------------------------
+// NOTE: Declarations
+//------------------------------------------------------------------------------
+
+/**
+ * Add the arrays of the mesh, including the colors and the edges.
+ */
+auto AddMesh(cache_builder& Builder,        //!<
+             uint32_t Id,                   //!<
+             render::mesh_view const& Mesh  //!<
+             )                              //!<
+    -> void;
+
+/**
+ * Add the control points of the spline and the samples in vSpline.
+ */
+auto AddSpline(cache_builder& Builder,                    //!<
+               uint32_t Id,                               //!<
+               splines::spline_catmull_rom const& Spline  //!<
+               )                                          //!<
+    -> void;
+
+/**
+ * Write the cache to a temporary file that is then renamed to Path, so a cache that is
+ * being written is never seen. Returns false on write errors.
+ */
+auto WriteCache(cache_builder const& Builder,  //!<
+                std::string const& Path        //!<
+                )                              //!<
+    -> bool;
+
+/**
+ * Map the cache and check the header and that every section is inside the file.
+ * Returns false if it can not be opened, or is from another version or byte order.
+ */
+auto OpenCache(geometry_cache& Cache,   //!<
+               std::string const& Path  //!<
+               )                        //!<
+    -> bool;
+
+auto CloseCache(geometry_cache& Cache) -> void;
+
+/**
+ * The mesh with Id, empty if there is none or its arrays do not have matching sizes.
+ * The colors may be left out, as for a mesh loaded without colors.
+ */
+auto FindMesh(geometry_cache const& Cache, uint32_t Id) -> render::mesh_view;
+
+/**
+ * The spline with Id, empty if there is none.
+ */
+auto FindSpline(geometry_cache const& Cache, uint32_t Id) -> spline_view;
+
+/**
+ * A spline that can be evaluated, with the segment matrices recomputed from the control points.
+ */
+auto ToSpline(spline_view const& View) -> splines::spline_catmull_rom;
+
+};  // end of namespace cache
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -1,5 +1,5 @@
 /**
- * Code for override of operator new/delete and malloc/free
+ * Code for override of operator new/delete, new[]/delete[] and malloc/calloc/realloc/free
  * License: MIT, see bottom of file.
  * Copyright: Willy Clarke.
  * Many thanks to J. Sorber for teaching these things.
@@ -9,49 +9,139 @@
  * compilation unit that houses main.
  */
 
+#include "memcheck.hpp"
+
 #ifdef FLUFFY_OVR_MEMALLOC
 
 #include <dlfcn.h>
 
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <string>
 
 #warning "Memory allocation is overriden for test purpose"
 
 typedef void *(*malloc_like_function)(size_t);
+typedef void *(*calloc_like_function)(size_t, size_t);
+typedef void *(*realloc_like_function)(void *, size_t);
 typedef void (*free_like_function)(void *);
 
 static malloc_like_function sysmalloc = nullptr;
+static calloc_like_function syscalloc = nullptr;
+static realloc_like_function sysrealloc = nullptr;
 static free_like_function sysfree = nullptr;
 static bool Init = false;
 static FILE *fp = nullptr;
 static char const *ptrLogFileName = "memalloc.log";
+static std::atomic<std::size_t> NumMalloc{};
+
+/**
+ * dlsym() may allocate before sysmalloc is known, and glibc does it with calloc(). Serve those
+ * requests from a small static buffer. It is zero initialized and never reused, so it also does
+ * for calloc().
+ */
+alignas(16) static char BootstrapBuffer[4096];
+static size_t BootstrapUsed = 0;
+
+static bool IsBootstrap(void *ptr)
+{
+   return (char *)ptr >= BootstrapBuffer && (char *)ptr < BootstrapBuffer + sizeof(BootstrapBuffer);
+}
+
+static void *BootstrapAlloc(size_t size)
+{
+   size_t const Aligned = (size + 15) & ~size_t(15);
+   if (Aligned < size || BootstrapUsed + Aligned > sizeof(BootstrapBuffer)) return nullptr;
+   void *ptr = BootstrapBuffer + BootstrapUsed;
+   BootstrapUsed += Aligned;
+   return ptr;
+}
 
 void InitCheck()
 {
    if (!Init)
    {
+      /**
+       * NOTE: fopen() calls malloc(), so mark as initialized before opening the
+       *       log file to avoid endless recursion. Allocations made before the
+       *       file is open are counted but not logged.
+       *       calloc is looked up first, so the callocs made by dlsym() itself are
+       *       the only ones that end up in the bootstrap buffer.
+       */
+      Init = true;
+      syscalloc = (calloc_like_function)dlsym(RTLD_NEXT, "calloc");
       sysmalloc = (malloc_like_function)dlsym(RTLD_NEXT, "malloc");
+      sysrealloc = (realloc_like_function)dlsym(RTLD_NEXT, "realloc");
       sysfree = (free_like_function)dlsym(RTLD_NEXT, "free");
       fp = fopen(ptrLogFileName, "w");
-      Init = true;
+
+      /**
+       * Give the log a static buffer, otherwise the first fprintf() allocates one from within malloc().
+       */
+      static char LogBuffer[1 << 16];
+      if (fp) setvbuf(fp, LogBuffer, _IOFBF, sizeof(LogBuffer));
    }
 }
 
 void *malloc(size_t size)
 {
    InitCheck();
+   if (sysmalloc == nullptr) return BootstrapAlloc(size);
    void *ptr = sysmalloc(size);
-   fprintf(fp, "M,%lu,%lu\n", (uintptr_t)ptr, size);
+   NumMalloc.fetch_add(1, std::memory_order_relaxed);
+   if (fp) fprintf(fp, "M,%lu,%lu\n", (uintptr_t)ptr, size);
+   return ptr;
+}
+
+void *calloc(size_t num, size_t size)
+{
+   InitCheck();
+   if (size != 0 && num > SIZE_MAX / size) return nullptr;
+   if (syscalloc == nullptr) return BootstrapAlloc(num * size);
+   void *ptr = syscalloc(num, size);
+   NumMalloc.fetch_add(1, std::memory_order_relaxed);
+   if (fp) fprintf(fp, "M,%lu,%lu\n", (uintptr_t)ptr, num * size);
    return ptr;
 }
 
+/**
+ * Logged as a free of the old block followed by an allocation of the new one.
+ */
+void *realloc(void *ptr, size_t size)
+{
+   InitCheck();
+   if (ptr == nullptr) return malloc(size);
+   if (IsBootstrap(ptr))
+   {
+      /** The size of a bootstrap block is not kept, copy what can be there. */
+      void *ptrNew = malloc(size);
+      size_t const Available = size_t(BootstrapBuffer + BootstrapUsed - (char *)ptr);
+      if (ptrNew) memcpy(ptrNew, ptr, size < Available ? size : Available);
+      return ptrNew;
+   }
+   if (sysrealloc == nullptr) return nullptr;
+   void *ptrNew = sysrealloc(ptr, size);
+   if (ptrNew == nullptr)
+   {
+      /** realloc(ptr, 0) may free the block and return nullptr, on failure the block is kept. */
+      if (size == 0 && fp) fprintf(fp, "F,%lu\n", (uintptr_t)ptr);
+      return nullptr;
+   }
+   NumMalloc.fetch_add(1, std::memory_order_relaxed);
+   if (fp) fprintf(fp, "F,%lu\nM,%lu,%lu\n", (uintptr_t)ptr, (uintptr_t)ptrNew, size);
+   return ptrNew;
+}
+
 void free(void *ptr)
 {
    InitCheck();
-   fprintf(fp, "F,%lu\n", (uintptr_t)ptr);
+   if (ptr == nullptr || IsBootstrap(ptr)) return;
+   if (fp) fprintf(fp, "F,%lu\n", (uintptr_t)ptr);
    sysfree(ptr);
 }
 
@@ -65,10 +155,56 @@ void *operator new(size_t size)
    return p;
 }
 
+void *operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+void *operator new(size_t size, std::nothrow_t const &) noexcept
+{
+   return malloc(size);
+}
+
+void *operator new[](size_t size, std::nothrow_t const &) noexcept
+{
+   return malloc(size);
+}
+
 void operator delete(void *p) noexcept
 {
    free(p);
 }
+
+void operator delete[](void *p) noexcept
+{
+   free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+   free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+   free(p);
+}
+
+void operator delete(void *p, std::nothrow_t const &) noexcept
+{
+   free(p);
+}
+
+void operator delete[](void *p, std::nothrow_t const &) noexcept
+{
+   free(p);
+}
+
+auto fluffy::memcheck::IsActive() -> bool { return true; }
+auto fluffy::memcheck::NumAllocations() -> std::size_t { return NumMalloc.load(std::memory_order_relaxed); }
+#else
+auto fluffy::memcheck::IsActive() -> bool { return false; }
+auto fluffy::memcheck::NumAllocations() -> std::size_t { return 0; }
 #endif
 
 // int main()
@@ -0,0 +1,49 @@
+#ifndef SRC_LIB_MEMCHECK_HPP_9E2C4A17_6B3D_4E85_B0F1_7A9D2C5E8F31
+#define SRC_LIB_MEMCHECK_HPP_9E2C4A17_6B3D_4E85_B0F1_7A9D2C5E8F31
+
+/**
+ * Hooks into the memory allocation override in memcheck.cpp.
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+
+namespace fluffy
+{
+namespace memcheck
+{
+/**
+ * True when malloc/calloc/realloc/free and new/delete are overridden, i.e when built with FLUFFY_OVR_MEMALLOC.
+ */
+auto IsActive() -> bool;
+
+/**
+ * Number of calls to malloc, calloc and realloc (and thereby operator new and new[]) since the program started.
+ * Always 0 when the override is not active.
+ */
+auto NumAllocations() -> std::size_t;
+
+};  // end of namespace memcheck
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,240 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+
+#include "mesh.hpp"
+#include "triangle2d.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+//------------------------------------------------------------------------------
+auto AddVertex(mesh& Mesh,             //!<
+               math3d::tup const& P,   //!<
+               math3d::tup const& Col  //!<
+               )                       //!<
+    -> uint32_t
+{
+   auto const Idx = static_cast<uint32_t>(Mesh.X.size());
+   Mesh.X.push_back(P.X);
+   Mesh.Y.push_back(P.Y);
+   Mesh.Z.push_back(P.Z);
+   Mesh.vColors.push_back(Col);
+   return Idx;
+}
+
+//------------------------------------------------------------------------------
+auto AddTriangle(mesh& Mesh,   //!<
+                 uint32_t I0,  //!<
+                 uint32_t I1,  //!<
+                 uint32_t I2   //!<
+                 )             //!<
+    -> void
+{
+   Mesh.vIndices.push_back(I0);
+   Mesh.vIndices.push_back(I1);
+   Mesh.vIndices.push_back(I2);
+}
+
+//------------------------------------------------------------------------------
+auto AddEdge(mesh& Mesh,   //!<
+             uint32_t I0,  //!<
+             uint32_t I1   //!<
+             )             //!<
+    -> void
+{
+   Mesh.vEdges.push_back(I0);
+   Mesh.vEdges.push_back(I1);
+}
+
+//------------------------------------------------------------------------------
+auto NumVertices(mesh_view const& Mesh) -> std::size_t
+{
+   return Mesh.X.size();
+}
+
+//------------------------------------------------------------------------------
+auto NumTriangles(mesh_view const& Mesh) -> std::size_t
+{
+   return Mesh.vIndices.size() / 3;
+}
+
+//------------------------------------------------------------------------------
+auto NumEdges(mesh_view const& Mesh) -> std::size_t
+{
+   return Mesh.vEdges.size() / 2;
+}
+
+//------------------------------------------------------------------------------
+auto ToMesh(mesh_view const& View) -> mesh
+{
+   mesh Mesh{};
+   Mesh.X.assign(View.X.begin(), View.X.end());
+   Mesh.Y.assign(View.Y.begin(), View.Y.end());
+   Mesh.Z.assign(View.Z.begin(), View.Z.end());
+   Mesh.vColors.assign(View.vColors.begin(), View.vColors.end());
+   Mesh.vIndices.assign(View.vIndices.begin(), View.vIndices.end());
+   Mesh.vEdges.assign(View.vEdges.begin(), View.vEdges.end());
+   return Mesh;
+}
+
+//------------------------------------------------------------------------------
+auto MeshBounds(mesh_view const& Mesh,  //!<
+                math3d::tup& Min,       //!<
+                math3d::tup& Max        //!<
+                )                       //!<
+    -> bool
+{
+   if (NumVertices(Mesh) == 0) return false;
+
+   auto const [MinX, MaxX] = std::minmax_element(Mesh.X.begin(), Mesh.X.end());
+   auto const [MinY, MaxY] = std::minmax_element(Mesh.Y.begin(), Mesh.Y.end());
+   auto const [MinZ, MaxZ] = std::minmax_element(Mesh.Z.begin(), Mesh.Z.end());
+   Min = math3d::Point(*MinX, *MinY, *MinZ);
+   Max = math3d::Point(*MaxX, *MaxY, *MaxZ);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto DeduplicateEdges(mesh& Mesh) -> void
+{
+   /**
+    * Pack each edge into one key with the lower index in the high half, so sorting the keys
+    * puts the copies of an edge next to each other.
+    */
+   std::vector<uint64_t> vKeys{};
+   vKeys.reserve(NumEdges(Mesh));
+   for (std::size_t Idx = 0; Idx + 1 < Mesh.vEdges.size(); Idx += 2)
+   {
+      auto const [Lo, Hi] = std::minmax(Mesh.vEdges[Idx], Mesh.vEdges[Idx + 1]);
+      if (Lo != Hi) vKeys.push_back(uint64_t(Lo) << 32 | Hi);
+   }
+   std::sort(vKeys.begin(), vKeys.end());
+   vKeys.erase(std::unique(vKeys.begin(), vKeys.end()), vKeys.end());
+
+   Mesh.vEdges.resize(2 * vKeys.size());
+   for (std::size_t Idx = 0; Idx < vKeys.size(); ++Idx)
+   {
+      Mesh.vEdges[2 * Idx] = static_cast<uint32_t>(vKeys[Idx] >> 32);
+      Mesh.vEdges[2 * Idx + 1] = static_cast<uint32_t>(vKeys[Idx]);
+   }
+}
+
+//------------------------------------------------------------------------------
+auto EdgesFromTriangles(mesh& Mesh) -> void
+{
+   Mesh.vEdges.reserve(Mesh.vEdges.size() + 2 * Mesh.vIndices.size());
+   for (std::size_t Triangle = 0; Triangle < NumTriangles(Mesh); ++Triangle)
+   {
+      auto const* ptrIdx = &Mesh.vIndices[3 * Triangle];
+      AddEdge(Mesh, ptrIdx[0], ptrIdx[1]);
+      AddEdge(Mesh, ptrIdx[1], ptrIdx[2]);
+      AddEdge(Mesh, ptrIdx[2], ptrIdx[0]);
+   }
+   DeduplicateEdges(Mesh);
+}
+
+//------------------------------------------------------------------------------
+auto TransformMesh(mesh_view const& Mesh,                   //!<
+                   math3d::matrix const& MatrixConversion,  //!<
+                   std::vector<vertice_3d>& vProjected      //!<
+                   )                                        //!<
+    -> void
+{
+   auto const Num = NumVertices(Mesh);
+   auto const NumColors = std::min(Num, Mesh.vColors.size());
+   auto const DefaultColor = vertice_3d{}.Col;
+   vProjected.resize(Num);
+   for (std::size_t Idx = 0; Idx < Num; ++Idx)
+   {
+      auto const P = math3d::Point(Mesh.X[Idx], Mesh.Y[Idx], Mesh.Z[Idx]);
+      vProjected[Idx] = ProjectVertice(MatrixConversion, P, Idx < NumColors ? Mesh.vColors[Idx] : DefaultColor);
+   }
+}
+
+//------------------------------------------------------------------------------
+auto DrawMesh(render_target& Target,                  //!<
+              mesh_view const& Mesh,                  //!<
+              std::span<vertice_3d const> Projected,  //!<
+              cull_mode Cull                          //!<
+              )                                       //!<
+    -> mesh_stats
+{
+   mesh_stats Stats{};
+   Stats.NumTriangles = NumTriangles(Mesh);
+
+   for (std::size_t Triangle = 0; Triangle < Stats.NumTriangles; ++Triangle)
+   {
+      auto const* ptrIdx = &Mesh.vIndices[3 * Triangle];
+      if (ptrIdx[0] >= Projected.size() || ptrIdx[1] >= Projected.size() || ptrIdx[2] >= Projected.size())
+      {
+         ++Stats.NumRejected;
+         continue;
+      }
+
+      auto const& V0 = Projected[ptrIdx[0]];
+      auto const& V1 = Projected[ptrIdx[1]];
+      auto const& V2 = Projected[ptrIdx[2]];
+
+      /**
+       * The screen position is only meaningful in front of the eye, so test W before the winding.
+       */
+      if (V0.W <= 0 || V1.W <= 0 || V2.W <= 0)
+      {
+         ++Stats.NumClipped;
+         continue;
+      }
+
+      vertice_2d const P0{V0.X, V0.Y};
+      auto const Facing = Cross(Vector(P0, {V1.X, V1.Y}), Vector(P0, {V2.X, V2.Y}));
+      if (Facing == 0 || (Cull == cull_mode::BACK && Facing < 0) || (Cull == cull_mode::FRONT && Facing > 0))
+      {
+         ++Stats.NumCulled;
+         continue;
+      }
+
+      DrawTriangle(Target, V0, V1, V2);
+      ++Stats.NumDrawn;
+   }
+
+   return Stats;
+}
+
+//------------------------------------------------------------------------------
+auto DrawWireframe(render_target& Target,                  //!<
+                   mesh_view const& Mesh,                  //!<
+                   std::span<vertice_3d const> Projected,  //!<
+                   Uint32 Color,                           //!<
+                   bool UseColorGradient                   //!<
+                   )                                       //!<
+    -> std::size_t
+{
+   return DrawEdges(Target, Projected, Mesh.vEdges, Color, UseColorGradient);
+}
+
+};  // end of namespace render
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,195 @@
+#ifndef SRC_LIB_MESH_HPP_46763FF5_D1AD_435E_8F01_89BC889350A9
+#define SRC_LIB_MESH_HPP_46763FF5_D1AD_435E_8F01_89BC889350A9
+
+/**
+ * Indexed triangle meshes. The vertices are stored once and the triangles refer to them
+ * through an index buffer, so a vertex shared by several triangles is transformed once.
+ * Drawing is split in two stages:
+ *  - TransformMesh() projects every vertex into a caller owned cache.
+ *  - DrawMesh() assembles the triangles from the indices, culls the back faces and
+ *    rasterizes the rest with the depth tested DrawTriangle().
+ * Between the two the caller is free to move the projected vertices around on the screen.
+ * DrawWireframe() draws the edge list of the mesh from the same projected vertices.
+ * The drawing functions take a mesh_view, so arrays that live elsewhere, e.g in a mapped
+ * geometry cache, are drawn in place.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "drawprimitives.hpp"
+#include "fluffymath.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+/**
+ * Vertex positions as one array per coordinate, and three indices per triangle.
+ */
+struct mesh
+{
+   std::vector<math3d::FLOAT> X{};      //!<
+   std::vector<math3d::FLOAT> Y{};      //!<
+   std::vector<math3d::FLOAT> Z{};      //!<
+   std::vector<math3d::tup> vColors{};  //!< R, G, B in the range 0..1, one per vertex.
+   std::vector<uint32_t> vIndices{};    //!< Front faces are clockwise on the screen, see DrawMesh().
+   std::vector<uint32_t> vEdges{};      //!< Two indices per edge, for DrawWireframe().
+};
+
+/**
+ * Read only view of the arrays of a mesh.
+ */
+struct mesh_view
+{
+   mesh_view() = default;
+   mesh_view(mesh const& Mesh)
+       : X(Mesh.X), Y(Mesh.Y), Z(Mesh.Z), vColors(Mesh.vColors), vIndices(Mesh.vIndices), vEdges(Mesh.vEdges)
+   {
+   }
+
+   std::span<math3d::FLOAT const> X{};      //!<
+   std::span<math3d::FLOAT const> Y{};      //!<
+   std::span<math3d::FLOAT const> Z{};      //!<
+   std::span<math3d::tup const> vColors{};  //!<
+   std::span<uint32_t const> vIndices{};    //!<
+   std::span<uint32_t const> vEdges{};      //!<
+};
+
+enum class cull_mode
+{
+   NONE = 0,   //!<
+   BACK = 1,   //!< Skip the triangles that are counter clockwise on the screen.
+   FRONT = 2,  //!< Skip the triangles that are clockwise on the screen.
+};
+
+struct mesh_stats
+{
+   std::size_t NumTriangles{};  //!< Assembled from the index buffer.
+   std::size_t NumCulled{};     //!< Facing the wrong way or degenerate.
+   std::size_t NumClipped{};    //!< Having a vertex behind the eye, i.e W <= 0.
+   std::size_t NumRejected{};   //!< Having an index outside the projected vertices.
+   std::size_t NumDrawn{};      //!<
+};
+
+//------------------------------------------------------------------------------
+// NOTE: Declarations
+//------------------------------------------------------------------------------
+
+auto AddVertex(mesh& Mesh,             //!<
+               math3d::tup const& P,   //!<
+               math3d::tup const& Col  //!<
+               )                       //!<
+    -> uint32_t;
+
+auto AddTriangle(mesh& Mesh,   //!<
+                 uint32_t I0,  //!<
+                 uint32_t I1,  //!<
+                 uint32_t I2   //!<
+                 )             //!<
+    -> void;
+
+auto AddEdge(mesh& Mesh,   //!<
+             uint32_t I0,  //!<
+             uint32_t I1   //!<
+             )             //!<
+    -> void;
+
+auto NumVertices(mesh_view const& Mesh) -> std::size_t;
+
+auto NumTriangles(mesh_view const& Mesh) -> std::size_t;
+
+auto NumEdges(mesh_view const& Mesh) -> std::size_t;
+
+/**
+ * Copy the arrays of the view into a mesh that can be edited.
+ */
+auto ToMesh(mesh_view const& View) -> mesh;
+
+/**
+ * Axis aligned box around the vertices, e.g for TestBoundingBox() before the mesh is transformed.
+ * Returns false, leaving Min and Max as they are, when the mesh has no vertices.
+ */
+auto MeshBounds(mesh_view const& Mesh,  //!<
+                math3d::tup& Min,       //!<
+                math3d::tup& Max        //!<
+                )                       //!<
+    -> bool;
+
+/**
+ * Remove the edges that are given more than once, in either direction, and the degenerate ones.
+ * The edges are left sorted with the lower index first.
+ */
+auto DeduplicateEdges(mesh& Mesh) -> void;
+
+/**
+ * Add the three edges of each triangle to the edge list and deduplicate it, so an edge
+ * shared by two triangles is drawn once.
+ */
+auto EdgesFromTriangles(mesh& Mesh) -> void;
+
+/**
+ * Project each vertex of the mesh once. vProjected is resized to the number of vertices,
+ * so a vector kept between frames does not allocate. Vertices without a color in vColors get
+ * the default color of vertice_3d.
+ */
+auto TransformMesh(mesh_view const& Mesh,                   //!<
+                   math3d::matrix const& MatrixConversion,  //!< To screen, as for ProjectVertice().
+                   std::vector<vertice_3d>& vProjected      //!<
+                   )                                        //!<
+    -> void;
+
+/**
+ * Draw the triangles of the mesh from the projected vertices with depth test.
+ * A triangle faces the front when Cross() of its first two edges on the screen is positive,
+ * which is the clockwise order FillTriangle() wants. Triangles with an index outside Projected
+ * are skipped and counted in NumRejected.
+ */
+auto DrawMesh(render_target& Target,                  //!<
+              mesh_view const& Mesh,                  //!<
+              std::span<vertice_3d const> Projected,  //!< From TransformMesh().
+              cull_mode Cull = cull_mode::BACK        //!<
+              )                                       //!<
+    -> mesh_stats;
+
+/**
+ * Draw the edges of the mesh from the projected vertices in one DrawEdges() call.
+ * There is no depth test, and edges with a vertex behind the eye are skipped.
+ * Returns the number of edges drawn.
+ */
+auto DrawWireframe(render_target& Target,                  //!<
+                   mesh_view const& Mesh,                  //!<
+                   std::span<vertice_3d const> Projected,  //!< From TransformMesh().
+                   Uint32 Color,                           //!<
+                   bool UseColorGradient                   //!<
+                   )                                       //!<
+    -> std::size_t;
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,866 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "meshloader.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+namespace
+{
+/**
+ * Chunks smaller than this are not worth a thread of their own.
+ */
+constexpr std::size_t MIN_CHUNK_BYTES = std::size_t(1) << 16;
+constexpr std::size_t MIN_CHUNK_ITEMS = std::size_t(1) << 14;
+
+//------------------------------------------------------------------------------
+auto NumChunks(std::size_t Num,          //!<
+               std::size_t MinPerChunk,  //!<
+               unsigned NumThreads       //!<
+               )                         //!<
+    -> std::size_t
+{
+   if (NumThreads == 0) NumThreads = std::max(1u, std::thread::hardware_concurrency());
+   return std::clamp<std::size_t>(Num / MinPerChunk, 1, NumThreads);
+}
+
+/**
+ * Call Fn(Chunk) for each of the chunks, the first one on the calling thread.
+ */
+template <typename FN>
+auto ParallelFor(std::size_t NumChunks, FN Fn) -> void
+{
+   std::vector<std::thread> vThreads{};
+   vThreads.reserve(NumChunks);
+   for (std::size_t Chunk = 1; Chunk < NumChunks; ++Chunk) vThreads.emplace_back(Fn, Chunk);
+   Fn(std::size_t(0));
+   for (auto& Thread : vThreads) Thread.join();
+}
+
+/**
+ * First item of Chunk when Num items are split in NumChunks.
+ */
+auto ChunkBegin(std::size_t Num, std::size_t NumChunks, std::size_t Chunk) -> std::size_t
+{
+   return Num / NumChunks * Chunk + std::min(Num % NumChunks, Chunk);
+}
+
+//------------------------------------------------------------------------------
+auto ResizeVertices(mesh& Mesh, std::size_t Num) -> void
+{
+   Mesh.X.resize(Num);
+   Mesh.Y.resize(Num);
+   Mesh.Z.resize(Num);
+   Mesh.vColors.resize(Num, math3d::tup{1, 1, 1, 0});
+}
+
+/**
+ * All the indices must refer to a vertex.
+ */
+auto IndicesInRange(mesh const& Mesh) -> bool
+{
+   auto const Num = NumVertices(Mesh);
+   return std::all_of(Mesh.vIndices.begin(), Mesh.vIndices.end(), [Num](uint32_t Idx) { return Idx < Num; });
+}
+
+//------------------------------------------------------------------------------
+// NOTE: OBJ
+//------------------------------------------------------------------------------
+
+auto IsBlank(char C) -> bool
+{
+   return C == ' ' || C == '\t' || C == '\r';
+}
+
+auto SkipBlanks(char const* ptr, char const* ptrEnd) -> char const*
+{
+   while (ptr < ptrEnd && IsBlank(*ptr)) ++ptr;
+   return ptr;
+}
+
+auto SkipWord(char const* ptr, char const* ptrEnd) -> char const*
+{
+   while (ptr < ptrEnd && !IsBlank(*ptr)) ++ptr;
+   return ptr;
+}
+
+auto LineEnd(char const* ptr, char const* ptrEnd) -> char const*
+{
+   auto const* ptrNewLine = static_cast<char const*>(std::memchr(ptr, '\n', std::size_t(ptrEnd - ptr)));
+   return ptrNewLine ? ptrNewLine : ptrEnd;
+}
+
+enum class obj_line
+{
+   OTHER = 0,   //!< Comments, normals, texture coordinates, groups, materials...
+   VERTEX = 1,  //!<
+   FACE = 2,    //!<
+};
+
+/**
+ * Type of the line, and ptr moved past the keyword.
+ */
+auto LineType(char const*& ptr, char const* ptrEnd) -> obj_line
+{
+   ptr = SkipBlanks(ptr, ptrEnd);
+   if (ptrEnd - ptr < 2 || !IsBlank(ptr[1])) return obj_line::OTHER;
+   if (ptr[0] == 'v')
+   {
+      ptr += 2;
+      return obj_line::VERTEX;
+   }
+   if (ptr[0] == 'f')
+   {
+      ptr += 2;
+      return obj_line::FACE;
+   }
+   return obj_line::OTHER;
+}
+
+auto CountWords(char const* ptr, char const* ptrEnd) -> std::size_t
+{
+   std::size_t Num{};
+   for (ptr = SkipBlanks(ptr, ptrEnd); ptr < ptrEnd; ptr = SkipBlanks(SkipWord(ptr, ptrEnd), ptrEnd)) ++Num;
+   return Num;
+}
+
+struct obj_chunk
+{
+   char const* ptrBegin{};       //!< Starts at the beginning of a line.
+   char const* ptrEnd{};         //!< Ends after a line break, or at the end of the text.
+   std::size_t NumVertices{};    //!<
+   std::size_t NumTriangles{};   //!<
+   std::size_t FirstVertex{};    //!< Where the chunk writes in the mesh.
+   std::size_t FirstTriangle{};  //!<
+   bool Ok{true};                //!<
+};
+
+/**
+ * First pass, count what the chunk will write.
+ */
+auto CountObj(obj_chunk& Chunk) -> void
+{
+   for (auto const* ptr = Chunk.ptrBegin; ptr < Chunk.ptrEnd;)
+   {
+      auto const* ptrLineEnd = LineEnd(ptr, Chunk.ptrEnd);
+      switch (LineType(ptr, ptrLineEnd))
+      {
+         case obj_line::VERTEX:
+            ++Chunk.NumVertices;
+            break;
+         case obj_line::FACE:
+            Chunk.NumTriangles += std::max<std::size_t>(CountWords(ptr, ptrLineEnd), 2) - 2;
+            break;
+         default:
+            break;
+      }
+      ptr = ptrLineEnd + 1;
+   }
+}
+
+/**
+ * Parse the v line "x y z [r g b]". A fourth number alone is the optional w, and is ignored.
+ */
+auto ParseVertex(char const* ptr,     //!<
+                 char const* ptrEnd,  //!<
+                 mesh& Mesh,          //!<
+                 std::size_t Idx      //!<
+                 )                    //!<
+    -> bool
+{
+   math3d::FLOAT Values[7]{};
+   std::size_t Num{};
+   for (ptr = SkipBlanks(ptr, ptrEnd); ptr < ptrEnd && Num < std::size(Values); ptr = SkipBlanks(ptr, ptrEnd))
+   {
+      if (*ptr == '+') ++ptr;
+      auto const [ptrNext, Error] = std::from_chars(ptr, ptrEnd, Values[Num]);
+      if (Error != std::errc{} || (ptrNext < ptrEnd && !IsBlank(*ptrNext))) return false;
+      ptr = ptrNext;
+      ++Num;
+   }
+   if (Num < 3 || ptr < ptrEnd) return false;
+
+   Mesh.X[Idx] = Values[0];
+   Mesh.Y[Idx] = Values[1];
+   Mesh.Z[Idx] = Values[2];
+   if (Num >= 6) Mesh.vColors[Idx] = {Values[3], Values[4], Values[5], 0};
+   return true;
+}
+
+/**
+ * Parse the f line "v0 v1 v2 ..." into a fan of triangles. Each index may be followed by
+ * /vt, /vt/vn or //vn. Negative indices count back from the last vertex so far.
+ */
+auto ParseFace(char const* ptr,               //!<
+               char const* ptrEnd,            //!<
+               std::size_t NumVerticesSoFar,  //!<
+               uint32_t*& ptrIndices          //!< Moved past the triangles written.
+               )                              //!<
+    -> bool
+{
+   std::size_t Num{};
+   uint32_t First{};
+   uint32_t Prev{};
+   for (ptr = SkipBlanks(ptr, ptrEnd); ptr < ptrEnd; ptr = SkipBlanks(ptr, ptrEnd))
+   {
+      long long Idx{};
+      auto const [ptrNext, Error] = std::from_chars(ptr, ptrEnd, Idx);
+      if (Error != std::errc{} || Idx == 0) return false;
+      if (ptrNext < ptrEnd && !IsBlank(*ptrNext) && *ptrNext != '/') return false;
+      Idx = Idx > 0 ? Idx - 1 : static_cast<long long>(NumVerticesSoFar) + Idx;
+      if (Idx < 0 || Idx > std::numeric_limits<uint32_t>::max()) return false;
+      ptr = SkipWord(ptrNext, ptrEnd);
+
+      auto const Current = static_cast<uint32_t>(Idx);
+      if (Num == 0) First = Current;
+      if (Num >= 2)
+      {
+         *ptrIndices++ = First;
+         *ptrIndices++ = Prev;
+         *ptrIndices++ = Current;
+      }
+      Prev = Current;
+      ++Num;
+   }
+   return true;
+}
+
+/**
+ * Second pass, parse the chunk into the part of the mesh counted for it.
+ */
+auto ParseObj(obj_chunk& Chunk, mesh& Mesh) -> void
+{
+   auto Vertex = Chunk.FirstVertex;
+   auto* ptrIndices = Mesh.vIndices.data() + 3 * Chunk.FirstTriangle;
+   for (auto const* ptr = Chunk.ptrBegin; ptr < Chunk.ptrEnd && Chunk.Ok;)
+   {
+      auto const* ptrLineEnd = LineEnd(ptr, Chunk.ptrEnd);
+      switch (LineType(ptr, ptrLineEnd))
+      {
+         case obj_line::VERTEX:
+            Chunk.Ok = ParseVertex(ptr, ptrLineEnd, Mesh, Vertex++);
+            break;
+         case obj_line::FACE:
+            Chunk.Ok = ParseFace(ptr, ptrLineEnd, Vertex, ptrIndices);
+            break;
+         default:
+            break;
+      }
+      ptr = ptrLineEnd + 1;
+   }
+}
+
+//------------------------------------------------------------------------------
+// NOTE: PLY
+//------------------------------------------------------------------------------
+
+enum class ply_type
+{
+   NONE = 0,     //!<
+   INT8 = 1,     //!<
+   UINT8 = 2,    //!<
+   INT16 = 3,    //!<
+   UINT16 = 4,   //!<
+   INT32 = 5,    //!<
+   UINT32 = 6,   //!<
+   FLOAT32 = 7,  //!<
+   FLOAT64 = 8,  //!<
+};
+
+auto PlyType(std::string_view Name) -> ply_type
+{
+   if (Name == "char" || Name == "int8") return ply_type::INT8;
+   if (Name == "uchar" || Name == "uint8") return ply_type::UINT8;
+   if (Name == "short" || Name == "int16") return ply_type::INT16;
+   if (Name == "ushort" || Name == "uint16") return ply_type::UINT16;
+   if (Name == "int" || Name == "int32") return ply_type::INT32;
+   if (Name == "uint" || Name == "uint32") return ply_type::UINT32;
+   if (Name == "float" || Name == "float32") return ply_type::FLOAT32;
+   if (Name == "double" || Name == "float64") return ply_type::FLOAT64;
+   return ply_type::NONE;
+}
+
+auto SizeOf(ply_type Type) -> std::size_t
+{
+   switch (Type)
+   {
+      case ply_type::INT8:
+      case ply_type::UINT8:
+         return 1;
+      case ply_type::INT16:
+      case ply_type::UINT16:
+         return 2;
+      case ply_type::INT32:
+      case ply_type::UINT32:
+      case ply_type::FLOAT32:
+         return 4;
+      case ply_type::FLOAT64:
+         return 8;
+      default:
+         return 0;
+   }
+}
+
+/**
+ * Load a T from unaligned memory, swapping the bytes if the file has the other byte order.
+ */
+template <typename T>
+auto Load(char const* ptr, bool Swap) -> T
+{
+   char Bytes[sizeof(T)];
+   std::memcpy(Bytes, ptr, sizeof(T));
+   if (Swap) std::reverse(std::begin(Bytes), std::end(Bytes));
+   T Value;
+   std::memcpy(&Value, Bytes, sizeof(T));
+   return Value;
+}
+
+template <typename R>
+auto ReadAs(char const* ptr, ply_type Type, bool Swap) -> R
+{
+   switch (Type)
+   {
+      case ply_type::INT8:
+         return static_cast<R>(Load<int8_t>(ptr, Swap));
+      case ply_type::UINT8:
+         return static_cast<R>(Load<uint8_t>(ptr, Swap));
+      case ply_type::INT16:
+         return static_cast<R>(Load<int16_t>(ptr, Swap));
+      case ply_type::UINT16:
+         return static_cast<R>(Load<uint16_t>(ptr, Swap));
+      case ply_type::INT32:
+         return static_cast<R>(Load<int32_t>(ptr, Swap));
+      case ply_type::UINT32:
+         return static_cast<R>(Load<uint32_t>(ptr, Swap));
+      case ply_type::FLOAT32:
+         return static_cast<R>(Load<float>(ptr, Swap));
+      case ply_type::FLOAT64:
+         return static_cast<R>(Load<double>(ptr, Swap));
+      default:
+         return R{};
+   }
+}
+
+struct ply_property
+{
+   std::string_view Name{};  //!<
+   ply_type Type{};          //!< Of the value, or of the list items.
+   ply_type CountType{};     //!< Of the list count, NONE for a single value.
+   std::size_t Offset{};     //!< From the start of the element, when the element has no lists.
+};
+
+struct ply_element
+{
+   std::string_view Name{};                  //!<
+   std::size_t Count{};                      //!<
+   std::vector<ply_property> vProperties{};  //!<
+   std::size_t Stride{};                     //!< Bytes per item, when it has no lists.
+   bool HasList{};                           //!<
+};
+
+struct ply_header
+{
+   bool Swap{};                           //!< The file has the other byte order.
+   std::vector<ply_element> vElements{};  //!<
+   std::size_t DataOffset{};              //!< Just after end_header.
+};
+
+auto FindProperty(ply_element const& Element, std::string_view Name) -> ply_property const*
+{
+   for (auto const& Property : Element.vProperties)
+   {
+      if (Property.Name == Name) return &Property;
+   }
+   return nullptr;
+}
+
+/**
+ * Split Line in at most std::size(Words) words separated by blanks. Returns the number of words.
+ */
+template <std::size_t N>
+auto SplitWords(std::string_view Line, std::string_view (&Words)[N]) -> std::size_t
+{
+   std::size_t Num{};
+   auto const* ptrEnd = Line.data() + Line.size();
+   for (auto const* ptr = SkipBlanks(Line.data(), ptrEnd); ptr < ptrEnd && Num < N; ptr = SkipBlanks(ptr, ptrEnd))
+   {
+      auto const* ptrWordEnd = SkipWord(ptr, ptrEnd);
+      Words[Num++] = std::string_view(ptr, std::size_t(ptrWordEnd - ptr));
+      ptr = ptrWordEnd;
+   }
+   return Num;
+}
+
+auto ParsePlyHeader(std::string_view Data, ply_header& Header) -> bool
+{
+   if (!Data.starts_with("ply\n") && !Data.starts_with("ply\r\n")) return false;
+
+   bool HasFormat{};
+   auto const* ptrEnd = Data.data() + Data.size();
+   for (auto const* ptr = Data.data(); ptr < ptrEnd;)
+   {
+      auto const* ptrLineEnd = LineEnd(ptr, ptrEnd);
+      std::string_view Words[6]{};
+      auto const Num = SplitWords(std::string_view(ptr, std::size_t(ptrLineEnd - ptr)), Words);
+      ptr = ptrLineEnd + 1;
+
+      if (Num == 0 || Words[0] == "ply" || Words[0] == "comment" || Words[0] == "obj_info") continue;
+      if (Words[0] == "end_header")
+      {
+         Header.DataOffset = std::min(std::size_t(ptr - Data.data()), Data.size());
+         return HasFormat;
+      }
+      if (Words[0] == "format" && Num >= 2)
+      {
+         if (Words[1] != "binary_little_endian" && Words[1] != "binary_big_endian") return false;
+         Header.Swap = (Words[1] == "binary_big_endian") != (std::endian::native == std::endian::big);
+         HasFormat = true;
+      }
+      else if (Words[0] == "element" && Num >= 3)
+      {
+         ply_element Element{};
+         Element.Name = Words[1];
+         auto const* ptrCount = Words[2].data();
+         auto const [ptrNext, Error] = std::from_chars(ptrCount, ptrCount + Words[2].size(), Element.Count);
+         if (Error != std::errc{}) return false;
+         Header.vElements.push_back(Element);
+      }
+      else if (Words[0] == "property" && !Header.vElements.empty())
+      {
+         auto& Element = Header.vElements.back();
+         ply_property Property{};
+         if (Num >= 5 && Words[1] == "list")
+         {
+            Property.CountType = PlyType(Words[2]);
+            Property.Type = PlyType(Words[3]);
+            Property.Name = Words[4];
+            if (Property.CountType == ply_type::NONE || Property.CountType == ply_type::FLOAT32 ||
+                Property.CountType == ply_type::FLOAT64)
+               return false;
+            Element.HasList = true;
+         }
+         else if (Num >= 3)
+         {
+            Property.Type = PlyType(Words[1]);
+            Property.Name = Words[2];
+            Property.Offset = Element.Stride;
+            Element.Stride += SizeOf(Property.Type);
+         }
+         if (Property.Type == ply_type::NONE) return false;
+         Element.vProperties.push_back(Property);
+      }
+      else
+      {
+         return false;
+      }
+   }
+   return false;
+}
+
+/**
+ * Step past one item of an element with lists. Calls Fn(Property, ptrItems, NumItems) for each list.
+ * Returns nullptr if the item does not fit before ptrEnd.
+ */
+template <typename FN>
+auto WalkItem(ply_element const& Element, char const* ptr, char const* ptrEnd, bool Swap, FN Fn) -> char const*
+{
+   for (auto const& Property : Element.vProperties)
+   {
+      if (Property.CountType == ply_type::NONE)
+      {
+         if (std::size_t(ptrEnd - ptr) < SizeOf(Property.Type)) return nullptr;
+         ptr += SizeOf(Property.Type);
+         continue;
+      }
+      if (std::size_t(ptrEnd - ptr) < SizeOf(Property.CountType)) return nullptr;
+      auto const Count = ReadAs<long long>(ptr, Property.CountType, Swap);
+      ptr += SizeOf(Property.CountType);
+      if (Count < 0 || std::size_t(Count) > std::size_t(ptrEnd - ptr) / SizeOf(Property.Type)) return nullptr;
+      Fn(Property, ptr, std::size_t(Count));
+      ptr += std::size_t(Count) * SizeOf(Property.Type);
+   }
+   return ptr;
+}
+
+auto LoadPlyVertices(ply_element const& Element,  //!<
+                     char const* ptr,             //!<
+                     bool Swap,                   //!<
+                     unsigned NumThreads,         //!<
+                     mesh& Mesh                   //!<
+                     )                            //!<
+    -> bool
+{
+   auto const* ptrX = FindProperty(Element, "x");
+   auto const* ptrY = FindProperty(Element, "y");
+   auto const* ptrZ = FindProperty(Element, "z");
+   if (!ptrX || !ptrY || !ptrZ) return false;
+
+   /** Integer colors are 0..255, floating point ones are used as they are. */
+   ply_property const* ptrColors[3] = {FindProperty(Element, "red"), FindProperty(Element, "green"),
+                                       FindProperty(Element, "blue")};
+   bool const HasColors = ptrColors[0] && ptrColors[1] && ptrColors[2];
+   auto Scale = [](ply_property const* ptrProperty) -> math3d::FLOAT
+   { return ptrProperty->Type == ply_type::FLOAT32 || ptrProperty->Type == ply_type::FLOAT64 ? 1 : 1. / 255; };
+
+   ResizeVertices(Mesh, Element.Count);
+   auto const Num = NumChunks(Element.Count, MIN_CHUNK_ITEMS, NumThreads);
+   ParallelFor(Num,
+               [&](std::size_t Chunk)
+               {
+                  auto const End = ChunkBegin(Element.Count, Num, Chunk + 1);
+                  for (auto Idx = ChunkBegin(Element.Count, Num, Chunk); Idx < End; ++Idx)
+                  {
+                     auto const* ptrItem = ptr + Idx * Element.Stride;
+                     Mesh.X[Idx] = ReadAs<math3d::FLOAT>(ptrItem + ptrX->Offset, ptrX->Type, Swap);
+                     Mesh.Y[Idx] = ReadAs<math3d::FLOAT>(ptrItem + ptrY->Offset, ptrY->Type, Swap);
+                     Mesh.Z[Idx] = ReadAs<math3d::FLOAT>(ptrItem + ptrZ->Offset, ptrZ->Type, Swap);
+                     if (!HasColors) continue;
+                     auto& Col = Mesh.vColors[Idx];
+                     Col.X = ReadAs<math3d::FLOAT>(ptrItem + ptrColors[0]->Offset, ptrColors[0]->Type, Swap) *
+                             Scale(ptrColors[0]);
+                     Col.Y = ReadAs<math3d::FLOAT>(ptrItem + ptrColors[1]->Offset, ptrColors[1]->Type, Swap) *
+                             Scale(ptrColors[1]);
+                     Col.Z = ReadAs<math3d::FLOAT>(ptrItem + ptrColors[2]->Offset, ptrColors[2]->Type, Swap) *
+                             Scale(ptrColors[2]);
+                  }
+               });
+   return true;
+}
+
+/**
+ * Faces that are all triangles have a fixed size, so they are read in parallel. The counts are
+ * checked first: when the count at each assumed offset is 3, the assumed layout is the real one.
+ * Returns the end of the faces, or nullptr if they are not all triangles.
+ */
+auto LoadPlyTriangles(ply_element const& Element,    //!<
+                      ply_property const& Property,  //!<
+                      char const* ptr,               //!<
+                      char const* ptrEnd,            //!<
+                      bool Swap,                     //!<
+                      unsigned NumThreads,           //!<
+                      mesh& Mesh                     //!<
+                      )                              //!<
+    -> char const*
+{
+   auto const CountSize = SizeOf(Property.CountType);
+   auto const IndexSize = SizeOf(Property.Type);
+   auto const Stride = CountSize + 3 * IndexSize;
+   if (Element.vProperties.size() != 1 || Element.Count > std::size_t(ptrEnd - ptr) / Stride) return nullptr;
+
+   auto const Num = NumChunks(Element.Count, MIN_CHUNK_ITEMS, NumThreads);
+   std::atomic<bool> AllTriangles{true};
+   ParallelFor(Num,
+               [&](std::size_t Chunk)
+               {
+                  auto const End = ChunkBegin(Element.Count, Num, Chunk + 1);
+                  for (auto Idx = ChunkBegin(Element.Count, Num, Chunk); Idx < End; ++Idx)
+                  {
+                     if (ReadAs<long long>(ptr + Idx * Stride, Property.CountType, Swap) != 3)
+                     {
+                        AllTriangles = false;
+                        return;
+                     }
+                  }
+               });
+   if (!AllTriangles) return nullptr;
+
+   auto const First = Mesh.vIndices.size();
+   Mesh.vIndices.resize(First + 3 * Element.Count);
+   std::atomic<bool> InRange{true};
+   ParallelFor(Num,
+               [&](std::size_t Chunk)
+               {
+                  auto const End = ChunkBegin(Element.Count, Num, Chunk + 1);
+                  auto* ptrIndices = Mesh.vIndices.data() + First;
+                  for (auto Idx = ChunkBegin(Element.Count, Num, Chunk); Idx < End; ++Idx)
+                  {
+                     auto const* ptrItems = ptr + Idx * Stride + CountSize;
+                     for (std::size_t Corner = 0; Corner < 3; ++Corner)
+                     {
+                        auto const Index = ReadAs<long long>(ptrItems + Corner * IndexSize, Property.Type, Swap);
+                        if (Index < 0 || Index > std::numeric_limits<uint32_t>::max()) InRange = false;
+                        ptrIndices[3 * Idx + Corner] = static_cast<uint32_t>(Index);
+                     }
+                  }
+               });
+   return InRange ? ptr + Element.Count * Stride : nullptr;
+}
+
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+mapped_file::~mapped_file()
+{
+   UnmapFile(*this);
+}
+
+//------------------------------------------------------------------------------
+auto MapFile(mapped_file& File,       //!<
+             std::string const& Path  //!<
+             )                        //!<
+    -> bool
+{
+   UnmapFile(File);
+
+#ifndef _WIN32
+   auto const fd = ::open(Path.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+
+   struct stat Stat{};
+   if (::fstat(fd, &Stat) != 0)
+   {
+      ::close(fd);
+      return false;
+   }
+
+   File.Size = std::size_t(Stat.st_size);
+   if (File.Size > 0)
+   {
+      void* ptrMap = ::mmap(nullptr, File.Size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptrMap == MAP_FAILED)
+      {
+         ::close(fd);
+         File.Size = 0;
+         return false;
+      }
+      /**
+       * The advice values are not flags, so they are given one at the time. They are only hints,
+       * the file is read the same way when the kernel does not take them.
+       */
+      auto const Sequential = ::madvise(ptrMap, File.Size, MADV_SEQUENTIAL) == 0;
+      auto const WillNeed = ::madvise(ptrMap, File.Size, MADV_WILLNEED) == 0;
+      File.IsAdvised = Sequential && WillNeed;
+      File.ptrData = static_cast<char const*>(ptrMap);
+      File.IsMapped = true;
+   }
+   ::close(fd);
+   return true;
+#else
+   std::ifstream ifsFile(Path, std::ios::binary | std::ios::ate);
+   if (!ifsFile.is_open()) return false;
+   File.vCopy.resize(std::size_t(ifsFile.tellg()));
+   ifsFile.seekg(0);
+   ifsFile.read(File.vCopy.data(), std::streamsize(File.vCopy.size()));
+   File.ptrData = File.vCopy.data();
+   File.Size = File.vCopy.size();
+   return bool(ifsFile);
+#endif
+}
+
+//------------------------------------------------------------------------------
+auto UnmapFile(mapped_file& File) -> void
+{
+#ifndef _WIN32
+   if (File.IsMapped) ::munmap(const_cast<char*>(File.ptrData), File.Size);
+#endif
+   File.ptrData = nullptr;
+   File.Size = 0;
+   File.IsMapped = false;
+   File.IsAdvised = false;
+   File.vCopy = {};
+}
+
+//------------------------------------------------------------------------------
+auto LoadObj(mesh& Mesh,             //!<
+             std::string_view Text,  //!<
+             unsigned NumThreads     //!<
+             )                       //!<
+    -> bool
+{
+   Mesh = mesh{};
+
+   /**
+    * Split at the line breaks closest after an even split.
+    */
+   auto const Num = NumChunks(Text.size(), MIN_CHUNK_BYTES, NumThreads);
+   auto const* ptrEnd = Text.data() + Text.size();
+   std::vector<obj_chunk> vChunks(Num);
+   auto const* ptr = Text.data();
+   for (std::size_t Chunk = 0; Chunk < Num; ++Chunk)
+   {
+      vChunks[Chunk].ptrBegin = ptr;
+      auto const* ptrSplit = std::max(ptr, Text.data() + ChunkBegin(Text.size(), Num, Chunk + 1));
+      ptr = Chunk + 1 == Num ? ptrEnd : std::min(LineEnd(ptrSplit, ptrEnd) + 1, ptrEnd);
+      vChunks[Chunk].ptrEnd = ptr;
+   }
+
+   ParallelFor(Num, [&](std::size_t Chunk) { CountObj(vChunks[Chunk]); });
+
+   std::size_t NumVertices{};
+   std::size_t NumTriangles{};
+   for (auto& Chunk : vChunks)
+   {
+      Chunk.FirstVertex = NumVertices;
+      Chunk.FirstTriangle = NumTriangles;
+      NumVertices += Chunk.NumVertices;
+      NumTriangles += Chunk.NumTriangles;
+   }
+   if (NumVertices > std::numeric_limits<uint32_t>::max()) return false;
+
+   ResizeVertices(Mesh, NumVertices);
+   Mesh.vIndices.resize(3 * NumTriangles);
+   ParallelFor(Num, [&](std::size_t Chunk) { ParseObj(vChunks[Chunk], Mesh); });
+
+   bool const Ok = std::all_of(vChunks.begin(), vChunks.end(), [](obj_chunk const& Chunk) { return Chunk.Ok; });
+   if (!Ok || !IndicesInRange(Mesh))
+   {
+      Mesh = mesh{};
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto LoadPly(mesh& Mesh,             //!<
+             std::string_view Data,  //!<
+             unsigned NumThreads     //!<
+             )                       //!<
+    -> bool
+{
+   Mesh = mesh{};
+
+   ply_header Header{};
+   if (!ParsePlyHeader(Data, Header)) return false;
+
+   auto const* ptr = Data.data() + Header.DataOffset;
+   auto const* ptrEnd = Data.data() + Data.size();
+   auto const Swap = Header.Swap;
+   for (auto const& Element : Header.vElements)
+   {
+      ply_property const* ptrIndices{};
+      if (Element.Name == "face")
+      {
+         ptrIndices = FindProperty(Element, "vertex_indices");
+         if (!ptrIndices) ptrIndices = FindProperty(Element, "vertex_index");
+         if (ptrIndices && ptrIndices->CountType == ply_type::NONE) ptrIndices = nullptr;
+      }
+
+      if (Element.Name == "vertex")
+      {
+         if (Element.HasList || (Element.Stride && Element.Count > std::size_t(ptrEnd - ptr) / Element.Stride) ||
+             !LoadPlyVertices(Element, ptr, Swap, NumThreads, Mesh))
+            ptr = nullptr;
+         else
+            ptr += Element.Count * Element.Stride;
+      }
+      else if (ptrIndices)
+      {
+         if (auto const* ptrNext = LoadPlyTriangles(Element, *ptrIndices, ptr, ptrEnd, Swap, NumThreads, Mesh))
+         {
+            ptr = ptrNext;
+            continue;
+         }
+
+         /** Polygons, or other properties, so one face at a time. */
+         bool InRange{true};
+         for (std::size_t Idx = 0; Idx < Element.Count && ptr; ++Idx)
+         {
+            ptr = WalkItem(Element, ptr, ptrEnd, Swap,
+                           [&](ply_property const& Property, char const* ptrItems, std::size_t Num)
+                           {
+                              if (&Property != ptrIndices) return;
+                              auto Index = [&](std::size_t Corner) -> uint32_t
+                              {
+                                 auto const Value =
+                                     ReadAs<long long>(ptrItems + Corner * SizeOf(Property.Type), Property.Type, Swap);
+                                 if (Value < 0 || Value > std::numeric_limits<uint32_t>::max()) InRange = false;
+                                 return static_cast<uint32_t>(Value);
+                              };
+                              for (std::size_t Corner = 2; Corner < Num; ++Corner)
+                              {
+                                 Mesh.vIndices.push_back(Index(0));
+                                 Mesh.vIndices.push_back(Index(Corner - 1));
+                                 Mesh.vIndices.push_back(Index(Corner));
+                              }
+                           });
+         }
+         if (!InRange) ptr = nullptr;
+      }
+      else if (!Element.HasList)
+      {
+         if (Element.Stride && Element.Count > std::size_t(ptrEnd - ptr) / Element.Stride)
+            ptr = nullptr;
+         else
+            ptr += Element.Count * Element.Stride;
+      }
+      else
+      {
+         for (std::size_t Idx = 0; Idx < Element.Count && ptr; ++Idx)
+         {
+            ptr = WalkItem(Element, ptr, ptrEnd, Swap, [](ply_property const&, char const*, std::size_t) {});
+         }
+      }
+
+      if (!ptr) break;
+   }
+
+   if (!ptr || !IndicesInRange(Mesh))
+   {
+      Mesh = mesh{};
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto LoadMesh(mesh& Mesh,               //!<
+              std::string const& Path,  //!<
+              unsigned NumThreads       //!<
+              )                         //!<
+    -> bool
+{
+   mapped_file File{};
+   if (!MapFile(File, Path))
+   {
+      Mesh = mesh{};
+      return false;
+   }
+
+   std::string_view const Data(File.ptrData ? File.ptrData : "", File.Size);
+   if (Data.starts_with("ply")) return LoadPly(Mesh, Data, NumThreads);
+   return LoadObj(Mesh, Data, NumThreads);
+}
+
+};  // end of namespace render
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,123 @@
+#ifndef SRC_LIB_MESHLOADER_HPP_91C27519_ABB3_4FD5_833A_2BB274803F59
+#define SRC_LIB_MESHLOADER_HPP_91C27519_ABB3_4FD5_833A_2BB274803F59
+
+/**
+ * Mesh import from Wavefront OBJ and binary PLY files.
+ *
+ * The file is memory mapped and parsed in place with std::from_chars, straight into the
+ * per coordinate arrays and the index buffer of the mesh, without a string per line.
+ * Large files are split in chunks that are parsed on their own threads:
+ *  - OBJ is split at line breaks. A first pass counts the vertices and triangles of each
+ *    chunk, so the second pass knows where in the arrays each chunk writes.
+ *  - PLY vertices have a fixed size, so they are split by count. Faces are parsed in
+ *    parallel when they are all triangles, else one by one.
+ *
+ * Polygons are split in fans of triangles and keep the winding of the file.
+ * Usage:
+ *    mesh Mesh{};
+ *    if (!LoadMesh(Mesh, "bunny.ply")) ...
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mesh.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+/**
+ * Read only view of a whole file. Memory mapped where mmap() is available, else read into Copy.
+ */
+struct mapped_file
+{
+   mapped_file() = default;
+   mapped_file(mapped_file const&) = delete;
+   mapped_file& operator=(mapped_file const&) = delete;
+
+   /** Unmaps the file if UnmapFile() has not been called. */
+   ~mapped_file();
+
+   char const* ptrData{};      //!<
+   std::size_t Size{};         //!<
+   bool IsMapped{};            //!< ptrData is from mmap().
+   bool IsAdvised{};           //!< madvise() took the sequential and will need hints for the mapping.
+   std::vector<char> vCopy{};  //!< Only used where mmap() is not available.
+};
+
+//------------------------------------------------------------------------------
+// NOTE: Declarations
+//------------------------------------------------------------------------------
+
+/**
+ * Map the file at Path. Returns false if it can not be opened.
+ */
+auto MapFile(mapped_file& File,       //!<
+             std::string const& Path  //!<
+             )                        //!<
+    -> bool;
+
+auto UnmapFile(mapped_file& File) -> void;
+
+/**
+ * Parse OBJ text into the mesh. Only v and f lines are used, the texture and normal indices
+ * of f are ignored. Vertex colors are read when a v line has six numbers, else they are white.
+ * NumThreads 0 uses one per core. Returns false, with an empty mesh, on malformed numbers or
+ * indices outside the vertices.
+ */
+auto LoadObj(mesh& Mesh,              //!<
+             std::string_view Text,   //!<
+             unsigned NumThreads = 0  //!<
+             )                        //!<
+    -> bool;
+
+/**
+ * Parse a binary PLY file, little or big endian, into the mesh. Uses the x, y, z and the
+ * optional red, green, blue properties of the vertex element, and the vertex_indices list of
+ * the face element. Other elements and properties are skipped. ASCII PLY is not supported.
+ * Returns false, with an empty mesh, on a malformed or truncated file.
+ */
+auto LoadPly(mesh& Mesh,              //!<
+             std::string_view Data,   //!< The whole file, header included.
+             unsigned NumThreads = 0  //!<
+             )                        //!<
+    -> bool;
+
+/**
+ * Map the file at Path and load it with LoadPly() if it starts with the PLY magic, else with LoadObj().
+ */
+auto LoadMesh(mesh& Mesh,               //!<
+              std::string const& Path,  //!<
+              unsigned NumThreads = 0   //!<
+              )                         //!<
+    -> bool;
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,544 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "meshlod.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+namespace
+{
+using math3d::FLOAT;
+
+/**
+ * Border edges count this much more than the planes of the triangles, so the border only
+ * moves when there is nothing else left to collapse.
+ */
+constexpr FLOAT BORDER_WEIGHT = 10;
+
+struct vec3
+{
+   FLOAT X{};  //!<
+   FLOAT Y{};  //!<
+   FLOAT Z{};  //!<
+};
+
+auto operator-(vec3 const& A, vec3 const& B) -> vec3
+{
+   return {A.X - B.X, A.Y - B.Y, A.Z - B.Z};
+}
+
+auto Cross(vec3 const& A, vec3 const& B) -> vec3
+{
+   return {A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X};
+}
+
+auto Dot(vec3 const& A, vec3 const& B) -> FLOAT
+{
+   return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+}
+
+/**
+ * Symmetric 4x4 matrix of the plane equations, upper triangle stored row by row.
+ * The error at v is v^T Q v with v = (x, y, z, 1).
+ */
+struct quadric
+{
+   std::array<FLOAT, 10> Q{};
+};
+
+auto AddPlane(quadric& Quadric, vec3 const& N, FLOAT D, FLOAT Weight) -> void
+{
+   auto& Q = Quadric.Q;
+   Q[0] += Weight * N.X * N.X;
+   Q[1] += Weight * N.X * N.Y;
+   Q[2] += Weight * N.X * N.Z;
+   Q[3] += Weight * N.X * D;
+   Q[4] += Weight * N.Y * N.Y;
+   Q[5] += Weight * N.Y * N.Z;
+   Q[6] += Weight * N.Y * D;
+   Q[7] += Weight * N.Z * N.Z;
+   Q[8] += Weight * N.Z * D;
+   Q[9] += Weight * D * D;
+}
+
+auto Sum(quadric const& A, quadric const& B) -> quadric
+{
+   quadric Result{};
+   for (std::size_t Idx = 0; Idx < A.Q.size(); ++Idx) Result.Q[Idx] = A.Q[Idx] + B.Q[Idx];
+   return Result;
+}
+
+auto Error(quadric const& Quadric, vec3 const& V) -> FLOAT
+{
+   auto const& Q = Quadric.Q;
+   return Q[0] * V.X * V.X + 2 * Q[1] * V.X * V.Y + 2 * Q[2] * V.X * V.Z + 2 * Q[3] * V.X +  //
+          Q[4] * V.Y * V.Y + 2 * Q[5] * V.Y * V.Z + 2 * Q[6] * V.Y +                         //
+          Q[7] * V.Z * V.Z + 2 * Q[8] * V.Z + Q[9];
+}
+
+/**
+ * The point with the least error, from the 3x3 system of the gradient. Returns false when
+ * the system is close to singular, e.g on flat or straight parts.
+ */
+auto Optimal(quadric const& Quadric, vec3& V) -> bool
+{
+   auto const& Q = Quadric.Q;
+   auto const Det = Q[0] * (Q[4] * Q[7] - Q[5] * Q[5]) - Q[1] * (Q[1] * Q[7] - Q[5] * Q[2]) +
+                    Q[2] * (Q[1] * Q[5] - Q[4] * Q[2]);
+   auto const Scale = Q[0] * Q[4] * Q[7];
+   if (std::abs(Det) <= FLOAT(1e-9) * std::abs(Scale) || Det == 0) return false;
+
+   /** Cramer's rule on Q3x3 * V = -(Q[3], Q[6], Q[8]). */
+   auto const B0 = -Q[3];
+   auto const B1 = -Q[6];
+   auto const B2 = -Q[8];
+   V.X = (B0 * (Q[4] * Q[7] - Q[5] * Q[5]) - Q[1] * (B1 * Q[7] - Q[5] * B2) + Q[2] * (B1 * Q[5] - Q[4] * B2)) / Det;
+   V.Y = (Q[0] * (B1 * Q[7] - B2 * Q[5]) - B0 * (Q[1] * Q[7] - Q[5] * Q[2]) + Q[2] * (Q[1] * B2 - B1 * Q[2])) / Det;
+   V.Z = (Q[0] * (Q[4] * B2 - Q[5] * B1) - Q[1] * (Q[1] * B2 - B1 * Q[2]) + B0 * (Q[1] * Q[5] - Q[4] * Q[2])) / Det;
+   return true;
+}
+
+struct collapse
+{
+   FLOAT Cost{};       //!<
+   vec3 Target{};      //!< Where the two vertices end up.
+   uint32_t V0{};      //!< Kept.
+   uint32_t V1{};      //!< Removed.
+   uint32_t Stamp0{};  //!< Stamps of the vertices when the collapse was computed.
+   uint32_t Stamp1{};  //!<
+
+   auto operator>(collapse const& Other) const -> bool { return Cost > Other.Cost; }
+};
+
+using collapse_heap = std::priority_queue<collapse, std::vector<collapse>, std::greater<collapse>>;
+
+/**
+ * Working copy of the mesh with the adjacency that edge collapses need.
+ */
+struct simplifier
+{
+   std::vector<vec3> vPositions{};                     //!<
+   std::vector<math3d::tup> vColors{};                 //!<
+   std::vector<quadric> vQuadrics{};                   //!<
+   std::vector<uint32_t> vStamps{};                    //!< Bumped when a vertex changes, to skip stale collapses.
+   std::vector<uint8_t> vVertexAlive{};                //!<
+   std::vector<std::array<uint32_t, 3>> vFaces{};      //!<
+   std::vector<uint8_t> vFaceAlive{};                  //!<
+   std::vector<std::vector<uint32_t>> vVertexFaces{};  //!< Faces around each vertex, may hold dead faces.
+   collapse_heap Heap{};                               //!< Cheapest collapse on top.
+   std::size_t NumFaces{};                             //!< Alive.
+   std::vector<uint32_t> vScratch0{};                  //!<
+   std::vector<uint32_t> vScratch1{};                  //!<
+};
+
+auto FaceNormal(simplifier const& S, std::array<uint32_t, 3> const& Face) -> vec3
+{
+   auto const& P0 = S.vPositions[Face[0]];
+   return Cross(S.vPositions[Face[1]] - P0, S.vPositions[Face[2]] - P0);
+}
+
+auto Compute(simplifier const& S, uint32_t V0, uint32_t V1) -> collapse
+{
+   auto const Q = Sum(S.vQuadrics[V0], S.vQuadrics[V1]);
+   collapse Collapse{};
+   Collapse.V0 = V0;
+   Collapse.V1 = V1;
+   Collapse.Stamp0 = S.vStamps[V0];
+   Collapse.Stamp1 = S.vStamps[V1];
+
+   vec3 Target{};
+   if (Optimal(Q, Target))
+   {
+      Collapse.Target = Target;
+      Collapse.Cost = Error(Q, Target);
+   }
+   else
+   {
+      auto const& P0 = S.vPositions[V0];
+      auto const& P1 = S.vPositions[V1];
+      vec3 const Candidates[3] = {P0, P1, {(P0.X + P1.X) / 2, (P0.Y + P1.Y) / 2, (P0.Z + P1.Z) / 2}};
+      Collapse.Cost = std::numeric_limits<FLOAT>::max();
+      for (auto const& Candidate : Candidates)
+      {
+         auto const Cost = Error(Q, Candidate);
+         if (Cost < Collapse.Cost)
+         {
+            Collapse.Cost = Cost;
+            Collapse.Target = Candidate;
+         }
+      }
+   }
+   Collapse.Cost = std::max(Collapse.Cost, FLOAT(0));
+   return Collapse;
+}
+
+/**
+ * Vertices sharing an alive face with V, sorted and unique.
+ */
+auto Neighbours(simplifier const& S, uint32_t V, std::vector<uint32_t>& vResult) -> void
+{
+   vResult.clear();
+   for (auto const Face : S.vVertexFaces[V])
+   {
+      if (!S.vFaceAlive[Face]) continue;
+      for (auto const Other : S.vFaces[Face])
+      {
+         if (Other != V) vResult.push_back(Other);
+      }
+   }
+   std::sort(vResult.begin(), vResult.end());
+   vResult.erase(std::unique(vResult.begin(), vResult.end()), vResult.end());
+}
+
+/**
+ * A collapse is valid when the vertices of the edge share exactly the neighbours of the
+ * triangles on the edge, so the surface is not pinched, and no triangle turns over.
+ */
+auto IsValid(simplifier& S, collapse const& Collapse) -> bool
+{
+   Neighbours(S, Collapse.V0, S.vScratch0);
+   Neighbours(S, Collapse.V1, S.vScratch1);
+
+   std::size_t NumShared{};
+   for (auto const Face : S.vVertexFaces[Collapse.V0])
+   {
+      if (!S.vFaceAlive[Face]) continue;
+      auto const& F = S.vFaces[Face];
+      NumShared += std::find(F.begin(), F.end(), Collapse.V1) != F.end();
+   }
+   if (NumShared == 0) return false;
+
+   std::size_t NumCommon{};
+   for (std::size_t Idx0 = 0, Idx1 = 0; Idx0 < S.vScratch0.size() && Idx1 < S.vScratch1.size();)
+   {
+      if (S.vScratch0[Idx0] < S.vScratch1[Idx1])
+         ++Idx0;
+      else if (S.vScratch1[Idx1] < S.vScratch0[Idx0])
+         ++Idx1;
+      else
+         ++NumCommon, ++Idx0, ++Idx1;
+   }
+   if (NumCommon != NumShared) return false;
+
+   for (auto const V : {Collapse.V0, Collapse.V1})
+   {
+      for (auto const Face : S.vVertexFaces[V])
+      {
+         if (!S.vFaceAlive[Face]) continue;
+         auto F = S.vFaces[Face];
+         if (std::find(F.begin(), F.end(), Collapse.V0) != F.end() &&
+             std::find(F.begin(), F.end(), Collapse.V1) != F.end())
+            continue;
+
+         auto const Before = FaceNormal(S, F);
+         auto const Saved = S.vPositions[V];
+         S.vPositions[V] = Collapse.Target;
+         auto const After = FaceNormal(S, F);
+         S.vPositions[V] = Saved;
+         if (Dot(Before, After) <= 0) return false;
+      }
+   }
+   return true;
+}
+
+auto Apply(simplifier& S, collapse const& Collapse) -> void
+{
+   auto const V0 = Collapse.V0;
+   auto const V1 = Collapse.V1;
+   S.vPositions[V0] = Collapse.Target;
+   S.vQuadrics[V0] = Sum(S.vQuadrics[V0], S.vQuadrics[V1]);
+   auto& C0 = S.vColors[V0];
+   auto const& C1 = S.vColors[V1];
+   C0 = {(C0.X + C1.X) / 2, (C0.Y + C1.Y) / 2, (C0.Z + C1.Z) / 2, (C0.W + C1.W) / 2};
+   S.vVertexAlive[V1] = 0;
+   ++S.vStamps[V0];
+   ++S.vStamps[V1];
+
+   for (auto const Face : S.vVertexFaces[V1])
+   {
+      if (!S.vFaceAlive[Face]) continue;
+      auto& F = S.vFaces[Face];
+      if (std::find(F.begin(), F.end(), V0) != F.end())
+      {
+         S.vFaceAlive[Face] = 0;
+         --S.NumFaces;
+         continue;
+      }
+      std::replace(F.begin(), F.end(), V1, V0);
+      S.vVertexFaces[V0].push_back(Face);
+   }
+   S.vVertexFaces[V1] = {};
+
+   auto& vFaces0 = S.vVertexFaces[V0];
+   vFaces0.erase(std::remove_if(vFaces0.begin(), vFaces0.end(), [&](uint32_t Face) { return !S.vFaceAlive[Face]; }),
+                 vFaces0.end());
+
+   Neighbours(S, V0, S.vScratch0);
+   for (auto const Other : S.vScratch0) S.Heap.push(Compute(S, V0, Other));
+}
+
+/**
+ * Planes through the border edges, at right angles to their triangle.
+ */
+auto AddBorderPlanes(simplifier& S) -> void
+{
+   std::vector<uint64_t> vKeys{};
+   vKeys.reserve(3 * S.vFaces.size());
+   for (auto const& F : S.vFaces)
+   {
+      for (std::size_t Corner = 0; Corner < 3; ++Corner)
+      {
+         auto const [Lo, Hi] = std::minmax(F[Corner], F[(Corner + 1) % 3]);
+         vKeys.push_back(uint64_t(Lo) << 32 | Hi);
+      }
+   }
+   std::sort(vKeys.begin(), vKeys.end());
+
+   auto IsBorder = [&](uint64_t Key) -> bool
+   {
+      auto const Range = std::equal_range(vKeys.begin(), vKeys.end(), Key);
+      return Range.second - Range.first == 1;
+   };
+
+   for (auto const& F : S.vFaces)
+   {
+      auto const Normal = FaceNormal(S, F);
+      for (std::size_t Corner = 0; Corner < 3; ++Corner)
+      {
+         auto const A = F[Corner];
+         auto const B = F[(Corner + 1) % 3];
+         auto const [Lo, Hi] = std::minmax(A, B);
+         if (!IsBorder(uint64_t(Lo) << 32 | Hi)) continue;
+
+         auto N = Cross(S.vPositions[B] - S.vPositions[A], Normal);
+         auto const Length = std::sqrt(Dot(N, N));
+         if (Length == 0) continue;
+         N = {N.X / Length, N.Y / Length, N.Z / Length};
+         auto const D = -Dot(N, S.vPositions[A]);
+         AddPlane(S.vQuadrics[A], N, D, BORDER_WEIGHT);
+         AddPlane(S.vQuadrics[B], N, D, BORDER_WEIGHT);
+      }
+   }
+}
+
+};  // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+auto SimplifyMesh(mesh_view const& Mesh,       //!<
+                  std::size_t TargetTriangles  //!<
+                  )                            //!<
+    -> simplify_result
+{
+   simplifier S{};
+   auto const NumVerts = NumVertices(Mesh);
+   S.vPositions.resize(NumVerts);
+   for (std::size_t Idx = 0; Idx < NumVerts; ++Idx) S.vPositions[Idx] = {Mesh.X[Idx], Mesh.Y[Idx], Mesh.Z[Idx]};
+   S.vColors.assign(Mesh.vColors.begin(), Mesh.vColors.end());
+   S.vColors.resize(NumVerts, math3d::tup{1, 1, 1, 0});
+   S.vQuadrics.resize(NumVerts);
+   S.vStamps.resize(NumVerts);
+   S.vVertexAlive.assign(NumVerts, 1);
+   S.vVertexFaces.resize(NumVerts);
+
+   /**
+    * Keep the triangles that have three different vertices inside the mesh.
+    */
+   for (std::size_t Triangle = 0; Triangle < NumTriangles(Mesh); ++Triangle)
+   {
+      std::array<uint32_t, 3> const F = {Mesh.vIndices[3 * Triangle], Mesh.vIndices[3 * Triangle + 1],
+                                         Mesh.vIndices[3 * Triangle + 2]};
+      if (F[0] >= NumVerts || F[1] >= NumVerts || F[2] >= NumVerts) continue;
+      if (F[0] == F[1] || F[1] == F[2] || F[2] == F[0]) continue;
+      auto const Face = static_cast<uint32_t>(S.vFaces.size());
+      S.vFaces.push_back(F);
+      for (auto const V : F) S.vVertexFaces[V].push_back(Face);
+   }
+   S.vFaceAlive.assign(S.vFaces.size(), 1);
+   S.NumFaces = S.vFaces.size();
+
+   for (auto const& F : S.vFaces)
+   {
+      auto N = FaceNormal(S, F);
+      auto const Length = std::sqrt(Dot(N, N));
+      if (Length == 0) continue;
+      N = {N.X / Length, N.Y / Length, N.Z / Length};
+      auto const D = -Dot(N, S.vPositions[F[0]]);
+      for (auto const V : F) AddPlane(S.vQuadrics[V], N, D, 1);
+   }
+   AddBorderPlanes(S);
+
+   for (auto const& F : S.vFaces)
+   {
+      for (std::size_t Corner = 0; Corner < 3; ++Corner)
+      {
+         auto const [Lo, Hi] = std::minmax(F[Corner], F[(Corner + 1) % 3]);
+         S.Heap.push(Compute(S, Lo, Hi));
+      }
+   }
+
+   simplify_result Result{};
+   FLOAT MaxCost{};
+   while (S.NumFaces > TargetTriangles && !S.Heap.empty())
+   {
+      auto const Collapse = S.Heap.top();
+      S.Heap.pop();
+      if (!S.vVertexAlive[Collapse.V0] || !S.vVertexAlive[Collapse.V1]) continue;
+      if (S.vStamps[Collapse.V0] != Collapse.Stamp0 || S.vStamps[Collapse.V1] != Collapse.Stamp1) continue;
+      if (!IsValid(S, Collapse)) continue;
+
+      Apply(S, Collapse);
+      MaxCost = std::max(MaxCost, Collapse.Cost);
+      ++Result.NumCollapsed;
+   }
+
+   /**
+    * Compact the vertices that are still used by a triangle.
+    */
+   std::vector<uint32_t> vRemap(NumVerts, std::numeric_limits<uint32_t>::max());
+   for (std::size_t Face = 0; Face < S.vFaces.size(); ++Face)
+   {
+      if (!S.vFaceAlive[Face]) continue;
+      for (auto const V : S.vFaces[Face])
+      {
+         if (vRemap[V] == std::numeric_limits<uint32_t>::max())
+         {
+            auto const& P = S.vPositions[V];
+            vRemap[V] = AddVertex(Result.Mesh, math3d::Point(P.X, P.Y, P.Z), S.vColors[V]);
+         }
+      }
+      auto const& F = S.vFaces[Face];
+      AddTriangle(Result.Mesh, vRemap[F[0]], vRemap[F[1]], vRemap[F[2]]);
+   }
+
+   Result.Error = std::sqrt(MaxCost);
+   return Result;
+}
+
+//------------------------------------------------------------------------------
+auto BuildLodChain(mesh_view const& Mesh,    //!<
+                   std::size_t MaxLevels,    //!<
+                   math3d::FLOAT Ratio,      //!<
+                   std::size_t MinTriangles  //!<
+                   )                         //!<
+    -> lod_chain
+{
+   lod_chain Chain{};
+   if (NumVertices(Mesh) == 0 || MaxLevels == 0) return Chain;
+
+   /**
+    * Bounding sphere around the center of the bounding box.
+    */
+   auto const [MinX, MaxX] = std::minmax_element(Mesh.X.begin(), Mesh.X.end());
+   auto const [MinY, MaxY] = std::minmax_element(Mesh.Y.begin(), Mesh.Y.end());
+   auto const [MinZ, MaxZ] = std::minmax_element(Mesh.Z.begin(), Mesh.Z.end());
+   Chain.Center = math3d::Point((*MinX + *MaxX) / 2, (*MinY + *MaxY) / 2, (*MinZ + *MaxZ) / 2);
+   FLOAT RadiusSquared{};
+   for (std::size_t Idx = 0; Idx < NumVertices(Mesh); ++Idx)
+   {
+      vec3 const D = {Mesh.X[Idx] - Chain.Center.X, Mesh.Y[Idx] - Chain.Center.Y, Mesh.Z[Idx] - Chain.Center.Z};
+      RadiusSquared = std::max(RadiusSquared, Dot(D, D));
+   }
+   Chain.Radius = std::sqrt(RadiusSquared);
+
+   Chain.vLevels.push_back(ToMesh(Mesh));
+   Chain.vLevels.back().vEdges.clear();
+   Chain.vErrors.push_back(0);
+
+   /**
+    * Each level is simplified from the one before. The errors of the steps add up, so the
+    * error of a level is an upper bound of its distance to the full mesh.
+    */
+   while (Chain.vLevels.size() < MaxLevels)
+   {
+      auto const NumPrevious = NumTriangles(Chain.vLevels.back());
+      auto const Target = static_cast<std::size_t>(FLOAT(NumPrevious) * Ratio);
+      if (Target < MinTriangles) break;
+
+      auto Result = SimplifyMesh(Chain.vLevels.back(), Target);
+      if (NumTriangles(Result.Mesh) >= NumPrevious) break;
+
+      Chain.vErrors.push_back(Chain.vErrors.back() + Result.Error);
+      Chain.vLevels.push_back(std::move(Result.Mesh));
+   }
+   return Chain;
+}
+
+//------------------------------------------------------------------------------
+auto ProjectedRadius(math3d::tup const& Center,        //!<
+                     math3d::FLOAT Radius,             //!<
+                     math3d::matrix const& ModelView,  //!<
+                     projection const& Proj            //!<
+                     )                                 //!<
+    -> math3d::FLOAT
+{
+   auto const Eye = ModelView * math3d::Point(Center.X, Center.Y, Center.Z);
+   auto const Side = ModelView * math3d::Point(Center.X + Radius, Center.Y, Center.Z);
+   auto const EyeRadius = math3d::Mag(math3d::Vector(Side.X - Eye.X, Side.Y - Eye.Y, Side.Z - Eye.Z));
+
+   if (Eye.Z + EyeRadius <= 0) return 0;
+   auto const NearZ = Eye.Z - EyeRadius;
+   if (NearZ <= FLOAT(1e-6)) return std::numeric_limits<FLOAT>::max();
+
+   /**
+    * Measure the radius on the screen at the near side of the sphere, where it is the largest.
+    */
+   auto const ToScreen = ScreenCoord(Proj) * Projection(Proj);
+   auto const P0 = ToScreen * math3d::Point(Eye.X, Eye.Y, NearZ);
+   auto const P1 = ToScreen * math3d::Point(Eye.X, Eye.Y + EyeRadius, NearZ);
+   return std::abs(P1.Y - P0.Y);
+}
+
+//------------------------------------------------------------------------------
+auto SelectLod(lod_chain const& Chain,           //!<
+               math3d::matrix const& ModelView,  //!<
+               projection const& Proj,           //!<
+               math3d::FLOAT MaxErrorPixels      //!<
+               )                                 //!<
+    -> std::size_t
+{
+   if (Chain.vLevels.empty() || Chain.Radius <= 0) return 0;
+
+   auto const PixelsPerUnit = ProjectedRadius(Chain.Center, Chain.Radius, ModelView, Proj) / Chain.Radius;
+   std::size_t Level{};
+   for (std::size_t Idx = 1; Idx < Chain.vErrors.size(); ++Idx)
+   {
+      if (!(Chain.vErrors[Idx] * PixelsPerUnit <= MaxErrorPixels)) break;
+      Level = Idx;
+   }
+   return Level;
+}
+
+};  // end of namespace render
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
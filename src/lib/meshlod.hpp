@@ -0,0 +1,117 @@
+#ifndef SRC_LIB_MESHLOD_HPP_060EBCAF_B174_4697_9408_BBD2A7AD9776
+#define SRC_LIB_MESHLOD_HPP_060EBCAF_B174_4697_9408_BBD2A7AD9776
+
+/**
+ * Mesh simplification and level of detail.
+ *
+ * SimplifyMesh() collapses edges in the order of the quadric error metric of Garland and
+ * Heckbert: each vertex carries the sum of the squared distances to the planes of its
+ * triangles, and an edge is collapsed to the point that adds the least to that sum.
+ * Collapses that would flip a triangle or pinch the surface are skipped, and open borders
+ * are kept in place by extra planes through the border edges.
+ *
+ * BuildLodChain() simplifies a mesh in steps into a chain of meshes with fewer and fewer
+ * triangles. SelectLod() picks the level whose error, projected to the screen with the same
+ * Projection() and ScreenCoord() the mesh is drawn with, stays below a number of pixels. The
+ * cost of drawing a model then follows how large it is on the screen.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include "fluffymath.hpp"
+#include "mesh.hpp"
+#include "triangle2d.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+struct simplify_result
+{
+   mesh Mesh{};                 //!< Without edges, use EdgesFromTriangles() for a wireframe.
+   math3d::FLOAT Error{};       //!< Largest distance, in model units, a collapse moved the surface.
+   std::size_t NumCollapsed{};  //!<
+};
+
+struct lod_chain
+{
+   std::vector<mesh> vLevels{};           //!< Level 0 is the full mesh, each next one coarser.
+   std::vector<math3d::FLOAT> vErrors{};  //!< Distance in model units from the full mesh, per level.
+   math3d::tup Center{};                  //!< Bounding sphere of the full mesh.
+   math3d::FLOAT Radius{};                //!<
+};
+
+//------------------------------------------------------------------------------
+// NOTE: Declarations
+//------------------------------------------------------------------------------
+
+/**
+ * Collapse edges until the mesh has at most TargetTriangles triangles, or no collapse is left
+ * that keeps the surface valid. The vertex colors are averaged along the collapsed edges.
+ */
+auto SimplifyMesh(mesh_view const& Mesh,       //!<
+                  std::size_t TargetTriangles  //!<
+                  )                            //!<
+    -> simplify_result;
+
+/**
+ * Level 0 is a copy of Mesh, each next level has Ratio of the triangles of the level before.
+ * Stops after MaxLevels levels, or when a level does not get smaller or has less than MinTriangles.
+ */
+auto BuildLodChain(mesh_view const& Mesh,         //!<
+                   std::size_t MaxLevels = 8,     //!<
+                   math3d::FLOAT Ratio = 0.5,     //!<
+                   std::size_t MinTriangles = 32  //!<
+                   )                              //!<
+    -> lod_chain;
+
+/**
+ * Radius in pixels of the bounding sphere at Center with Radius, on the screen given by Proj.
+ * ModelView takes model coordinates to the eye, i.e the transform before Projection().
+ * Returns 0 if the sphere is behind the eye, and a large number if the eye is inside it.
+ */
+auto ProjectedRadius(math3d::tup const& Center,        //!<
+                     math3d::FLOAT Radius,             //!<
+                     math3d::matrix const& ModelView,  //!<
+                     projection const& Proj            //!<
+                     )                                 //!<
+    -> math3d::FLOAT;
+
+/**
+ * The coarsest level whose error is at most MaxErrorPixels on the screen. The error is
+ * projected at the near side of the bounding sphere, so it is never underestimated.
+ */
+auto SelectLod(lod_chain const& Chain,           //!<
+               math3d::matrix const& ModelView,  //!<
+               projection const& Proj,           //!<
+               math3d::FLOAT MaxErrorPixels = 1  //!<
+               )                                 //!<
+    -> std::size_t;
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,163 @@
+#ifndef SRC_LIB_PIXELFORMAT_HPP_7C2E4B19_5A0D_4F63_9E81_B3D62A0F4C57
+#define SRC_LIB_PIXELFORMAT_HPP_7C2E4B19_5A0D_4F63_9E81_B3D62A0F4C57
+
+/**
+ * Pixel formats the raster loops are specialized for.
+ * Colors are passed around as 0xAARRGGBB and converted to the surface format when written.
+ * The raster loops are templated on the format, so the conversion is resolved at compile
+ * time and the format is only looked at once per draw call.
+ *
+ * NOTE: INDEX8 surfaces are expected to carry the 3-3-2 palette, see Palette332().
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "blend.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+enum class pixel_format
+{
+   ARGB8888 = 0,  //!<
+   XRGB8888 = 1,  //!< The top byte is written as is but not used by SDL.
+   RGB565 = 2,    //!<
+   INDEX8 = 3,    //!< 3 bits red, 3 bits green and 2 bits blue used as palette index.
+};
+
+template <pixel_format FORMAT>
+struct pixel_traits;
+
+template <>
+struct pixel_traits<pixel_format::ARGB8888>
+{
+   using pixel_t = uint32_t;
+   static auto Encode(uint32_t Color) -> pixel_t { return Color; }
+   static auto Decode(pixel_t Pixel) -> uint32_t { return Pixel; }
+};
+
+template <>
+struct pixel_traits<pixel_format::XRGB8888>
+{
+   using pixel_t = uint32_t;
+   static auto Encode(uint32_t Color) -> pixel_t { return Color; }
+   static auto Decode(pixel_t Pixel) -> uint32_t { return Pixel; }
+};
+
+template <>
+struct pixel_traits<pixel_format::RGB565>
+{
+   using pixel_t = uint16_t;
+
+   static auto Encode(uint32_t Color) -> pixel_t
+   {
+      return static_cast<pixel_t>(((Color >> 8) & 0xF800) | ((Color >> 5) & 0x07E0) | ((Color >> 3) & 0x001F));
+   }
+
+   /** The low bits are filled with the high bits, so 0x1F maps to 0xFF. */
+   static auto Decode(pixel_t Pixel) -> uint32_t
+   {
+      uint32_t const R = (Pixel >> 11) & 0x1F;
+      uint32_t const G = (Pixel >> 5) & 0x3F;
+      uint32_t const B = Pixel & 0x1F;
+      return ((R << 3) | (R >> 2)) << 16 | ((G << 2) | (G >> 4)) << 8 | ((B << 3) | (B >> 2));
+   }
+};
+
+template <>
+struct pixel_traits<pixel_format::INDEX8>
+{
+   using pixel_t = uint8_t;
+
+   static auto Encode(uint32_t Color) -> pixel_t
+   {
+      return static_cast<pixel_t>(((Color >> 16) & 0xE0) | ((Color >> 11) & 0x1C) | ((Color >> 6) & 0x03));
+   }
+
+   static auto Decode(pixel_t Pixel) -> uint32_t
+   {
+      uint32_t const R = (Pixel >> 5) & 0x07;
+      uint32_t const G = (Pixel >> 2) & 0x07;
+      uint32_t const B = Pixel & 0x03;
+      return ((R << 5) | (R << 2) | (R >> 1)) << 16 | ((G << 5) | (G << 2) | (G >> 1)) << 8 | (B * 0x55);
+   }
+};
+
+/**
+ * Color of palette entry Idx for INDEX8 surfaces, i.e the inverse of the INDEX8 encoding.
+ */
+inline auto Palette332(uint8_t Idx) -> uint32_t
+{
+   return pixel_traits<pixel_format::INDEX8>::Decode(Idx);
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Write one pixel. Blending is done in 0xAARRGGBB, so narrow formats are decoded first.
+ */
+template <pixel_format FORMAT>
+inline auto WritePixelAs(typename pixel_traits<FORMAT>::pixel_t* ptrDst, uint32_t Color, blend_mode Blend) -> void
+{
+   using traits = pixel_traits<FORMAT>;
+   if (Blend == blend_mode::OPAQUE)
+   {
+      *ptrDst = traits::Encode(Color);
+      return;
+   }
+   *ptrDst = traits::Encode(BlendPixel(traits::Decode(*ptrDst), Color, Blend));
+}
+
+/**
+ * Write one color to Num consecutive pixels. 32 bit formats use the SIMD BlendSpan().
+ */
+template <pixel_format FORMAT>
+inline auto WriteSpanAs(typename pixel_traits<FORMAT>::pixel_t* ptrDst,  //!<
+                        std::size_t Num,                                 //!<
+                        uint32_t Color,                                  //!<
+                        blend_mode Blend                                 //!<
+                        )                                                //!<
+    -> void
+{
+   using traits = pixel_traits<FORMAT>;
+   if constexpr (sizeof(typename traits::pixel_t) == sizeof(uint32_t))
+   {
+      BlendSpan(ptrDst, Num, Color, Blend);
+   }
+   else if (Blend == blend_mode::OPAQUE)
+   {
+      std::fill_n(ptrDst, Num, traits::Encode(Color));
+   }
+   else
+   {
+      for (std::size_t Idx = 0; Idx < Num; ++Idx) WritePixelAs<FORMAT>(ptrDst + Idx, Color, Blend);
+   }
+}
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
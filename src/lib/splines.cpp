@@ -3,7 +3,9 @@
  * Copyright : Willy Clarke.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
@@ -13,55 +15,156 @@ namespace fluffy
 {
 namespace splines
 {
-auto InitCatmullRom(std::vector<fluffy::math3d::tup> const &vP) -> spline_catmull_rom
+namespace
 {
-   if (vP.size() < 2) return {};
+using fluffy::math3d::FLOAT;
 
-   spline_catmull_rom Spline{};
+/**
+ * The added start point is the first control point moved back by a third of the vector to
+ * the second one. The end point is found the same way from the last two control points.
+ */
+auto UpdateStartPoint(std::vector<fluffy::math3d::tup> &CP) -> void
+{
+   auto Vector0 = (CP[2] - CP[1]) * FLOAT(-1) / FLOAT(3);
+   CP[0] = CP[1] + Vector0;
+}
 
-   Spline.CtrlPoints = vP;
+auto UpdateEndPoint(std::vector<fluffy::math3d::tup> &CP) -> void
+{
+   auto const &PointEnd = CP[CP.size() - 2];
+   auto const &PointEndMinus1 = CP[CP.size() - 3];
+   auto VectorEnd = (PointEndMinus1 - PointEnd) * FLOAT(-1) / FLOAT(3);
+   CP.back() = VectorEnd + PointEnd;
+}
 
-   /**
-    * Get a Control Points reference.
-    */
+/**
+ * True when vSegSamples holds the samples of every segment, i.e after SampleCatmullRom().
+ */
+auto IsSampled(spline_catmull_rom const &Spline) -> bool
+{
+   return Spline.SamplesPerSegment > 0 && Spline.vSegSamples.size() == Spline.vMatSeg.size();
+}
+
+/**
+ * List the segments [Begin, End) as out of date. Nothing is listed before the spline is sampled.
+ */
+auto MarkDirty(spline_catmull_rom &Spline, std::size_t Begin, std::size_t End) -> void
+{
+   if (!IsSampled(Spline)) return;
+   End = std::min(End, Spline.vMatSeg.size());
+   for (auto Seg = Begin; Seg < End; ++Seg) Spline.vDirtySegs.push_back(Seg);
+}
+
+/**
+ * Recompute the matrices of the segments that use control point Idx (counted without the
+ * added start point), and of the end segments when an added end point depends on it.
+ */
+auto UpdateSegmentsAround(spline_catmull_rom &Spline, std::size_t Idx) -> void
+{
    auto &CP = Spline.CtrlPoints;
+   auto const NumPoints = CP.size() - 2;
+   if (Idx <= 1) UpdateStartPoint(CP);
+   if (Idx + 2 >= NumPoints) UpdateEndPoint(CP);
 
    /**
-    * Create two additional control points for the start and the
-    * end of the spline.
+    * Segment Seg uses CP[Seg] .. CP[Seg + 3], and control point Idx is CP[Idx + 1].
     */
+   auto const MatCatmRom = fluffy::math3d::SplineMatrixCatmullRom();
+   auto const Begin = Idx >= 2 ? Idx - 2 : 0;
+   auto const End = std::min(Idx + 2, Spline.vMatSeg.size());
+   for (auto Seg = Begin; Seg < End; ++Seg)
+   {
+      Spline.vMatSeg[Seg] = fluffy::math3d::MultSpline(MatCatmRom, CP[Seg], CP[Seg + 1], CP[Seg + 2], CP[Seg + 3]);
+   }
+   MarkDirty(Spline, Begin, End);
+}
 
-   /**
-    * The first point is calculated by reversing the vector that
-    * originates between P0 and P1.
-    */
-   auto Vector0 = (CP[1] - CP[0]) * fluffy::math3d::FLOAT(-1) / fluffy::math3d::FLOAT(3);
-   auto PointBegin = CP[0] + Vector0;
-   CP.insert(CP.begin(), PointBegin);
+/**
+ * Evaluate the cubic of segment M at Count points, from u0 in steps of h, and hand each to
+ * Write(Idx, P). The segment is P(u) = R0 + R1 u + R2 u^2 + R3 u^3 as in MultSpline(), so
+ * after the differences are set up each point costs three adds per coordinate.
+ */
+template <typename FN>
+auto ForwardDifferences(fluffy::math3d::matrix const &M,  //!<
+                        FLOAT u0,                         //!<
+                        FLOAT h,                          //!<
+                        std::size_t Count,                //!<
+                        FN &&Write                        //!<
+                        ) -> void
+{
+   FLOAT P[3]{}, D1[3]{}, D2[3]{}, D3[3]{};
+   auto const h2 = h * h;
+   auto const h3 = h2 * h;
+   for (int C = 0; C < 3; ++C)
+   {
+      auto const A = M.R0.C[C];
+      auto const B = M.R1.C[C];
+      auto const Cc = M.R2.C[C];
+      auto const D = M.R3.C[C];
+      P[C] = ((D * u0 + Cc) * u0 + B) * u0 + A;
+      D1[C] = B * h + Cc * (2 * u0 * h + h2) + D * (3 * u0 * u0 * h + 3 * u0 * h2 + h3);
+      D2[C] = 2 * Cc * h2 + D * (6 * u0 * h2 + 6 * h3);
+      D3[C] = 6 * D * h3;
+   }
+
+   for (std::size_t Idx = 0; Idx < Count; ++Idx)
+   {
+      Write(Idx, fluffy::math3d::tup{P[0], P[1], P[2], FLOAT(1)});
+      for (int C = 0; C < 3; ++C)
+      {
+         P[C] += D1[C];
+         D1[C] += D2[C];
+         D2[C] += D3[C];
+      }
+   }
+}
+
+/**
+ * Sample segment Seg at the places given by SamplesPerSegment.
+ */
+auto SampleSegment(spline_catmull_rom &Spline, std::size_t Seg) -> void
+{
+   auto const NumSamples = Spline.SamplesPerSegment;
+   auto &vSamples = Spline.vSegSamples[Seg];
+   vSamples.resize(NumSamples);
+   ForwardDifferences(Spline.vMatSeg[Seg], FLOAT(0), FLOAT(1) / FLOAT(NumSamples), NumSamples,
+                      [&](std::size_t Idx, fluffy::math3d::tup const &P) { vSamples[Idx] = P; });
+}
+};  // end of anonymous namespace
+
+auto InitCatmullRom(std::vector<fluffy::math3d::tup> const &vP) -> spline_catmull_rom
+{
+   if (vP.size() < 2) return {};
+
+   spline_catmull_rom Spline{};
 
    /**
-    * The second point is again calculated as a vector originating from the last
-    * two control points given.
+    * Make room for two additional control points for the start and the end of the spline,
+    * so the points given are copied once.
     */
-   auto &PointEnd = CP[CP.size() - 1];
-   auto &PointEndMinus1 = CP[CP.size() - 2];
-   auto VectorEnd = (PointEndMinus1 - PointEnd) * fluffy::math3d::FLOAT(-1) / fluffy::math3d::FLOAT(3);
-   CP.push_back(VectorEnd + PointEnd);
+   auto &CP = Spline.CtrlPoints;
+   CP.reserve(vP.size() + 2);
+   CP.push_back({});
+   CP.insert(CP.end(), vP.begin(), vP.end());
+   CP.push_back({});
+   UpdateStartPoint(CP);
+   UpdateEndPoint(CP);
 
    /**
     * Iterate over the points to create the segment matrix for each segment.
     */
    auto MatCatmRom = fluffy::math3d::SplineMatrixCatmullRom();
 
+   Spline.vMatSeg.reserve(CP.size() - 3);
    for (size_t Idx = 0;       //!<
         Idx < CP.size() - 3;  //!<
         ++Idx                 //!<
    )
    {
-      auto const &P0 = CP.at(Idx + 0);
-      auto const &P1 = CP.at(Idx + 1);
-      auto const &P2 = CP.at(Idx + 2);
-      auto const &P3 = CP.at(Idx + 3);
+      auto const &P0 = CP[Idx + 0];
+      auto const &P1 = CP[Idx + 1];
+      auto const &P2 = CP[Idx + 2];
+      auto const &P3 = CP[Idx + 3];
       auto const MSegment = fluffy::math3d::MultSpline(MatCatmRom, P0, P1, P2, P3);
       Spline.vMatSeg.push_back(MSegment);
    }
@@ -115,6 +218,142 @@ auto SplineValueCatmullRom(spline_catmull_rom const &Spline, fluffy::math3d::FLO
    return SplineValue;
 }
 
+auto NumCtrlPoints(spline_catmull_rom const &Spline) -> std::size_t
+{
+   return Spline.CtrlPoints.size() >= 2 ? Spline.CtrlPoints.size() - 2 : 0;
+}
+
+auto SetCtrlPoint(spline_catmull_rom &Spline,   //!<
+                  std::size_t Idx,              //!<
+                  fluffy::math3d::tup const &P  //!<
+                  ) -> bool
+{
+   if (Idx >= NumCtrlPoints(Spline)) return false;
+
+   Spline.CtrlPoints[Idx + 1] = P;
+   UpdateSegmentsAround(Spline, Idx);
+   return true;
+}
+
+auto InsertCtrlPoint(spline_catmull_rom &Spline,   //!<
+                     std::size_t Idx,              //!<
+                     fluffy::math3d::tup const &P  //!<
+                     ) -> bool
+{
+   if (Spline.vMatSeg.empty() || Idx > NumCtrlPoints(Spline)) return false;
+
+   /**
+    * The segments before Idx - 2 and from Idx + 2 keep their points, the new slot is one of
+    * those in between that UpdateSegmentsAround() recomputes. Listed segments from the slot on
+    * move one place up.
+    */
+   auto const Slot = std::min(Idx, Spline.vMatSeg.size());
+   auto const Sampled = IsSampled(Spline);
+   Spline.CtrlPoints.insert(Spline.CtrlPoints.begin() + std::ptrdiff_t(Idx + 1), P);
+   Spline.vMatSeg.insert(Spline.vMatSeg.begin() + std::ptrdiff_t(Slot), fluffy::math3d::matrix{});
+   if (Sampled)
+   {
+      Spline.vSegSamples.insert(Spline.vSegSamples.begin() + std::ptrdiff_t(Slot), std::vector<fluffy::math3d::tup>{});
+      for (auto &Seg : Spline.vDirtySegs) Seg += Seg >= Slot ? 1 : 0;
+   }
+
+   UpdateSegmentsAround(Spline, Idx);
+   return true;
+}
+
+auto RemoveCtrlPoint(spline_catmull_rom &Spline,  //!<
+                     std::size_t Idx              //!<
+                     ) -> bool
+{
+   if (NumCtrlPoints(Spline) <= 2 || Idx >= NumCtrlPoints(Spline)) return false;
+
+   auto const Slot = std::min(Idx, Spline.vMatSeg.size() - 1);
+   auto const Sampled = IsSampled(Spline);
+   Spline.CtrlPoints.erase(Spline.CtrlPoints.begin() + std::ptrdiff_t(Idx + 1));
+   Spline.vMatSeg.erase(Spline.vMatSeg.begin() + std::ptrdiff_t(Slot));
+   if (Sampled)
+   {
+      Spline.vSegSamples.erase(Spline.vSegSamples.begin() + std::ptrdiff_t(Slot));
+      std::erase(Spline.vDirtySegs, Slot);
+      for (auto &Seg : Spline.vDirtySegs) Seg -= Seg > Slot ? 1 : 0;
+   }
+
+   /**
+    * The segments that used the removed point now use the point after it. Only those that
+    * span the gap, Idx - 2 .. Idx, have changed.
+    */
+   UpdateSegmentsAround(Spline, Idx > 0 ? Idx - 1 : 0);
+   return true;
+}
+
+auto SampleCatmullRom(spline_catmull_rom &Spline,    //!<
+                      std::size_t SamplesPerSegment  //!<
+                      ) -> void
+{
+   Spline.SamplesPerSegment = SamplesPerSegment;
+   Spline.vDirtySegs.clear();
+   Spline.vSegSamples.resize(SamplesPerSegment > 0 ? Spline.vMatSeg.size() : 0);
+
+   for (std::size_t Seg = 0; Seg < Spline.vSegSamples.size(); ++Seg) SampleSegment(Spline, Seg);
+}
+
+auto UpdateSamplesCatmullRom(spline_catmull_rom &Spline) -> std::size_t
+{
+   if (!IsSampled(Spline)) return 0;
+
+   /**
+    * The list is short, the segments around the points edited since the last update,
+    * so sorting it is cheaper than keeping a flag per segment.
+    */
+   auto &vDirty = Spline.vDirtySegs;
+   std::sort(vDirty.begin(), vDirty.end());
+   vDirty.erase(std::unique(vDirty.begin(), vDirty.end()), vDirty.end());
+
+   for (auto Seg : vDirty) SampleSegment(Spline, Seg);
+   auto const NumComputed = vDirty.size() * Spline.SamplesPerSegment;
+   vDirty.clear();
+   return NumComputed;
+}
+
+auto SampleValueCatmullRom(spline_catmull_rom const &Spline,  //!<
+                           std::size_t Seg,                   //!<
+                           std::size_t Idx                    //!<
+                           ) -> spline_catmull_rom::point
+{
+   if (Seg >= Spline.vSegSamples.size() || Idx >= Spline.vSegSamples[Seg].size()) return {};
+
+   auto const NumSamples = Spline.SamplesPerSegment;
+   spline_catmull_rom::point Sample{};
+   Sample.P = Spline.vSegSamples[Seg][Idx];
+   Sample.t = FLOAT(Seg * NumSamples + Idx) * (FLOAT(1) / FLOAT(Spline.vMatSeg.size() * NumSamples));
+   Sample.Idx = Seg;
+   return Sample;
+}
+
+auto TessellateCatmullRom(spline_catmull_rom const &Spline,   //!<
+                          std::span<fluffy::math3d::tup> Out  //!<
+                          ) -> void
+{
+   auto const NumSegments = Spline.vMatSeg.size();
+   auto const Num = Out.size();
+   if (NumSegments == 0 || Num == 0) return;
+
+   /**
+    * Sample Idx is at t = Idx / Num, which is u = Idx * h - Seg in segment Seg. The samples of
+    * a segment are those with Idx * NumSegments < (Seg + 1) * Num.
+    */
+   auto const h = FLOAT(NumSegments) / FLOAT(Num);
+   std::size_t Begin = 0;
+   for (std::size_t Seg = 0; Seg < NumSegments && Begin < Num; ++Seg)
+   {
+      auto const End = std::min(Num, ((Seg + 1) * Num + NumSegments - 1) / NumSegments);
+      auto *ptrOut = Out.data() + Begin;
+      ForwardDifferences(Spline.vMatSeg[Seg], FLOAT(Begin) * h - FLOAT(Seg), h, End - Begin,
+                         [ptrOut](std::size_t Idx, fluffy::math3d::tup const &P) { ptrOut[Idx] = P; });
+      Begin = End;
+   }
+}
+
 /**
  * Create a test spline for ease of debugging.
  */
@@ -8,7 +8,9 @@
 
 #include "fluffymath.hpp"
 
+#include <cstddef>
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace fluffy
@@ -45,6 +47,18 @@ struct spline_catmull_rom
     * The Catmull Rom spline requires four points per segment.
     */
    std::vector<fluffy::math3d::matrix> vMatSeg{};
+
+   /**
+    * Samples taken by SampleCatmullRom(), SamplesPerSegment for each segment. The samples of
+    * a segment are kept on their own, so inserting or removing a segment does not move or
+    * relabel the samples of the others. Use SampleValueCatmullRom() to get a sample with its t.
+    * vDirtySegs lists the segments the edit functions have changed since the last update, so
+    * UpdateSamplesCatmullRom() resamples them without looking at the rest of the spline.
+    * A segment may be listed more than once.
+    */
+   std::size_t SamplesPerSegment{};
+   std::vector<std::vector<fluffy::math3d::tup>> vSegSamples{};
+   std::vector<std::size_t> vDirtySegs{};
 };
 
 /**
@@ -57,6 +71,79 @@ struct spline_catmull_rom
 auto InitCatmullRom(std::vector<fluffy::math3d::tup> const &vP) -> spline_catmull_rom;
 auto SplineValueCatmullRom(spline_catmull_rom const &Spline, fluffy::math3d::FLOAT t)
     -> fluffy::splines::spline_catmull_rom::point;
+
+/**
+ * Number of control points given by the user, i.e without the two added end points.
+ */
+auto NumCtrlPoints(spline_catmull_rom const &Spline) -> std::size_t;
+
+/**
+ * Edit the control point Idx, counted without the added start point.
+ * Only the up to four segment matrices that use the point are recomputed, and the added end
+ * points when one of the two first or last points is edited, so the cost does not depend on
+ * the length of the spline. Returns false if Idx is outside the control points.
+ */
+auto SetCtrlPoint(spline_catmull_rom &Spline,   //!<
+                  std::size_t Idx,              //!<
+                  fluffy::math3d::tup const &P  //!<
+                  ) -> bool;
+
+/**
+ * Insert P so it becomes control point Idx, Idx == NumCtrlPoints() appends.
+ * Recomputes the same segments as SetCtrlPoint() and samples only the new one on the next update.
+ * NOTE: CtrlPoints and vMatSeg stay contiguous, since SplineValueCatmullRom() and the geometry
+ *       cache index them directly. So the points and matrices after Idx are moved one place,
+ *       which is linear in the length of the spline, although nothing else is evaluated.
+ *       The same goes for RemoveCtrlPoint(). Only SetCtrlPoint() is constant time.
+ */
+auto InsertCtrlPoint(spline_catmull_rom &Spline,   //!<
+                     std::size_t Idx,              //!<
+                     fluffy::math3d::tup const &P  //!<
+                     ) -> bool;
+
+/**
+ * Remove control point Idx. A spline keeps at least two control points, so this returns
+ * false when there are only two left.
+ */
+auto RemoveCtrlPoint(spline_catmull_rom &Spline,  //!<
+                     std::size_t Idx              //!<
+                     ) -> bool;
+
+/**
+ * Fill vSegSamples with SamplesPerSegment samples per segment, at u = 0, 1/SamplesPerSegment, ...
+ * of each segment, and mark all segments clean. As for SplineValueCatmullRom(), t = 1 is not sampled.
+ * The segments are walked with forward differences as in TessellateCatmullRom().
+ */
+auto SampleCatmullRom(spline_catmull_rom &Spline,    //!<
+                      std::size_t SamplesPerSegment  //!<
+                      ) -> void;
+
+/**
+ * Resample the segments edited since the last SampleCatmullRom() or UpdateSamplesCatmullRom().
+ * Returns the number of samples computed. Does nothing if the spline has not been sampled.
+ */
+auto UpdateSamplesCatmullRom(spline_catmull_rom &Spline) -> std::size_t;
+
+/**
+ * Sample Idx of segment Seg, with t and Idx set as SplineValueCatmullRom() would for the same point.
+ * t is worked out from Seg here, since it changes for all later samples when a segment is inserted.
+ */
+auto SampleValueCatmullRom(spline_catmull_rom const &Spline,  //!<
+                           std::size_t Seg,                   //!<
+                           std::size_t Idx                    //!<
+                           ) -> spline_catmull_rom::point;
+
+/**
+ * Write Out.size() points of the spline, evenly spaced in t from 0 up to but not including 1,
+ * i.e the points SplineValueCatmullRom() gives at t = Idx / Out.size().
+ * Each segment is walked with cubic forward differences, so a point costs three adds per
+ * coordinate, without the segment lookup and the matrix product per point.
+ * Out is left as is when the spline has no segments.
+ */
+auto TessellateCatmullRom(spline_catmull_rom const &Spline,   //!<
+                          std::span<fluffy::math3d::tup> Out  //!<
+                          ) -> void;
+
 auto SplineTestCatmullRom(fluffy::math3d::FLOAT Xoffs = 2,  //!<
                           fluffy::math3d::FLOAT Yoffs = 2,  //!<
                           fluffy::math3d::FLOAT Zoffs = 0   //!<
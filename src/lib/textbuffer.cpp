@@ -0,0 +1,97 @@
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#include "textbuffer.hpp"
+
+namespace fluffy
+{
+namespace render
+{
+//------------------------------------------------------------------------------
+auto text_buffer::operator=(std::string_view Str) -> text_buffer&
+{
+   Clear(*this);
+   return Append(*this, Str);
+}
+
+//------------------------------------------------------------------------------
+auto Clear(text_buffer& Buffer) -> text_buffer&
+{
+   Buffer.Size = 0;
+   Buffer.Data[0] = '\0';
+   return Buffer;
+}
+
+/**
+ * Append a string. Characters that do not fit are dropped.
+ */
+auto Append(text_buffer& Buffer, std::string_view Str) -> text_buffer&
+{
+   auto const NumChars = std::min(Str.size(), text_buffer::CAPACITY - Buffer.Size);
+   std::memcpy(Buffer.Data + Buffer.Size, Str.data(), NumChars);
+   Buffer.Size += NumChars;
+   Buffer.Data[Buffer.Size] = '\0';
+   return Buffer;
+}
+
+/**
+ * Append an integer. Nothing is appended when the number does not fit.
+ */
+auto AppendInt(text_buffer& Buffer, long long Value) -> text_buffer&
+{
+   auto const Result = std::to_chars(Buffer.Data + Buffer.Size, Buffer.Data + text_buffer::CAPACITY, Value);
+   if (Result.ec == std::errc())
+   {
+      Buffer.Size = static_cast<std::size_t>(Result.ptr - Buffer.Data);
+   }
+   Buffer.Data[Buffer.Size] = '\0';
+   return Buffer;
+}
+
+/**
+ * Append a floating point value with a fixed number of decimals, like std::to_string does with 6.
+ * Nothing is appended when the number does not fit.
+ */
+auto AppendFixed(text_buffer& Buffer, double Value, int Decimals) -> text_buffer&
+{
+   auto const Result = std::to_chars(Buffer.Data + Buffer.Size, Buffer.Data + text_buffer::CAPACITY, Value,
+                                     std::chars_format::fixed, Decimals);
+   if (Result.ec == std::errc())
+   {
+      Buffer.Size = static_cast<std::size_t>(Result.ptr - Buffer.Data);
+   }
+   Buffer.Data[Buffer.Size] = '\0';
+   return Buffer;
+}
+
+//------------------------------------------------------------------------------
+bool operator==(text_buffer const& lhs, std::string_view rhs) { return lhs.View() == rhs; }
+
+};  // end of namespace render
+};  // end of namespace fluffy
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
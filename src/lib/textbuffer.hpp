@@ -0,0 +1,73 @@
+#ifndef SRC_LIB_TEXTBUFFER_HPP_4B0E9C71_2D6A_4F3B_A1C8_5E7D3F902B64
+#define SRC_LIB_TEXTBUFFER_HPP_4B0E9C71_2D6A_4F3B_A1C8_5E7D3F902B64
+
+/**
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstddef>
+#include <string_view>
+
+namespace fluffy
+{
+namespace render
+{
+/**
+ * Fixed capacity, null terminated text that never allocates.
+ * Text that does not fit is truncated.
+ */
+struct text_buffer
+{
+   static constexpr std::size_t CAPACITY = 127;  //!< Max number of characters, excluding the terminator.
+
+   text_buffer() = default;
+   text_buffer(std::string_view Str) { *this = Str; }
+
+   auto operator=(std::string_view Str) -> text_buffer&;
+
+   auto c_str() const -> char const* { return Data; }
+   auto size() const -> std::size_t { return Size; }
+   auto empty() const -> bool { return Size == 0; }
+   auto View() const -> std::string_view { return {Data, Size}; }
+
+   char Data[CAPACITY + 1]{};  //!<
+   std::size_t Size{};         //!< Number of characters in Data.
+};
+
+/**
+ * Formatting helpers based on std::to_chars. They all append to the end of the buffer.
+ */
+auto Clear(text_buffer& Buffer) -> text_buffer&;
+auto Append(text_buffer& Buffer, std::string_view Str) -> text_buffer&;
+auto AppendInt(text_buffer& Buffer, long long Value) -> text_buffer&;
+auto AppendFixed(text_buffer& Buffer, double Value, int Decimals = 6) -> text_buffer&;
+
+/**
+ * In the namespace of text_buffer so that it is found by argument dependent lookup, e.g in REQUIRE().
+ */
+bool operator==(text_buffer const& lhs, std::string_view rhs);
+
+};  // end of namespace render
+};  // end of namespace fluffy
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
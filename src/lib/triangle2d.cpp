@@ -3,7 +3,15 @@
  * Copyright : Willy Clarke.
  */
 
+#include <algorithm>
+#include <bit>
 #include <iostream>
+#include <limits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "fluffymath.hpp"
 #include "triangle2d.hpp"
@@ -16,6 +24,121 @@ std::map<fluffy::render::edge_side, std::string> const edge_side_string_map = {
     {fluffy::render::edge_side::RIGHT, "RIGHT"}  //!<
 };
 
+/**
+ * The batch tests load the points straight from the vertices.
+ */
+static_assert(sizeof(fluffy::render::vertice_2d) == 2 * sizeof(fluffy::math3d::FLOAT));
+
+/**
+ * Set the bits of the points starting at Idx. The points are tested 1, 2 or 4 at the time from an
+ * Idx that is a multiple of that, so the bits never straddle two words.
+ */
+inline auto SetBits(std::span<uint64_t> Mask, std::size_t Idx, uint64_t Bits) -> std::size_t
+{
+   Mask[Idx / 64] |= Bits << (Idx % 64);
+   return std::size_t(std::popcount(Bits));
+}
+
+/**
+ * The SIMD versions of Edge() are written with the same operations in the same order, so they round
+ * the same way and agree with Isinside() on points exactly on an edge. A point is LEFT of A->B when
+ * the edge function is < 0, and it is inside when it is not LEFT of any of the three edges.
+ */
+#if defined(__AVX2__)
+inline auto IsLeft4(__m256d PX, __m256d PY, __m256d AX, __m256d AY, __m256d BX, __m256d BY) -> __m256d
+{
+   auto const E = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(PX, AX), _mm256_sub_pd(BY, AY)),
+                                _mm256_mul_pd(_mm256_sub_pd(PY, AY), _mm256_sub_pd(BX, AX)));
+   return _mm256_cmp_pd(E, _mm256_setzero_pd(), _CMP_LT_OQ);
+}
+#elif defined(__SSE2__)
+inline auto IsLeft2(__m128d PX, __m128d PY, __m128d AX, __m128d AY, __m128d BX, __m128d BY) -> __m128d
+{
+   auto const E = _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(PX, AX), _mm_sub_pd(BY, AY)),
+                             _mm_mul_pd(_mm_sub_pd(PY, AY), _mm_sub_pd(BX, AX)));
+   return _mm_cmplt_pd(E, _mm_setzero_pd());
+}
+#endif
+
+//------------------------------------------------------------------------------
+// NOTE: Spatial grid helpers
+//------------------------------------------------------------------------------
+
+/**
+ * Inclusive range of cells. Coordinates outside the grid are clamped to the border cells.
+ */
+struct cell_range
+{
+   int X0{}, Y0{}, X1{}, Y1{};
+};
+
+inline auto CellX(fluffy::render::spatial_grid_2d const& Grid, fluffy::math3d::FLOAT X) -> int
+{
+   auto const Cell = std::floor((X - Grid.Bounds.Min.X) / Grid.CellSize);
+   return static_cast<int>(std::clamp(Cell, fluffy::math3d::FLOAT(0), fluffy::math3d::FLOAT(Grid.NumCellsX - 1)));
+}
+
+inline auto CellY(fluffy::render::spatial_grid_2d const& Grid, fluffy::math3d::FLOAT Y) -> int
+{
+   auto const Cell = std::floor((Y - Grid.Bounds.Min.Y) / Grid.CellSize);
+   return static_cast<int>(std::clamp(Cell, fluffy::math3d::FLOAT(0), fluffy::math3d::FLOAT(Grid.NumCellsY - 1)));
+}
+
+inline auto Cells(fluffy::render::spatial_grid_2d const& Grid, fluffy::render::bounding_box const& Box) -> cell_range
+{
+   return {CellX(Grid, Box.Min.X), CellY(Grid, Box.Min.Y), CellX(Grid, Box.Max.X), CellY(Grid, Box.Max.Y)};
+}
+
+inline auto Cell(fluffy::render::spatial_grid_2d& Grid, int X, int Y) -> std::vector<uint32_t>&
+{
+   return Grid.vCells[std::size_t(Y) * std::size_t(Grid.NumCellsX) + std::size_t(X)];
+}
+
+inline auto Cell(fluffy::render::spatial_grid_2d const& Grid, int X, int Y) -> std::vector<uint32_t> const&
+{
+   return Grid.vCells[std::size_t(Y) * std::size_t(Grid.NumCellsX) + std::size_t(X)];
+}
+
+inline auto Overlaps(fluffy::render::bounding_box const& A, fluffy::render::bounding_box const& B) -> bool
+{
+   return A.Min.X <= B.Max.X && B.Min.X <= A.Max.X && A.Min.Y <= B.Max.Y && B.Min.Y <= A.Max.Y;
+}
+
+/**
+ * Squared distance from P to the closest point of the box, 0 when P is inside.
+ */
+inline auto DistanceSq(fluffy::render::bounding_box const& Box, fluffy::render::vertice_2d const& P)
+    -> fluffy::math3d::FLOAT
+{
+   using fluffy::math3d::FLOAT;
+   auto const DX = std::max({Box.Min.X - P.X, FLOAT(0), P.X - Box.Max.X});
+   auto const DY = std::max({Box.Min.Y - P.Y, FLOAT(0), P.Y - Box.Max.Y});
+   return DX * DX + DY * DY;
+}
+
+auto AddToCells(fluffy::render::spatial_grid_2d& Grid, cell_range const& Range, uint32_t Id) -> void
+{
+   for (int Y = Range.Y0; Y <= Range.Y1; ++Y)
+   {
+      for (int X = Range.X0; X <= Range.X1; ++X) Cell(Grid, X, Y).push_back(Id);
+   }
+}
+
+auto RemoveFromCells(fluffy::render::spatial_grid_2d& Grid, cell_range const& Range, uint32_t Id) -> void
+{
+   for (int Y = Range.Y0; Y <= Range.Y1; ++Y)
+   {
+      for (int X = Range.X0; X <= Range.X1; ++X)
+      {
+         auto& vIds = Cell(Grid, X, Y);
+         auto It = std::find(vIds.begin(), vIds.end(), Id);
+         if (It == vIds.end()) continue;
+         *It = vIds.back();
+         vIds.pop_back();
+      }
+   }
+}
+
 }
 namespace fluffy
 {
@@ -95,6 +218,384 @@ auto EdgeCross(vertice_2d const& A,  //!<
    return Result;
 }
 
+//------------------------------------------------------------------------------
+auto EdgeCross(vertice_2d_fx const& A,  //!<
+               vertice_2d_fx const& B,  //!<
+               vertice_2d_fx const& P   //!<
+               )                        //!<
+    -> int64_t
+{
+   return int64_t(B.X - A.X) * int64_t(P.Y - A.Y) - int64_t(B.Y - A.Y) * int64_t(P.X - A.X);
+}
+
+//------------------------------------------------------------------------------
+auto ToFixed(vertice_2d const& V) -> vertice_2d_fx
+{
+   using fluffy::math3d::FLOAT;
+   auto Convert = [](FLOAT Value) -> int32_t
+   {
+      auto const Limit = FLOAT(vertice_2d_fx::LIMIT);
+      auto const Scaled = std::clamp(Value * FLOAT(vertice_2d_fx::ONE), -Limit, Limit);
+      return static_cast<int32_t>(std::lround(Scaled));
+   };
+   return vertice_2d_fx{Convert(V.X), Convert(V.Y)};
+}
+
+//------------------------------------------------------------------------------
+auto IsTopLeft(vertice_2d_fx const& A,  //!<
+               vertice_2d_fx const& B   //!<
+               )                        //!<
+    -> bool
+{
+   /**
+    * The inside is at +X of a left edge, which makes it go up the screen.
+    * A top edge is horizontal with the inside below it, which makes it go to the right.
+    */
+   auto const DeltaX = B.X - A.X;
+   auto const DeltaY = B.Y - A.Y;
+   return DeltaY < 0 || (DeltaY == 0 && DeltaX > 0);
+}
+
+//------------------------------------------------------------------------------
+auto IsinsideMask(std::span<vertice_2d const> Points,  //!<
+                  vertice_2d const& V0,                //!<
+                  vertice_2d const& V1,                //!<
+                  vertice_2d const& V2,                //!<
+                  std::span<uint64_t> Mask             //!<
+                  )                                    //!<
+    -> std::size_t
+{
+   auto const Num = std::min(Points.size(), Mask.size() * 64);
+   std::fill(Mask.begin(), Mask.end(), uint64_t(0));
+
+   std::size_t NumInside{};
+   std::size_t Idx{};
+
+#if defined(__AVX2__)
+   {
+      auto const X0 = _mm256_set1_pd(V0.X), Y0 = _mm256_set1_pd(V0.Y);
+      auto const X1 = _mm256_set1_pd(V1.X), Y1 = _mm256_set1_pd(V1.Y);
+      auto const X2 = _mm256_set1_pd(V2.X), Y2 = _mm256_set1_pd(V2.Y);
+      for (; Idx + 4 <= Num; Idx += 4)
+      {
+         /** The unpack gives the points in the order 0, 2, 1, 3. The bits are swapped back below. */
+         auto const P01 = _mm256_loadu_pd(&Points[Idx].X);
+         auto const P23 = _mm256_loadu_pd(&Points[Idx + 2].X);
+         auto const PX = _mm256_unpacklo_pd(P01, P23);
+         auto const PY = _mm256_unpackhi_pd(P01, P23);
+
+         auto const Left = _mm256_or_pd(_mm256_or_pd(IsLeft4(PX, PY, X1, Y1, X0, Y0), IsLeft4(PX, PY, X2, Y2, X1, Y1)),
+                                        IsLeft4(PX, PY, X0, Y0, X2, Y2));
+         auto const Bits = uint64_t(~_mm256_movemask_pd(Left) & 0xF);
+         NumInside += SetBits(Mask, Idx, (Bits & 0x9) | (Bits & 0x2) << 1 | (Bits & 0x4) >> 1);
+      }
+   }
+#elif defined(__SSE2__)
+   {
+      auto const X0 = _mm_set1_pd(V0.X), Y0 = _mm_set1_pd(V0.Y);
+      auto const X1 = _mm_set1_pd(V1.X), Y1 = _mm_set1_pd(V1.Y);
+      auto const X2 = _mm_set1_pd(V2.X), Y2 = _mm_set1_pd(V2.Y);
+      for (; Idx + 2 <= Num; Idx += 2)
+      {
+         auto const P0 = _mm_loadu_pd(&Points[Idx].X);
+         auto const P1 = _mm_loadu_pd(&Points[Idx + 1].X);
+         auto const PX = _mm_unpacklo_pd(P0, P1);
+         auto const PY = _mm_unpackhi_pd(P0, P1);
+
+         auto const Left = _mm_or_pd(_mm_or_pd(IsLeft2(PX, PY, X1, Y1, X0, Y0), IsLeft2(PX, PY, X2, Y2, X1, Y1)),
+                                     IsLeft2(PX, PY, X0, Y0, X2, Y2));
+         NumInside += SetBits(Mask, Idx, uint64_t(~_mm_movemask_pd(Left) & 0x3));
+      }
+   }
+#endif
+
+   for (; Idx < Num; ++Idx)
+   {
+      if (Isinside(Points[Idx], V0, V1, V2)) NumInside += SetBits(Mask, Idx, 1);
+   }
+
+   return NumInside;
+}
+
+//------------------------------------------------------------------------------
+auto AddTriangle(triangle_set_2d& Set,  //!<
+                 vertice_2d const& V0,  //!<
+                 vertice_2d const& V1,  //!<
+                 vertice_2d const& V2   //!<
+                 )                      //!<
+    -> void
+{
+   Set.X0.push_back(V0.X);
+   Set.Y0.push_back(V0.Y);
+   Set.X1.push_back(V1.X);
+   Set.Y1.push_back(V1.Y);
+   Set.X2.push_back(V2.X);
+   Set.Y2.push_back(V2.Y);
+}
+
+//------------------------------------------------------------------------------
+auto Clear(triangle_set_2d& Set) -> void
+{
+   for (auto* ptrCoord : {&Set.X0, &Set.Y0, &Set.X1, &Set.Y1, &Set.X2, &Set.Y2}) ptrCoord->clear();
+}
+
+//------------------------------------------------------------------------------
+auto Size(triangle_set_2d const& Set) -> std::size_t
+{
+   return Set.X0.size();
+}
+
+//------------------------------------------------------------------------------
+auto HitTestMask(triangle_set_2d const& Set,  //!<
+                 vertice_2d const& P,         //!<
+                 std::span<uint64_t> Mask     //!<
+                 )                            //!<
+    -> std::size_t
+{
+   auto const Num = std::min(Size(Set), Mask.size() * 64);
+   std::fill(Mask.begin(), Mask.end(), uint64_t(0));
+
+   std::size_t NumHits{};
+   std::size_t Idx{};
+
+#if defined(__AVX2__)
+   {
+      auto const PX = _mm256_set1_pd(P.X);
+      auto const PY = _mm256_set1_pd(P.Y);
+      for (; Idx + 4 <= Num; Idx += 4)
+      {
+         auto const X0 = _mm256_loadu_pd(&Set.X0[Idx]), Y0 = _mm256_loadu_pd(&Set.Y0[Idx]);
+         auto const X1 = _mm256_loadu_pd(&Set.X1[Idx]), Y1 = _mm256_loadu_pd(&Set.Y1[Idx]);
+         auto const X2 = _mm256_loadu_pd(&Set.X2[Idx]), Y2 = _mm256_loadu_pd(&Set.Y2[Idx]);
+
+         auto const Left = _mm256_or_pd(_mm256_or_pd(IsLeft4(PX, PY, X1, Y1, X0, Y0), IsLeft4(PX, PY, X2, Y2, X1, Y1)),
+                                        IsLeft4(PX, PY, X0, Y0, X2, Y2));
+         NumHits += SetBits(Mask, Idx, uint64_t(~_mm256_movemask_pd(Left) & 0xF));
+      }
+   }
+#elif defined(__SSE2__)
+   {
+      auto const PX = _mm_set1_pd(P.X);
+      auto const PY = _mm_set1_pd(P.Y);
+      for (; Idx + 2 <= Num; Idx += 2)
+      {
+         auto const X0 = _mm_loadu_pd(&Set.X0[Idx]), Y0 = _mm_loadu_pd(&Set.Y0[Idx]);
+         auto const X1 = _mm_loadu_pd(&Set.X1[Idx]), Y1 = _mm_loadu_pd(&Set.Y1[Idx]);
+         auto const X2 = _mm_loadu_pd(&Set.X2[Idx]), Y2 = _mm_loadu_pd(&Set.Y2[Idx]);
+
+         auto const Left = _mm_or_pd(_mm_or_pd(IsLeft2(PX, PY, X1, Y1, X0, Y0), IsLeft2(PX, PY, X2, Y2, X1, Y1)),
+                                     IsLeft2(PX, PY, X0, Y0, X2, Y2));
+         NumHits += SetBits(Mask, Idx, uint64_t(~_mm_movemask_pd(Left) & 0x3));
+      }
+   }
+#endif
+
+   for (; Idx < Num; ++Idx)
+   {
+      vertice_2d const V0{Set.X0[Idx], Set.Y0[Idx]};
+      vertice_2d const V1{Set.X1[Idx], Set.Y1[Idx]};
+      vertice_2d const V2{Set.X2[Idx], Set.Y2[Idx]};
+      if (Isinside(P, V0, V1, V2)) NumHits += SetBits(Mask, Idx, 1);
+   }
+
+   return NumHits;
+}
+
+//------------------------------------------------------------------------------
+auto InitSpatialGrid(spatial_grid_2d& Grid,      //!<
+                     bounding_box const& Bounds,  //!<
+                     math3d::FLOAT CellSize       //!<
+                     )                            //!<
+    -> void
+{
+   using fluffy::math3d::FLOAT;
+   Grid = spatial_grid_2d{};
+   Grid.Bounds = Bounds;
+   Grid.CellSize = std::max(CellSize, fluffy::math3d::EPSILON);
+   Grid.NumCellsX = std::max(1, static_cast<int>(std::ceil((Bounds.Max.X - Bounds.Min.X) / Grid.CellSize)));
+   Grid.NumCellsY = std::max(1, static_cast<int>(std::ceil((Bounds.Max.Y - Bounds.Min.Y) / Grid.CellSize)));
+   Grid.vCells.resize(std::size_t(Grid.NumCellsX) * std::size_t(Grid.NumCellsY));
+}
+
+//------------------------------------------------------------------------------
+auto Insert(spatial_grid_2d& Grid, bounding_box const& Box) -> uint32_t
+{
+   uint32_t Id{};
+   if (!Grid.vFreeIds.empty())
+   {
+      Id = Grid.vFreeIds.back();
+      Grid.vFreeIds.pop_back();
+      Grid.vBoxes[Id] = Box;
+      Grid.vAlive[Id] = 1;
+   }
+   else
+   {
+      Id = static_cast<uint32_t>(Grid.vBoxes.size());
+      Grid.vBoxes.push_back(Box);
+      Grid.vAlive.push_back(1);
+   }
+
+   AddToCells(Grid, Cells(Grid, Box), Id);
+   ++Grid.NumItems;
+   return Id;
+}
+
+//------------------------------------------------------------------------------
+auto Move(spatial_grid_2d& Grid, uint32_t Id, bounding_box const& Box) -> bool
+{
+   if (Id >= Grid.vAlive.size() || !Grid.vAlive[Id]) return false;
+
+   /**
+    * Small moves usually stay within the same cells, then only the box is updated.
+    */
+   auto const Old = Cells(Grid, Grid.vBoxes[Id]);
+   auto const New = Cells(Grid, Box);
+   if (Old.X0 != New.X0 || Old.Y0 != New.Y0 || Old.X1 != New.X1 || Old.Y1 != New.Y1)
+   {
+      RemoveFromCells(Grid, Old, Id);
+      AddToCells(Grid, New, Id);
+   }
+   Grid.vBoxes[Id] = Box;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto Remove(spatial_grid_2d& Grid, uint32_t Id) -> bool
+{
+   if (Id >= Grid.vAlive.size() || !Grid.vAlive[Id]) return false;
+
+   RemoveFromCells(Grid, Cells(Grid, Grid.vBoxes[Id]), Id);
+   Grid.vAlive[Id] = 0;
+   Grid.vFreeIds.push_back(Id);
+   --Grid.NumItems;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+auto QueryPoint(spatial_grid_2d const& Grid,    //!<
+                vertice_2d const& P,            //!<
+                std::vector<uint32_t>& vResult  //!<
+                )                               //!<
+    -> std::size_t
+{
+   vResult.clear();
+   if (Grid.vCells.empty()) return 0;
+
+   bounding_box const Point{P, P};
+   for (auto const Id : Cell(Grid, CellX(Grid, P.X), CellY(Grid, P.Y)))
+   {
+      if (Overlaps(Grid.vBoxes[Id], Point)) vResult.push_back(Id);
+   }
+   return vResult.size();
+}
+
+//------------------------------------------------------------------------------
+auto QueryRect(spatial_grid_2d const& Grid,    //!<
+               bounding_box const& Rect,       //!<
+               std::vector<uint32_t>& vResult  //!<
+               )                               //!<
+    -> std::size_t
+{
+   vResult.clear();
+   if (Grid.vCells.empty()) return 0;
+
+   /**
+    * A box that spans several cells is reported only from the cell holding the top left corner
+    * of its overlap with Rect, so no ids are repeated and no bookkeeping is needed.
+    */
+   auto const Range = Cells(Grid, Rect);
+   for (int Y = Range.Y0; Y <= Range.Y1; ++Y)
+   {
+      for (int X = Range.X0; X <= Range.X1; ++X)
+      {
+         for (auto const Id : Cell(Grid, X, Y))
+         {
+            auto const& Box = Grid.vBoxes[Id];
+            if (!Overlaps(Box, Rect)) continue;
+            if (CellX(Grid, std::max(Box.Min.X, Rect.Min.X)) != X) continue;
+            if (CellY(Grid, std::max(Box.Min.Y, Rect.Min.Y)) != Y) continue;
+            vResult.push_back(Id);
+         }
+      }
+   }
+   return vResult.size();
+}
+
+//------------------------------------------------------------------------------
+auto QueryNearest(spatial_grid_2d const& Grid,    //!<
+                  vertice_2d const& P,            //!<
+                  std::size_t K,                  //!<
+                  std::vector<uint32_t>& vResult  //!<
+                  )                               //!<
+    -> std::size_t
+{
+   using fluffy::math3d::FLOAT;
+   vResult.clear();
+   if (Grid.vCells.empty() || K == 0) return 0;
+
+   /**
+    * Search rings of cells around the cell of P, keeping the K best in a max heap.
+    */
+   using candidate = std::pair<FLOAT, uint32_t>;
+   std::vector<candidate> vBest{};
+   vBest.reserve(K + 1);
+
+   auto Consider = [&](uint32_t Id)
+   {
+      candidate const Candidate{DistanceSq(Grid.vBoxes[Id], P), Id};
+      if (vBest.size() == K && !(Candidate < vBest.front())) return;
+      if (std::find_if(vBest.begin(), vBest.end(), [&](candidate const& C) { return C.second == Id; }) !=
+          vBest.end())
+         return;
+
+      vBest.push_back(Candidate);
+      std::push_heap(vBest.begin(), vBest.end());
+      if (vBest.size() > K)
+      {
+         std::pop_heap(vBest.begin(), vBest.end());
+         vBest.pop_back();
+      }
+   };
+
+   auto const CX = CellX(Grid, P.X);
+   auto const CY = CellY(Grid, P.Y);
+   auto const MaxRing = std::max(Grid.NumCellsX, Grid.NumCellsY);
+
+   for (int Ring = 0; Ring <= MaxRing; ++Ring)
+   {
+      /**
+       * Everything not seen yet is outside the block of the rings searched so far. The border cells also
+       * hold the boxes outside the grid, so the block only has a border where it is not at the grid border.
+       */
+      if (Ring > 0 && vBest.size() == K)
+      {
+         auto Bound = std::numeric_limits<FLOAT>::max();
+         auto const Min = Grid.Bounds.Min;
+         if (CX - Ring + 1 > 0) Bound = std::min(Bound, P.X - (Min.X + FLOAT(CX - Ring + 1) * Grid.CellSize));
+         if (CY - Ring + 1 > 0) Bound = std::min(Bound, P.Y - (Min.Y + FLOAT(CY - Ring + 1) * Grid.CellSize));
+         if (CX + Ring < Grid.NumCellsX) Bound = std::min(Bound, Min.X + FLOAT(CX + Ring) * Grid.CellSize - P.X);
+         if (CY + Ring < Grid.NumCellsY) Bound = std::min(Bound, Min.Y + FLOAT(CY + Ring) * Grid.CellSize - P.Y);
+         Bound = std::max(Bound, FLOAT(0));
+         if (vBest.front().first <= Bound * Bound) break;
+      }
+
+      for (int Y = std::max(CY - Ring, 0); Y <= std::min(CY + Ring, Grid.NumCellsY - 1); ++Y)
+      {
+         auto const IsEdgeRow = Y == CY - Ring || Y == CY + Ring;
+         auto const Step = IsEdgeRow ? 1 : 2 * Ring;
+         for (int X = CX - Ring; X <= CX + Ring; X += Step)
+         {
+            if (X < 0 || X >= Grid.NumCellsX) continue;
+            for (auto const Id : Cell(Grid, X, Y)) Consider(Id);
+         }
+      }
+   }
+
+   std::sort_heap(vBest.begin(), vBest.end());
+   for (auto const& Best : vBest) vResult.push_back(Best.second);
+   return vResult.size();
+}
+
 /**
  * Check if point P is inside a bounding box when given the vertices V0, V1 and V2.
  */
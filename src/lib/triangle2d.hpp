@@ -2,8 +2,12 @@
 #define FLUFFY_RENDER_TRIANGLE2D_HPP_D0C87E4D_89EA_435E_9D9F_4D43C7A96C88
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "fluffymath.hpp"
 
@@ -34,7 +38,21 @@ struct vertice_2d
 {
    math3d::FLOAT X{};
    math3d::FLOAT Y{};
-   bool Print{};
+};
+
+/**
+ * Screen position in 28.4 fixed point, i.e in 1/16 of a pixel.
+ * Edge functions on these are exact in 64 bit integers as long as the
+ * coordinates are within +/- LIMIT, which ToFixed() clamps to.
+ */
+struct vertice_2d_fx
+{
+   static constexpr int SUBPIXEL_BITS = 4;                   //!<
+   static constexpr int32_t ONE = 1 << SUBPIXEL_BITS;        //!< One pixel.
+   static constexpr int32_t LIMIT = (int32_t(1) << 27) - 1;  //!< Guard band, 8M pixels.
+
+   int32_t X{};  //!<
+   int32_t Y{};  //!<
 };
 
 struct bounding_box
@@ -43,6 +61,38 @@ struct bounding_box
    vertice_2d Max{};
 };
 
+/**
+ * Triangles stored as one array per coordinate, so that HitTestMask() can load
+ * several triangles at once.
+ */
+struct triangle_set_2d
+{
+   std::vector<math3d::FLOAT> X0{};  //!<
+   std::vector<math3d::FLOAT> Y0{};  //!<
+   std::vector<math3d::FLOAT> X1{};  //!<
+   std::vector<math3d::FLOAT> Y1{};  //!<
+   std::vector<math3d::FLOAT> X2{};  //!<
+   std::vector<math3d::FLOAT> Y2{};  //!<
+};
+
+/**
+ * Uniform grid over bounding boxes, for picking and overlap queries without scanning all the items.
+ * An item is listed in every cell its box touches. Boxes outside Bounds are kept in the border cells,
+ * so they are still found, only slower. Ids are reused after Remove().
+ */
+struct spatial_grid_2d
+{
+   bounding_box Bounds{};                        //!< Region covered by the cells.
+   math3d::FLOAT CellSize{};                     //!<
+   int NumCellsX{};                              //!<
+   int NumCellsY{};                              //!<
+   std::vector<std::vector<uint32_t>> vCells{};  //!< Item ids per cell, row by row.
+   std::vector<bounding_box> vBoxes{};           //!< Box per item id.
+   std::vector<uint8_t> vAlive{};                //!< 1 while the id is in use.
+   std::vector<uint32_t> vFreeIds{};             //!<
+   std::size_t NumItems{};                       //!<
+};
+
 struct projection
 {
    fluffy::math3d::FLOAT W{};      //!< Width
@@ -72,6 +122,87 @@ auto Isinside(render::vertice_2d const& P,   //!<
               )                              //!<
     -> bool;
 
+/**
+ * Test many points against one triangle, with the same result as Isinside() for each point.
+ * Bit (k % 64) of Mask[k / 64] is set when Points[k] is inside. Only the points that fit in
+ * Mask are tested. Returns the number of points inside.
+ * Uses AVX2 (4 points) or SSE2 (2 points) per step when the library is compiled for it.
+ */
+auto IsinsideMask(std::span<vertice_2d const> Points,  //!<
+                  vertice_2d const& V0,                //!<
+                  vertice_2d const& V1,                //!<
+                  vertice_2d const& V2,                //!<
+                  std::span<uint64_t> Mask             //!< (Points.size() + 63) / 64 words.
+                  )                                    //!<
+    -> std::size_t;
+
+auto AddTriangle(triangle_set_2d& Set,  //!<
+                 vertice_2d const& V0,  //!<
+                 vertice_2d const& V1,  //!<
+                 vertice_2d const& V2   //!<
+                 )                      //!<
+    -> void;
+
+auto Clear(triangle_set_2d& Set) -> void;
+
+auto Size(triangle_set_2d const& Set) -> std::size_t;
+
+/**
+ * Test one point against all the triangles in the set, with the same result as Isinside().
+ * Bit (k % 64) of Mask[k / 64] is set when P is inside triangle k. Returns the number of hits.
+ * For picking, the highest set bit is the triangle that was added last, i.e drawn on top.
+ */
+auto HitTestMask(triangle_set_2d const& Set,  //!<
+                 vertice_2d const& P,         //!<
+                 std::span<uint64_t> Mask     //!< (Size(Set) + 63) / 64 words.
+                 )                            //!<
+    -> std::size_t;
+
+/**
+ * Clear the grid and lay out cells of CellSize over Bounds.
+ */
+auto InitSpatialGrid(spatial_grid_2d& Grid,       //!<
+                     bounding_box const& Bounds,  //!<
+                     math3d::FLOAT CellSize       //!<
+                     )                            //!<
+    -> void;
+
+auto Insert(spatial_grid_2d& Grid, bounding_box const& Box) -> uint32_t;
+
+/**
+ * Give an item a new box. Returns false if Id is not in the grid.
+ */
+auto Move(spatial_grid_2d& Grid, uint32_t Id, bounding_box const& Box) -> bool;
+
+auto Remove(spatial_grid_2d& Grid, uint32_t Id) -> bool;
+
+/**
+ * The queries clear vResult and fill it with the ids found, each id once. They return the number of ids.
+ * Boxes include their border, i.e a point on the edge of a box hits it.
+ */
+auto QueryPoint(spatial_grid_2d const& Grid,    //!<
+                vertice_2d const& P,            //!<
+                std::vector<uint32_t>& vResult  //!<
+                )                               //!<
+    -> std::size_t;
+
+auto QueryRect(spatial_grid_2d const& Grid,    //!<
+               bounding_box const& Rect,       //!<
+               std::vector<uint32_t>& vResult  //!<
+               )                               //!<
+    -> std::size_t;
+
+/**
+ * The K items closest to P, closest first. The distance is to the nearest point of the box,
+ * so all the boxes that contain P come first with a distance of 0.
+ */
+auto QueryNearest(spatial_grid_2d const& Grid,    //!<
+                  vertice_2d const& P,            //!<
+                  std::size_t K,                  //!<
+                  std::vector<uint32_t>& vResult  //!<
+                  )                               //!<
+    -> std::size_t;
+
 auto BoundingBox(render::vertice_2d const& V0,  //!<
                  render::vertice_2d const& V1,  //!<
                  render::vertice_2d const& V2   //!<
@@ -104,6 +235,31 @@ auto EdgeCross(vertice_2d const& A,  //!<
                )                     //!<
     -> math3d::FLOAT;
 
+/**
+ * Exact edge function in 1/256 of a pixel squared. Positive when P is to the left of A->B
+ * with Y pointing down, i.e the same sign as the floating point EdgeCross().
+ */
+auto EdgeCross(vertice_2d_fx const& A,  //!<
+               vertice_2d_fx const& B,  //!<
+               vertice_2d_fx const& P   //!<
+               )                        //!<
+    -> int64_t;
+
+/**
+ * Round to the nearest 1/16 of a pixel.
+ */
+auto ToFixed(vertice_2d const& V) -> vertice_2d_fx;
+
+/**
+ * Top-left fill rule. A pixel exactly on an edge belongs to the triangle only when the edge is
+ * a top or a left edge, so triangles sharing an edge draw every pixel on it exactly once.
+ * The edge A->B is taken to have the inside where EdgeCross() is positive.
+ */
+auto IsTopLeft(vertice_2d_fx const& A,  //!<
+               vertice_2d_fx const& B   //!<
+               )                        //!<
+    -> bool;
+
 auto Rotate(vertice_2d const& Reference, vertice_2d const& V0, math3d::FLOAT Angle) -> vertice_2d;
 
 auto Length(vertice_2d const& V0, vertice_2d const& V1) -> math3d::FLOAT;
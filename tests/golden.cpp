@@ -0,0 +1,852 @@
+/**
+ * Golden image tests for the raster functions.
+ * Fixed scenes are drawn on an offscreen surface and compared pixel by pixel with the
+ * reference images in tests/golden. Each scene is then drawn repeatedly and must stay
+ * within a time budget, so a large performance regression fails as well.
+ *
+ * Run with FLUFFY_UPDATE_GOLDEN=1 in the environment to write new reference images after
+ * an intended change to the pixels. A mismatch writes <scene>.actual.ppm next to the test.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../src/lib/drawprimitives.hpp"
+#include "../src/lib/mesh.hpp"
+#include "../src/lib/splines.hpp"
+#include "testmeshes.hpp"
+
+#ifndef FLUFFY_GOLDEN_DIR
+#define FLUFFY_GOLDEN_DIR "tests/golden"
+#endif
+
+namespace
+{
+constexpr int WIDTH = 128;
+constexpr int HEIGHT = 96;
+
+/**
+ * Time budgets per frame. About five times what an optimized build needs, and still well
+ * above an unoptimized build, so only large regressions fail.
+ */
+constexpr double LINES_BUDGET_NS = 1e6;
+constexpr double CIRCLES_BUDGET_NS = 8e6;
+constexpr double TRIANGLES_BUDGET_NS = 1.5e6;
+constexpr double SPLINES_BUDGET_NS = 1.5e6;
+constexpr double WIREFRAME_BUDGET_NS = 10e6;
+
+/**
+ * Offscreen XRGB8888 surface, cleared to black.
+ */
+struct offscreen
+{
+   offscreen() : ptrSurface(SDL_CreateSurface(WIDTH, HEIGHT, SDL_PIXELFORMAT_XRGB8888)) {}
+   ~offscreen() { SDL_DestroySurface(ptrSurface); }
+   offscreen(offscreen const&) = delete;
+   offscreen& operator=(offscreen const&) = delete;
+
+   SDL_Surface* ptrSurface{};
+};
+
+//------------------------------------------------------------------------------
+auto ToRGB(SDL_Surface const* ptrSurface) -> std::vector<std::uint8_t>
+{
+   std::vector<std::uint8_t> vRGB{};
+   vRGB.reserve(std::size_t(3) * ptrSurface->w * ptrSurface->h);
+   for (int Y = 0; Y < ptrSurface->h; ++Y)
+   {
+      auto const* ptrBytes = static_cast<std::uint8_t const*>(ptrSurface->pixels) + Y * ptrSurface->pitch;
+      auto const* ptrRow = reinterpret_cast<std::uint32_t const*>(ptrBytes);
+      for (int X = 0; X < ptrSurface->w; ++X)
+      {
+         vRGB.push_back(std::uint8_t(ptrRow[X] >> 16));
+         vRGB.push_back(std::uint8_t(ptrRow[X] >> 8));
+         vRGB.push_back(std::uint8_t(ptrRow[X]));
+      }
+   }
+   return vRGB;
+}
+
+//------------------------------------------------------------------------------
+auto WritePPM(std::string const& FileName, std::vector<std::uint8_t> const& vRGB) -> bool
+{
+   auto* fp = std::fopen(FileName.c_str(), "wb");
+   if (!fp) return false;
+   std::fprintf(fp, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+   auto const Ok = std::fwrite(vRGB.data(), 1, vRGB.size(), fp) == vRGB.size();
+   return (std::fclose(fp) == 0) && Ok;
+}
+
+/**
+ * Read a binary PPM written by WritePPM(). Returns an empty vector if the file is missing
+ * or has another size.
+ */
+auto ReadPPM(std::string const& FileName) -> std::vector<std::uint8_t>
+{
+   std::vector<std::uint8_t> vRGB{};
+   auto* fp = std::fopen(FileName.c_str(), "rb");
+   if (!fp) return vRGB;
+
+   int Width{};
+   int Height{};
+   int MaxValue{};
+   if (std::fscanf(fp, "P6 %d %d %d", &Width, &Height, &MaxValue) == 3 && std::fgetc(fp) != EOF &&
+       Width == WIDTH && Height == HEIGHT && MaxValue == 255)
+   {
+      vRGB.resize(std::size_t(3) * WIDTH * HEIGHT);
+      if (std::fread(vRGB.data(), 1, vRGB.size(), fp) != vRGB.size()) vRGB.clear();
+   }
+   std::fclose(fp);
+   return vRGB;
+}
+
+/**
+ * Compare the surface with the reference image of the scene. Returns the number of pixels
+ * that differ, or -1 if there is no reference image.
+ */
+auto CompareGolden(std::string const& Scene, SDL_Surface const* ptrSurface) -> long
+{
+   auto const vActual = ToRGB(ptrSurface);
+   auto const Reference = std::string(FLUFFY_GOLDEN_DIR) + "/" + Scene + ".ppm";
+
+   if (std::getenv("FLUFFY_UPDATE_GOLDEN") != nullptr)
+   {
+      WritePPM(Reference, vActual);
+   }
+
+   auto const vExpected = ReadPPM(Reference);
+   if (vExpected.size() != vActual.size())
+   {
+      WritePPM(Scene + ".actual.ppm", vActual);
+      return -1;
+   }
+
+   long NumDiff{};
+   for (std::size_t Idx = 0; Idx < vActual.size(); Idx += 3)
+   {
+      if (vActual[Idx] != vExpected[Idx] || vActual[Idx + 1] != vExpected[Idx + 1] ||
+          vActual[Idx + 2] != vExpected[Idx + 2])
+      {
+         ++NumDiff;
+      }
+   }
+   if (NumDiff) WritePPM(Scene + ".actual.ppm", vActual);
+   return NumDiff;
+}
+
+/**
+ * Average time in nanoseconds to clear the surface and draw the scene.
+ */
+template <typename FN>
+auto TimeScene(SDL_Surface* ptrSurface, int Repeat, FN DrawScene) -> double
+{
+   auto const Begin = std::chrono::steady_clock::now();
+   for (int Idx = 0; Idx < Repeat; ++Idx)
+   {
+      SDL_FillSurfaceRect(ptrSurface, nullptr, 0);
+      DrawScene();
+   }
+   auto const End = std::chrono::steady_clock::now();
+   return std::chrono::duration<double, std::nano>(End - Begin).count() / Repeat;
+}
+
+//------------------------------------------------------------------------------
+auto DrawLines(SDL_Surface* ptrSurface) -> void
+{
+   fluffy::render::vertice_2d const Center{WIDTH / 2, HEIGHT / 2};
+   for (int Deg = 0; Deg < 360; Deg += 9)
+   {
+      auto const Rad = fluffy::math3d::Deg2Rad(Deg);
+      fluffy::render::vertice_2d const End{Center.X + 60 * std::cos(Rad), Center.Y + 44 * std::sin(Rad)};
+      fluffy::render::DrawLine(ptrSurface, Center, End, 0xFF8000 + Deg, Deg % 2 == 0);
+   }
+   for (int Y = 4; Y < HEIGHT; Y += 12)
+   {
+      fluffy::render::DrawLine(ptrSurface, {2, fluffy::math3d::FLOAT(Y)}, {WIDTH - 3, fluffy::math3d::FLOAT(Y + 7)},
+                               0x8000FFFF, false, fluffy::render::blend_mode::ALPHA);
+   }
+}
+
+//------------------------------------------------------------------------------
+auto DrawCircles(SDL_Surface* ptrSurface) -> void
+{
+   int Radius = 2;
+   for (int Y = 12; Y < HEIGHT; Y += 28)
+   {
+      for (int X = 12; X < WIDTH; X += 26, Radius += 1)
+      {
+         fluffy::render::vertice_2d const Center{fluffy::math3d::FLOAT(X), fluffy::math3d::FLOAT(Y)};
+         fluffy::render::DrawCircle(ptrSurface, Center, fluffy::math3d::FLOAT(Radius), 0x40C0FF, Radius % 2 == 0);
+         fluffy::render::DrawCircle(ptrSurface, Center + fluffy::render::vertice_2d{4, 4},
+                                    fluffy::math3d::FLOAT(Radius), 0x80FF4020, false,
+                                    fluffy::render::blend_mode::ADDITIVE);
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+auto DrawTriangles(fluffy::render::render_target& Target) -> void
+{
+   /** NOTE: FillTriangle() wants the vertices in clockwise order. */
+   fluffy::render::FillTriangle(Target.ptrSurface, {64, 4}, {120, 60}, {10, 40}, 0, true);
+   fluffy::render::FillTriangle(Target.ptrSurface, {4, 60}, {40, 92}, {4, 92}, 0x00FF00, false);
+
+   /**
+    * Two triangles that cut through each other, so the depth test decides per pixel.
+    */
+   fluffy::render::vertice_3d const A0{70, 50, 2, {1, 0, 0, 0}};
+   fluffy::render::vertice_3d const A1{124, 92, 8, {1, 1, 0, 0}};
+   fluffy::render::vertice_3d const A2{60, 92, 2, {1, 0, 1, 0}};
+   fluffy::render::vertice_3d const B0{80, 44, 8, {0, 0, 1, 0}};
+   fluffy::render::vertice_3d const B1{124, 70, 2, {0, 1, 1, 0}};
+   fluffy::render::vertice_3d const B2{56, 90, 5, {0, 1, 0, 0}};
+   fluffy::render::DrawTriangle(Target, A0, A1, A2);
+   fluffy::render::DrawTriangle(Target, B0, B1, B2);
+}
+
+//------------------------------------------------------------------------------
+auto DrawSpline(SDL_Surface* ptrSurface,                            //!<
+                fluffy::splines::spline_catmull_rom const& Spline,  //!<
+                std::vector<fluffy::render::vertice_2d>& vPoints,   //!< Scratch.
+                std::vector<Uint32>& vColors                        //!< Scratch.
+                )                                                   //!<
+    -> void
+{
+   vPoints.clear();
+   vColors.clear();
+   constexpr int NUM_STEPS = 400;
+   for (int Step = 0; Step < NUM_STEPS; ++Step)
+   {
+      auto const t = fluffy::math3d::FLOAT(Step) / NUM_STEPS;
+      auto const Value = fluffy::splines::SplineValueCatmullRom(Spline, t);
+      vPoints.push_back({Value.P.X, Value.P.Y});
+      vColors.push_back(fluffy::render::LerpColor(0xFF0000FFu, 0xFFFFFF00u, t));
+   }
+   fluffy::render::DrawPoints(ptrSurface, vPoints, 1, vColors);
+
+   for (auto const& P : Spline.CtrlPoints)
+   {
+      fluffy::render::DrawCircle(ptrSurface, {P.X, P.Y}, 3, 0xFFFFFF, false);
+   }
+}
+};  // end of anonymous namespace
+
+TEST_CASE("golden", "[lines]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   DrawLines(Offscreen.ptrSurface);
+   REQUIRE(CompareGolden("lines", Offscreen.ptrSurface) == 0);
+
+   auto const NS = TimeScene(Offscreen.ptrSurface, 200, [&]() { DrawLines(Offscreen.ptrSurface); });
+   INFO("lines: " << NS / 1000 << " us per frame");
+   REQUIRE(NS < LINES_BUDGET_NS);
+}
+
+TEST_CASE("golden", "[circles]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   DrawCircles(Offscreen.ptrSurface);
+   REQUIRE(CompareGolden("circles", Offscreen.ptrSurface) == 0);
+
+   auto const NS = TimeScene(Offscreen.ptrSurface, 200, [&]() { DrawCircles(Offscreen.ptrSurface); });
+   INFO("circles: " << NS / 1000 << " us per frame");
+   REQUIRE(NS < CIRCLES_BUDGET_NS);
+}
+
+TEST_CASE("golden", "[triangles]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+   fluffy::render::BeginFrame(Target, 0);
+
+   DrawTriangles(Target);
+   REQUIRE(CompareGolden("triangles", Offscreen.ptrSurface) == 0);
+
+   /**
+    * Only what reaches the surface is counted: not triangles outside it, behind the camera,
+    * or points without a color.
+    */
+   REQUIRE(Target.NumPrimitives == 2);
+   auto const NumPrimitives = Target.NumPrimitives;
+   fluffy::render::vertice_3d const Outside[3] = {{-30, -30, 1, {1, 1, 1, 0}}, {-10, -30, 1, {1, 1, 1, 0}},
+                                                  {-20, -10, 1, {1, 1, 1, 0}}};
+   fluffy::render::DrawTriangle(Target, Outside[0], Outside[1], Outside[2]);
+   fluffy::render::vertice_3d const Behind[3] = {{10, 10, -1, {1, 1, 1, 0}}, {50, 10, -1, {1, 1, 1, 0}},
+                                                 {30, 50, -1, {1, 1, 1, 0}}};
+   fluffy::render::DrawTriangle(Target, Behind[0], Behind[1], Behind[2]);
+   fluffy::render::vertice_2d const Points[3] = {{10, 10}, {-50, 10}, {10, HEIGHT + 50}};
+   Uint32 const Colors[1] = {0xFFFFFF};
+   fluffy::render::DrawPoints(Target, Points, 2, {}, fluffy::render::blend_mode::OPAQUE);
+   REQUIRE(Target.NumPrimitives == NumPrimitives);
+   fluffy::render::DrawPoints(Target, Points, 2, Colors, fluffy::render::blend_mode::OPAQUE);
+   REQUIRE(Target.NumPrimitives == NumPrimitives + 1);
+
+   /** Points that do not fit in an int are clipped before they are converted. */
+   auto const Inf = std::numeric_limits<fluffy::math3d::FLOAT>::infinity();
+   auto const NaN = std::numeric_limits<fluffy::math3d::FLOAT>::quiet_NaN();
+   fluffy::render::vertice_2d const Invalid[4] = {{NaN, 10}, {10, Inf}, {-Inf, 10}, {1e300, -1e300}};
+   fluffy::render::DrawPoints(Target, Invalid, 2, Colors, fluffy::render::blend_mode::OPAQUE);
+   REQUIRE(Target.NumPrimitives == NumPrimitives + 1);
+
+   auto const NS = TimeScene(Offscreen.ptrSurface, 200,
+                             [&]()
+                             {
+                                fluffy::render::ClearDepthBuffer(Target.Depth);
+                                DrawTriangles(Target);
+                             });
+   INFO("triangles: " << NS / 1000 << " us per frame");
+   REQUIRE(NS < TRIANGLES_BUDGET_NS);
+}
+
+TEST_CASE("golden", "[watertight]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A fan of triangles around a pixel sample that covers the whole surface. With the top-left
+    * rule every pixel is owned by exactly one triangle, including the one all the edges meet at.
+    */
+   constexpr int NUM_TRIANGLES = 12;
+   fluffy::render::vertice_2d const Center{64, 48};
+   auto Outer = [&](int Idx) -> fluffy::render::vertice_2d
+   {
+      auto const Angle = fluffy::math3d::FLOAT(2 * M_PI) * Idx / NUM_TRIANGLES + fluffy::math3d::FLOAT(0.1);
+      return Center + fluffy::render::vertice_2d{200 * std::cos(Angle), 200 * std::sin(Angle)};
+   };
+
+   std::vector<int> vHits(std::size_t(WIDTH) * HEIGHT, 0);
+   for (int Idx = 0; Idx < NUM_TRIANGLES; ++Idx)
+   {
+      SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+      fluffy::render::FillTriangle(Offscreen.ptrSurface, Center, Outer(Idx), Outer(Idx + 1), 0xFFFFFF, false);
+      auto const vRGB = ToRGB(Offscreen.ptrSurface);
+      for (std::size_t Pixel = 0; Pixel < vHits.size(); ++Pixel) vHits[Pixel] += vRGB[3 * Pixel] != 0;
+   }
+
+   REQUIRE(std::count(vHits.begin(), vHits.end(), 1) == WIDTH * HEIGHT);
+}
+
+TEST_CASE("golden", "[sliver]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A long sliver that reaches far outside the surface. Its area is small while the weights at
+    * the left side of the surface are large, about 2^32 once scaled to the gradient channels.
+    * The gradient is the barycentric weights, so the channels of every pixel add up to 255
+    * less the rounding, and the gradient covers the same pixels as a solid fill.
+    */
+   fluffy::render::vertice_2d const V0{-2000, -1500};
+   fluffy::render::vertice_2d const V1{120.5, 90};
+   fluffy::render::vertice_2d const V2{120, 90};
+
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   fluffy::render::FillTriangle(Offscreen.ptrSurface, V0, V1, V2, 0xFFFFFF, false);
+   auto const vSolid = ToRGB(Offscreen.ptrSurface);
+
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   fluffy::render::FillTriangle(Offscreen.ptrSurface, V0, V1, V2, 0, true);
+   auto const vGradient = ToRGB(Offscreen.ptrSurface);
+
+   int NumCovered{};
+   for (std::size_t Idx = 0; Idx < vSolid.size(); Idx += 3)
+   {
+      if (vSolid[Idx] == 0) continue;
+      ++NumCovered;
+      auto const Sum = int(vGradient[Idx]) + int(vGradient[Idx + 1]) + int(vGradient[Idx + 2]);
+      INFO("Pixel " << Idx / 3);
+      REQUIRE(Sum >= 252);
+      REQUIRE(Sum <= 255);
+   }
+   REQUIRE(NumCovered > 0);
+}
+
+TEST_CASE("golden", "[dirtyrects]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   auto SameRect = [](SDL_Rect const& A, SDL_Rect const& B)
+   { return A.x == B.x && A.y == B.y && A.w == B.w && A.h == B.h; };
+   auto CountCleared = [&]()
+   {
+      auto const vRGB = ToRGB(Offscreen.ptrSurface);
+      long NumCleared{};
+      for (std::size_t Idx = 0; Idx < vRGB.size(); Idx += 3) NumCleared += vRGB[Idx] == 0 && vRGB[Idx + 1] == 0;
+      return NumCleared;
+   };
+
+   /**
+    * The first frame clears the whole surface.
+    */
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0xFFFFFF);
+   fluffy::render::BeginFrame(Target, 0);
+   REQUIRE(CountCleared() == WIDTH * HEIGHT);
+   Target.Dirty.FullFrame = false;  // as after the first PresentFrame().
+
+   /**
+    * Overlapping and touching rects are merged, the others are kept, and all are clipped.
+    */
+   fluffy::render::MarkDirty(Target, {10, 10, 10, 10});
+   fluffy::render::MarkDirty(Target, {15, 15, 10, 10});
+   fluffy::render::MarkDirty(Target, {25, 10, 5, 5});
+   fluffy::render::MarkDirty(Target, {60, 60, 4, 4});
+   fluffy::render::MarkDirty(Target, {-5, HEIGHT - 6, 10, 20});
+   fluffy::render::MarkDirty(Target, {WIDTH, 0, 10, 10});
+   REQUIRE(Target.Dirty.Current.size() == 3);
+   REQUIRE(SameRect(Target.Dirty.Current[0], {10, 10, 20, 15}));
+   REQUIRE(SameRect(Target.Dirty.Current[1], {60, 60, 4, 4}));
+   REQUIRE(SameRect(Target.Dirty.Current[2], {0, HEIGHT - 6, 5, 6}));
+
+   /**
+    * The next frame clears only those rects, and they become the previous ones.
+    */
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0xFFFFFF);
+   fluffy::render::BeginFrame(Target, 0);
+   REQUIRE(CountCleared() == 20 * 15 + 4 * 4 + 5 * 6);
+   REQUIRE(Target.Dirty.Current.empty());
+   REQUIRE(Target.Dirty.Previous.size() == 3);
+   REQUIRE(SameRect(Target.Dirty.Previous[1], {60, 60, 4, 4}));
+
+   /**
+    * Past MAX_RECTS the rects collapse into the one rect that bounds them all.
+    */
+   constexpr int NUM_RECTS = int(fluffy::render::dirty_rects::MAX_RECTS);
+   for (int Idx = 0; Idx < NUM_RECTS; ++Idx) fluffy::render::MarkDirty(Target, {3 * (Idx % 32), 3 * (Idx / 32), 1, 1});
+   REQUIRE(Target.Dirty.Current.size() == fluffy::render::dirty_rects::MAX_RECTS);
+   fluffy::render::MarkDirty(Target, {100, 50, 2, 2});
+   REQUIRE(Target.Dirty.Current.size() == 1);
+   REQUIRE(SameRect(Target.Dirty.Current[0], {0, 0, 102, 52}));
+
+   /**
+    * What is drawn through the render target is cleared by the next frame.
+    */
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   fluffy::render::BeginFrame(Target, 0);
+   REQUIRE(Target.Dirty.Current.empty());
+   fluffy::render::DrawCircle(Target, {40, 40}, 12, 0xFFFFFF, false);
+   fluffy::render::DrawLine(Target, {70, 10}, {120, 80}, 0xFFFFFF, false);
+   REQUIRE(CountCleared() < WIDTH * HEIGHT);
+   fluffy::render::BeginFrame(Target, 0);
+   REQUIRE(CountCleared() == WIDTH * HEIGHT);
+}
+
+TEST_CASE("golden", "[glyphatlas]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A glyph atlas made up here, so no font is needed. The glyphs differ in width, offset and
+    * advance, and each has its own pattern, so a glyph in the wrong place is seen.
+    */
+   using fluffy::render::glyph_atlas;
+   glyph_atlas Atlas{};
+   Atlas.Height = 7;
+   for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+   {
+      auto const W = 3 + Idx % 4;
+      Atlas.Glyphs[Idx] = {Atlas.Width, 0, W, Atlas.Height, Idx % 2 == 0 ? 1 : -1, W + 1};
+      Atlas.Width += W;
+   }
+   Atlas.Mask.resize(std::size_t(Atlas.Width) * std::size_t(Atlas.Height));
+   for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+   {
+      auto const& Glyph = Atlas.Glyphs[Idx];
+      for (int Y = 0; Y < Glyph.H; ++Y)
+      {
+         for (int X = 0; X < Glyph.W; ++X)
+         {
+            Atlas.Mask[std::size_t(Y) * std::size_t(Atlas.Width) + std::size_t(Glyph.X + X)] = (X + Y + Idx) % 3 == 0;
+         }
+      }
+   }
+   Atlas.Kerning.assign(std::size_t(glyph_atlas::NUM_GLYPHS) * glyph_atlas::NUM_GLYPHS, 0);
+   auto KerningIdx = [](char Previous, char Current)
+   { return std::size_t(Previous - ' ') * glyph_atlas::NUM_GLYPHS + std::size_t(Current - ' '); };
+   Atlas.Kerning[KerningIdx('A', 'V')] = -2;
+
+   /**
+    * The e with an accent is outside the atlas and drawn as '?'.
+    */
+   fluffy::render::text_fmt TextFmt{};
+   TextFmt.ptrAtlas = &Atlas;
+   TextFmt.Color = {255, 128, 0, 255};
+   TextFmt.Position = {20, 30, 0, 0};
+   TextFmt.Text = "AVA 7\xC3\xA9~";
+
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+   fluffy::render::BeginFrame(Target, 0);
+   fluffy::render::Text(Target, TextFmt);
+
+   /**
+    * The expected image, blitted one glyph at the time from the mask.
+    */
+   std::vector<std::uint8_t> vExpected(std::size_t(3) * WIDTH * HEIGHT, 0);
+   auto PenX = TextFmt.Position.x;
+   auto Left = PenX;
+   auto Right = PenX;
+   char Previous{};
+   for (char const Char : std::string("AVA 7?~"))
+   {
+      if (Previous) PenX += Atlas.Kerning[KerningIdx(Previous, Char)];
+      auto const& Glyph = Atlas.Glyphs[Char - ' '];
+      for (int Y = 0; Y < Glyph.H; ++Y)
+      {
+         for (int X = 0; X < Glyph.W; ++X)
+         {
+            if (!Atlas.Mask[std::size_t(Y) * std::size_t(Atlas.Width) + std::size_t(Glyph.X + X)]) continue;
+            auto const Pixel = std::size_t(TextFmt.Position.y + Y) * WIDTH + std::size_t(PenX + Glyph.OffsetX + X);
+            vExpected[3 * Pixel + 0] = 255;
+            vExpected[3 * Pixel + 1] = 128;
+         }
+      }
+      Left = std::min(Left, PenX + Glyph.OffsetX);
+      Right = std::max(Right, PenX + Glyph.OffsetX + Glyph.W);
+      PenX += Glyph.Advance;
+      Previous = Char;
+   }
+
+   REQUIRE(ToRGB(Offscreen.ptrSurface) == vExpected);
+   REQUIRE(Target.NumPrimitives == 1);
+   REQUIRE(Target.Dirty.Current.size() == 1);
+   REQUIRE(Target.Dirty.Current[0].x == Left);
+   REQUIRE(Target.Dirty.Current[0].w == Right - Left);
+   REQUIRE(Target.Dirty.Current[0].h == Atlas.Height);
+
+   /**
+    * Text that runs off the surface is clipped, and nothing is drawn outside it.
+    */
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   TextFmt.Position = {WIDTH - 6, HEIGHT - 3, 0, 0};
+   fluffy::render::Text(Offscreen.ptrSurface, TextFmt);
+   auto const vRGB = ToRGB(Offscreen.ptrSurface);
+   REQUIRE(std::count(vRGB.begin(), vRGB.end(), std::uint8_t(255)) > 0);
+}
+
+TEST_CASE("golden", "[mesh]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A closed box with shared corners, numbered and wound as the cube in the wireframe app.
+    * It is turned so that three of its faces are seen.
+    */
+   fluffy::render::mesh Mesh{};
+   testmeshes::AddBox(Mesh, fluffy::math3d::Point(0, 0, 0), 1);
+   for (std::size_t Idx = 0; Idx < 8; ++Idx)
+   {
+      Mesh.vColors[Idx] = {fluffy::math3d::FLOAT(Mesh.X[Idx] > 0), fluffy::math3d::FLOAT(Mesh.Y[Idx] > 0),
+                           fluffy::math3d::FLOAT(Mesh.Z[Idx] > 0), 0};
+   }
+   REQUIRE(fluffy::render::NumVertices(Mesh) == 8);
+   REQUIRE(fluffy::render::NumTriangles(Mesh) == 12);
+
+   auto const Projection = fluffy::render::Projection(WIDTH, HEIGHT, fluffy::math3d::Deg2Rad(60), -10, 100);
+   auto const MatrixConversion = fluffy::render::ScreenCoord(Projection) * fluffy::render::Projection(Projection) *
+                                 fluffy::math3d::Translation(0, 0, 5) * fluffy::math3d::RotateY(0.6) *
+                                 fluffy::math3d::RotateX(0.5);
+   std::vector<fluffy::render::vertice_3d> vProjected{};
+   fluffy::render::TransformMesh(Mesh, MatrixConversion, vProjected);
+   REQUIRE(vProjected.size() == 8);
+
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+
+   /**
+    * The box is closed and convex, so culling the back faces must not change a single pixel.
+    */
+   fluffy::render::BeginFrame(Target, 0);
+   auto const All = fluffy::render::DrawMesh(Target, Mesh, vProjected, fluffy::render::cull_mode::NONE);
+   REQUIRE(All.NumDrawn == 12);
+   auto const vAll = ToRGB(Offscreen.ptrSurface);
+
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   fluffy::render::ClearDepthBuffer(Target.Depth);
+   auto const Culled = fluffy::render::DrawMesh(Target, Mesh, vProjected);
+   REQUIRE(Culled.NumTriangles == 12);
+   REQUIRE(Culled.NumDrawn == 6);
+   REQUIRE(Culled.NumCulled == 6);
+   REQUIRE(ToRGB(Offscreen.ptrSurface) == vAll);
+   REQUIRE(CompareGolden("mesh", Offscreen.ptrSurface) == 0);
+
+   /** Only the back faces are left when the front faces are culled. */
+   auto const Back = fluffy::render::DrawMesh(Target, Mesh, vProjected, fluffy::render::cull_mode::FRONT);
+   REQUIRE(Back.NumDrawn == 6);
+   REQUIRE(Back.NumRejected == 0);
+
+   /** Triangles that use a vertex that is not projected are counted, not drawn. */
+   auto const Partial = fluffy::render::DrawMesh(Target, Mesh, std::span(vProjected).first(7));
+   REQUIRE(Partial.NumTriangles == 12);
+   REQUIRE(Partial.NumRejected > 0);
+   REQUIRE(Partial.NumDrawn + Partial.NumCulled + Partial.NumClipped + Partial.NumRejected == 12);
+
+   /** Vertices without a color, e.g from a file with positions only, are white. */
+   auto View = fluffy::render::mesh_view(Mesh);
+   View.vColors = View.vColors.first(3);
+   std::vector<fluffy::render::vertice_3d> vUncolored{};
+   fluffy::render::TransformMesh(View, MatrixConversion, vUncolored);
+   REQUIRE(vUncolored.size() == 8);
+   REQUIRE(vUncolored[2].Col.R == Mesh.vColors[2].R);
+   REQUIRE(vUncolored[2].Col.G == Mesh.vColors[2].G);
+   REQUIRE(vUncolored[3].Col.G == 1);
+   View.vColors = {};
+   fluffy::render::TransformMesh(View, MatrixConversion, vUncolored);
+   REQUIRE(vUncolored.size() == 8);
+   for (std::size_t Idx = 0; Idx < vUncolored.size(); ++Idx)
+   {
+      REQUIRE(vUncolored[Idx].X == vProjected[Idx].X);
+      REQUIRE(vUncolored[Idx].Y == vProjected[Idx].Y);
+      REQUIRE(vUncolored[Idx].W == vProjected[Idx].W);
+      REQUIRE(vUncolored[Idx].Col.R == 1);
+      REQUIRE(vUncolored[Idx].Col.G == 1);
+      REQUIRE(vUncolored[Idx].Col.B == 1);
+   }
+}
+
+TEST_CASE("golden", "[wireframe]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A triangulated grid of NUM x NUM vertices, about 10^5 edges after removing the shared ones.
+    * It spans three times the surface, so most of the edges are clipped or thrown away.
+    */
+   constexpr uint32_t NUM = 183;
+   fluffy::render::mesh Mesh{};
+   testmeshes::AddGrid(Mesh, NUM,
+                       [](uint32_t Col, uint32_t Row)
+                       {
+                          return fluffy::math3d::Point(fluffy::math3d::FLOAT(3 * WIDTH) * Col / (NUM - 1) - WIDTH,
+                                                       fluffy::math3d::FLOAT(3 * HEIGHT) * Row / (NUM - 1) - HEIGHT, 0);
+                       });
+   std::vector<fluffy::render::vertice_3d> vProjected{};
+   for (std::size_t Idx = 0; Idx < fluffy::render::NumVertices(Mesh); ++Idx)
+   {
+      auto const Col = fluffy::math3d::FLOAT(Idx % NUM) / NUM;
+      auto const Row = fluffy::math3d::FLOAT(Idx / NUM) / NUM;
+      vProjected.push_back({Mesh.X[Idx], Mesh.Y[Idx], 1, {Col, Row, 1, 0}});
+   }
+   fluffy::render::EdgesFromTriangles(Mesh);
+   constexpr std::size_t NUM_EDGES = 2 * (NUM - 1) * NUM + (NUM - 1) * (NUM - 1);
+   REQUIRE(fluffy::render::NumEdges(Mesh) == NUM_EDGES);
+
+   /** Running it twice, or adding a reversed copy of an edge, does not add anything. */
+   fluffy::render::AddEdge(Mesh, 1, 0);
+   fluffy::render::AddEdge(Mesh, 7, 7);
+   fluffy::render::DeduplicateEdges(Mesh);
+   REQUIRE(fluffy::render::NumEdges(Mesh) == NUM_EDGES);
+
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+   fluffy::render::BeginFrame(Target, 0);
+   auto const NumDrawn = fluffy::render::DrawWireframe(Target, Mesh, vProjected, 0, true);
+   REQUIRE(NumDrawn > 0);
+   REQUIRE(NumDrawn < NUM_EDGES / 4);
+   REQUIRE(Target.NumPrimitives == NumDrawn);
+
+   auto const NS = TimeScene(Offscreen.ptrSurface, 20,
+                             [&]() { fluffy::render::DrawWireframe(Target, Mesh, vProjected, 0, true); });
+   INFO("wireframe: " << NS / 1000 << " us per frame");
+   REQUIRE(NS < WIREFRAME_BUDGET_NS);
+
+   /**
+    * Edges inside the surface come out exactly as DrawLine() draws them.
+    */
+   std::vector<fluffy::render::vertice_3d> const vInside = {
+       {10, 10, 1, {1, 0, 0, 0}}, {110, 20, 1, {0, 1, 0, 0}}, {60, 85, 1, {0, 0, 1, 0}}, {20, 70, 1, {1, 1, 0, 0}}};
+   std::vector<uint32_t> const vEdges = {0, 1, 1, 2, 2, 3, 3, 0, 0, 2};
+   for (bool const UseColorGradient : {false, true})
+   {
+      SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+      REQUIRE(fluffy::render::DrawEdges(Offscreen.ptrSurface, vInside, vEdges, 0xFF8000, UseColorGradient) == 5);
+      auto const vEdgesRGB = ToRGB(Offscreen.ptrSurface);
+
+      SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+      for (std::size_t Idx = 0; Idx < vEdges.size(); Idx += 2)
+      {
+         auto const& V0 = vInside[vEdges[Idx]];
+         auto const& V1 = vInside[vEdges[Idx + 1]];
+         fluffy::render::DrawLine(Offscreen.ptrSurface, {V0.X, V0.Y}, {V1.X, V1.Y}, 0xFF8000, UseColorGradient);
+      }
+      REQUIRE(ToRGB(Offscreen.ptrSurface) == vEdgesRGB);
+   }
+
+   /**
+    * A line starting outside is clipped, and keeps the gradient of the whole line. The same
+    * line drawn fully inside, 64 pixels further right, gives the colors to compare with.
+    */
+   std::vector<fluffy::render::vertice_3d> const vCrossing = {{-50, 10, 1}, {50, 10, 1}, {14, 20, 1}, {114, 20, 1}};
+   std::vector<uint32_t> const vCrossingEdges = {0, 1, 2, 3};
+   SDL_FillSurfaceRect(Offscreen.ptrSurface, nullptr, 0);
+   REQUIRE(fluffy::render::DrawEdges(Offscreen.ptrSurface, vCrossing, vCrossingEdges, 0x0080FF, true) == 2);
+   auto const vRGB = ToRGB(Offscreen.ptrSurface);
+   auto Pixel = [&](int X, int Y, int Channel) -> int { return vRGB[3 * (std::size_t(Y) * WIDTH + X) + Channel]; };
+   for (int X = 0; X < 50; ++X)
+   {
+      for (int Channel = 0; Channel < 3; ++Channel)
+      {
+         REQUIRE(std::abs(Pixel(X, 10, Channel) - Pixel(X + 64, 20, Channel)) <= 1);
+      }
+   }
+   REQUIRE(Pixel(50, 10, 0) + Pixel(50, 10, 1) + Pixel(50, 10, 2) == 0);
+
+   /** Edges with a vertex behind the eye are left out. */
+   std::vector<fluffy::render::vertice_3d> const vBehind = {{10, 10, 1}, {50, 50, -1}};
+   std::vector<uint32_t> const vBehindEdges = {0, 1, 0, 5};
+   REQUIRE(fluffy::render::DrawEdges(Offscreen.ptrSurface, vBehind, vBehindEdges, 0xFFFFFF, false) == 0);
+}
+
+TEST_CASE("golden", "[occlusion]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   /**
+    * A wall across the middle of the screen, and boxes behind it, beside it and in front of it.
+    */
+   fluffy::render::mesh Wall{};
+   fluffy::render::AddVertex(Wall, fluffy::math3d::Point(-2, -1.5, 5), {0, 0, 1, 0});
+   fluffy::render::AddVertex(Wall, fluffy::math3d::Point(2, -1.5, 5), {0, 0, 1, 0});
+   fluffy::render::AddVertex(Wall, fluffy::math3d::Point(2, 1.5, 5), {0, 0, 1, 0});
+   fluffy::render::AddVertex(Wall, fluffy::math3d::Point(-2, 1.5, 5), {0, 0, 1, 0});
+   fluffy::render::AddTriangle(Wall, 0, 1, 2);
+   fluffy::render::AddTriangle(Wall, 0, 2, 3);
+
+   std::vector<fluffy::render::mesh> vBehind{};
+   for (int Row = -1; Row <= 1; ++Row)
+   {
+      for (int Col = -1; Col <= 1; ++Col)
+      {
+         testmeshes::AddBox(vBehind.emplace_back(), fluffy::math3d::Point(Col, 0.5 * Row, 10), 0.2, {1, 0.5, 0, 0});
+      }
+   }
+   fluffy::render::mesh Beside{};
+   testmeshes::AddBox(Beside, fluffy::math3d::Point(6, 0, 10), 0.5, {1, 0.5, 0, 0});
+   fluffy::render::mesh AtEdge{};
+   testmeshes::AddBox(AtEdge, fluffy::math3d::Point(4, 0, 10), 0.5, {1, 0.5, 0, 0});
+   fluffy::render::mesh InFront{};
+   testmeshes::AddBox(InFront, fluffy::math3d::Point(0, 0, 3), 0.2, {1, 0.5, 0, 0});
+
+   auto const Projection = fluffy::render::Projection(WIDTH, HEIGHT, fluffy::math3d::Deg2Rad(60), -10, 100);
+   auto const MatrixConversion = fluffy::render::ScreenCoord(Projection) * fluffy::render::Projection(Projection);
+   auto Test = [&](fluffy::render::render_target const& Target, fluffy::render::mesh const& Mesh)
+   {
+      fluffy::math3d::tup Min{};
+      fluffy::math3d::tup Max{};
+      REQUIRE(fluffy::render::MeshBounds(Mesh, Min, Max));
+      return fluffy::render::TestBoundingBox(Target, MatrixConversion, Min, Max);
+   };
+
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, Offscreen.ptrSurface);
+   REQUIRE(Target.Pyramid.Levels.size() == 5);
+   REQUIRE(Target.Pyramid.Levels[0].Width == WIDTH / fluffy::render::depth_pyramid::TILE);
+   REQUIRE(Target.Pyramid.Levels.back().Farthest.size() == 1);
+
+   /** Nothing is drawn yet, so everything on the screen is in front. */
+   fluffy::render::BeginFrame(Target, 0);
+   fluffy::render::UpdateDepthPyramid(Target);
+   REQUIRE(Test(Target, vBehind[4]) == fluffy::render::visibility::IN_FRONT);
+
+   std::vector<fluffy::render::vertice_3d> vProjected{};
+   fluffy::render::TransformMesh(Wall, MatrixConversion, vProjected);
+   REQUIRE(fluffy::render::DrawMesh(Target, Wall, vProjected, fluffy::render::cull_mode::NONE).NumDrawn == 2);
+   fluffy::render::UpdateDepthPyramid(Target);
+   REQUIRE(std::abs(Target.Pyramid.Levels.back().Nearest[0] - 0.2f) < 1e-6f);
+
+   for (auto const& Box : vBehind) REQUIRE(Test(Target, Box) == fluffy::render::visibility::HIDDEN);
+   REQUIRE(Test(Target, Beside) == fluffy::render::visibility::IN_FRONT);
+   REQUIRE(Test(Target, AtEdge) == fluffy::render::visibility::VISIBLE);
+   REQUIRE(Test(Target, InFront) == fluffy::render::visibility::IN_FRONT);
+
+   /**
+    * The test is conservative: drawing the hidden boxes does not change a pixel.
+    */
+   auto const vWall = ToRGB(Offscreen.ptrSurface);
+   for (auto const& Box : vBehind)
+   {
+      fluffy::render::TransformMesh(Box, MatrixConversion, vProjected);
+      fluffy::render::DrawMesh(Target, Box, vProjected, fluffy::render::cull_mode::NONE);
+   }
+   REQUIRE(ToRGB(Offscreen.ptrSurface) == vWall);
+
+   /** Boxes outside the screen are hidden, boxes around the eye can not be tested. */
+   fluffy::render::mesh Outside{};
+   testmeshes::AddBox(Outside, fluffy::math3d::Point(50, 0, 10), 1, {1, 0.5, 0, 0});
+   REQUIRE(Test(Target, Outside) == fluffy::render::visibility::HIDDEN);
+   fluffy::render::mesh AroundEye{};
+   testmeshes::AddBox(AroundEye, fluffy::math3d::Point(0, 0, 0), 1, {1, 0.5, 0, 0});
+   REQUIRE(Test(Target, AroundEye) == fluffy::render::visibility::VISIBLE);
+
+   /** The next frame starts with an empty pyramid. */
+   fluffy::render::BeginFrame(Target, 0);
+   REQUIRE(Test(Target, vBehind[4]) == fluffy::render::visibility::IN_FRONT);
+}
+
+TEST_CASE("golden", "[splines]")
+{
+   offscreen Offscreen{};
+   REQUIRE(Offscreen.ptrSurface != nullptr);
+
+   std::vector<fluffy::math3d::tup> vCtrlPoints{};
+   fluffy::math3d::FLOAT const Y[] = {70, 20, 60, 15, 80, 40};
+   for (int Idx = 0; Idx < 6; ++Idx) vCtrlPoints.push_back(fluffy::math3d::Point(10 + 21 * Idx, Y[Idx], 0));
+   auto const Spline = fluffy::splines::InitCatmullRom(vCtrlPoints);
+
+   std::vector<fluffy::render::vertice_2d> vPoints{};
+   std::vector<Uint32> vColors{};
+   DrawSpline(Offscreen.ptrSurface, Spline, vPoints, vColors);
+   REQUIRE(CompareGolden("splines", Offscreen.ptrSurface) == 0);
+
+   auto const NS =
+       TimeScene(Offscreen.ptrSurface, 200, [&]() { DrawSpline(Offscreen.ptrSurface, Spline, vPoints, vColors); });
+   INFO("splines: " << NS / 1000 << " us per frame");
+   REQUIRE(NS < SPLINES_BUDGET_NS);
+}
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
@@ -0,0 +1,139 @@
+/**
+ * Tests that count heap allocations. They are built against a copy of the library compiled with
+ * FLUFFY_OVR_MEMALLOC, so that memcheck.cpp overrides malloc and new, see CMakeLists.txt.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "../src/lib/drawprimitives.hpp"
+#include "../src/lib/memcheck.hpp"
+#include "../src/lib/textbuffer.hpp"
+
+TEST_CASE("textbuffer", "[noallocation]")
+{
+   REQUIRE(fluffy::memcheck::IsActive());
+
+   /**
+    * A glyph atlas made up here, so no font is needed. Each glyph is a 4x6 cell with a diagonal.
+    */
+   using fluffy::render::glyph_atlas;
+   glyph_atlas Atlas{};
+   Atlas.Width = 4 * glyph_atlas::NUM_GLYPHS;
+   Atlas.Height = 6;
+   Atlas.Mask.resize(std::size_t(Atlas.Width) * std::size_t(Atlas.Height));
+   for (int Idx = 0; Idx < glyph_atlas::NUM_GLYPHS; ++Idx)
+   {
+      Atlas.Glyphs[Idx] = {4 * Idx, 0, 4, 6, 0, 5};
+      for (int Y = 0; Y < 4; ++Y) Atlas.Mask[std::size_t(Y) * std::size_t(Atlas.Width) + std::size_t(4 * Idx + Y)] = 1;
+   }
+
+   SDL_Surface* ptrSurface = SDL_CreateSurface(320, 240, SDL_PIXELFORMAT_XRGB8888);
+   REQUIRE(ptrSurface != nullptr);
+   fluffy::render::render_target Target{};
+   fluffy::render::InitRenderTarget(Target, ptrSurface);
+
+   fluffy::render::text_fmt Fps{};
+   fluffy::render::text_fmt Info{};
+   Fps.ptrAtlas = &Atlas;
+   Info.ptrAtlas = &Atlas;
+   Info.Position.y = 20;
+
+   /**
+    * Format and draw the same kind of HUD text as the wireframe app does each frame.
+    */
+   fluffy::render::text_buffer Pos{};
+   auto DrawHud = [&](int Frame)
+   {
+      fluffy::render::BeginFrame(Target, 0);
+
+      fluffy::render::Clear(Fps.Text);
+      fluffy::render::AppendInt(Fps.Text, Frame);
+      fluffy::render::Append(Fps.Text, "fps");
+      fluffy::render::Text(Target, Fps);
+
+      fluffy::render::Clear(Info.Text);
+      fluffy::render::Append(Info.Text, "t=");
+      fluffy::render::AppendFixed(Info.Text, Frame * 0.001);
+      fluffy::render::Append(Info.Text, ". Z=");
+      fluffy::render::AppendFixed(Info.Text, 1.0 / (Frame + 1));
+      fluffy::render::Append(Info.Text, ". P:");
+      fluffy::render::AppendFixed(Info.Text, -Frame * 3.25);
+      fluffy::render::Text(Target, Info);
+
+      fluffy::render::text_fmt PosInfo{};
+      PosInfo.ptrAtlas = &Atlas;
+      PosInfo.Position = {Frame % 200, 40, 0, 0};
+      fluffy::render::Append(PosInfo.Text, "(");
+      fluffy::render::AppendInt(PosInfo.Text, Frame);
+      fluffy::render::Append(PosInfo.Text, ",");
+      fluffy::render::AppendInt(PosInfo.Text, -Frame);
+      fluffy::render::Append(PosInfo.Text, ")");
+      fluffy::render::Text(Target, PosInfo);
+      Pos = PosInfo.Text;
+   };
+
+   DrawHud(0);
+   auto const NumAllocationsBefore = fluffy::memcheck::NumAllocations();
+
+   for (int Frame = 1; Frame < 1000; ++Frame) DrawHud(Frame);
+
+   auto const NumAllocationsAfter = fluffy::memcheck::NumAllocations();
+   REQUIRE(NumAllocationsAfter == NumAllocationsBefore);
+   REQUIRE(Pos == "(999,-999)");
+   REQUIRE(Target.NumPrimitives == 3 * 1000);
+
+   SDL_DestroySurface(ptrSurface);
+}
+
+TEST_CASE("memcheck", "[counting]")
+{
+   REQUIRE(fluffy::memcheck::IsActive());
+
+   /**
+    * Every way to get memory from the heap is counted. The pointers go through a volatile so
+    * that the compiler can not leave the allocations out.
+    */
+   void* volatile ptrSink{};
+   auto Count = [&](auto Allocate) -> std::size_t
+   {
+      auto const Before = fluffy::memcheck::NumAllocations();
+      Allocate();
+      return fluffy::memcheck::NumAllocations() - Before;
+   };
+
+   REQUIRE(Count([&]() { ptrSink = std::malloc(16); }) == 1);
+   REQUIRE(Count([&]() { ptrSink = std::realloc(ptrSink, 4096); }) == 1);
+   std::free(ptrSink);
+   REQUIRE(Count([&]() { ptrSink = std::calloc(4, 16); }) == 1);
+   std::free(ptrSink);
+   REQUIRE(Count([&]() { ptrSink = new int[10]; }) == 1);
+   delete[] static_cast<int*>(ptrSink);
+   REQUIRE(Count([&]() { ptrSink = new (std::nothrow) int; }) == 1);
+   delete static_cast<int*>(ptrSink);
+}
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
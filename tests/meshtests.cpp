@@ -0,0 +1,399 @@
+/**
+ * Tests of the mesh loaders, the geometry cache and the mesh simplification.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../src/lib/geometrycache.hpp"
+#include "../src/lib/mesh.hpp"
+#include "../src/lib/meshloader.hpp"
+#include "../src/lib/meshlod.hpp"
+#include "../src/lib/splines.hpp"
+#include "testmeshes.hpp"
+
+TEST_CASE("meshloader", "[obj][ply]")
+{
+   /**
+    * Comments, normals and texture coordinates are skipped, a quad is split in two triangles
+    * and negative indices count back from the last vertex.
+    */
+   std::string const Obj = "# a quad and a triangle\n"
+                           "o quad\n"
+                           "v 0 0 0\n"
+                           "v 1.5 0 0 1 0 0\n"
+                           "v\t1.5 +2 -0.25\r\n"
+                           "v 0 2 1e-1\n"
+                           "vn 0 0 1\n"
+                           "vt 0.5 0.5\n"
+                           "f 1/1/1 2/1/1 3/1/1 4/1/1\n"
+                           "v 9 9 9\n"
+                           "f -1 -2 -3";
+   fluffy::render::mesh Mesh{};
+   REQUIRE(fluffy::render::LoadObj(Mesh, Obj));
+   REQUIRE(fluffy::render::NumVertices(Mesh) == 5);
+   REQUIRE(Mesh.X == std::vector<fluffy::math3d::FLOAT>{0, 1.5, 1.5, 0, 9});
+   REQUIRE(Mesh.Y == std::vector<fluffy::math3d::FLOAT>{0, 0, 2, 2, 9});
+   REQUIRE(Mesh.Z == std::vector<fluffy::math3d::FLOAT>{0, 0, -0.25, 0.1, 9});
+   REQUIRE(Mesh.vColors[1].Y == 0);
+   REQUIRE(Mesh.vColors[2].Y == 1);
+   REQUIRE(Mesh.vIndices == std::vector<uint32_t>{0, 1, 2, 0, 2, 3, 4, 3, 2});
+
+   REQUIRE_FALSE(fluffy::render::LoadObj(Mesh, "v 0 0 0\nv 1 0 0\nf 1 2 3\n"));
+   REQUIRE(fluffy::render::NumVertices(Mesh) == 0);
+   REQUIRE_FALSE(fluffy::render::LoadObj(Mesh, "v 0 0 zero\n"));
+   REQUIRE_FALSE(fluffy::render::LoadObj(Mesh, "v 0 0\n"));
+
+   /**
+    * A grid large enough to be split in chunks gives the same mesh on one thread as on many.
+    */
+   constexpr uint32_t NUM = 300;
+   fluffy::render::mesh Expected{};
+   testmeshes::AddGrid(Expected, NUM,
+                       [](uint32_t Col, uint32_t Row) { return fluffy::math3d::Point(Col * 0.5, Row * 0.25, 0); });
+
+   /** Written with one quad per cell, which the loader splits back into the two triangles. */
+   std::string Grid{};
+   for (std::size_t Idx = 0; Idx < fluffy::render::NumVertices(Expected); ++Idx)
+   {
+      Grid += "v " + std::to_string(Expected.X[Idx]) + " " + std::to_string(Expected.Y[Idx]) + " 0\n";
+   }
+   for (std::size_t Idx = 0; Idx < Expected.vIndices.size(); Idx += 6)
+   {
+      auto const* ptrIdx = &Expected.vIndices[Idx];
+      Grid += "f " + std::to_string(ptrIdx[0] + 1) + " " + std::to_string(ptrIdx[1] + 1) + " " +
+              std::to_string(ptrIdx[2] + 1) + " " + std::to_string(ptrIdx[5] + 1) + "\n";
+   }
+   fluffy::render::mesh Single{};
+   REQUIRE(fluffy::render::LoadObj(Single, Grid, 1));
+   REQUIRE(fluffy::render::NumVertices(Single) == NUM * NUM);
+   REQUIRE(fluffy::render::NumTriangles(Single) == 2 * (NUM - 1) * (NUM - 1));
+   REQUIRE(Single.X == Expected.X);
+   REQUIRE(Single.Y == Expected.Y);
+   REQUIRE(Single.vIndices == Expected.vIndices);
+   REQUIRE(fluffy::render::LoadObj(Mesh, Grid, 8));
+   REQUIRE(Mesh.X == Single.X);
+   REQUIRE(Mesh.Y == Single.Y);
+   REQUIRE(Mesh.vIndices == Single.vIndices);
+
+   /**
+    * Binary PLY with uchar colors, in both byte orders. The second face is a quad, which
+    * takes the one face at a time path.
+    */
+   for (bool const BigEndian : {false, true})
+   {
+      std::string Ply = std::string("ply\nformat ") + (BigEndian ? "binary_big_endian" : "binary_little_endian") +
+                        " 1.0\n"
+                        "comment made by hand\n"
+                        "element vertex 4\n"
+                        "property float x\nproperty float y\nproperty double z\n"
+                        "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+                        "element face 2\n"
+                        "property list uchar int vertex_indices\n"
+                        "end_header\n";
+      auto Append = [&](auto Value)
+      {
+         char Bytes[sizeof(Value)];
+         std::memcpy(Bytes, &Value, sizeof(Value));
+         if (BigEndian) std::reverse(std::begin(Bytes), std::end(Bytes));
+         Ply.append(Bytes, sizeof(Value));
+      };
+      for (int Idx = 0; Idx < 4; ++Idx)
+      {
+         Append(float(Idx));
+         Append(float(2 * Idx));
+         Append(double(-Idx));
+         Append(uint8_t(255));
+         Append(uint8_t(Idx * 85));
+         Append(uint8_t(0));
+      }
+      Append(uint8_t(3));
+      for (int32_t Idx : {0, 1, 2}) Append(Idx);
+      Append(uint8_t(4));
+      for (int32_t Idx : {0, 1, 2, 3}) Append(Idx);
+
+      REQUIRE(fluffy::render::LoadPly(Mesh, Ply));
+      REQUIRE(Mesh.X == std::vector<fluffy::math3d::FLOAT>{0, 1, 2, 3});
+      REQUIRE(Mesh.Y == std::vector<fluffy::math3d::FLOAT>{0, 2, 4, 6});
+      REQUIRE(Mesh.Z == std::vector<fluffy::math3d::FLOAT>{0, -1, -2, -3});
+      REQUIRE(Mesh.vColors[3].X == 1);
+      REQUIRE(Mesh.vColors[3].Y == 1);
+      REQUIRE(Mesh.vColors[1].Z == 0);
+      REQUIRE(Mesh.vIndices == std::vector<uint32_t>{0, 1, 2, 0, 1, 2, 0, 2, 3});
+
+      REQUIRE_FALSE(fluffy::render::LoadPly(Mesh, std::string_view(Ply).substr(0, Ply.size() - 1)));
+      REQUIRE(fluffy::render::NumVertices(Mesh) == 0);
+   }
+
+   /**
+    * The grid written as a PLY file of triangles only, loaded from disk. Vertex and face
+    * counts above the chunk size are parsed in parallel.
+    */
+   std::string Ply = "ply\nformat binary_little_endian 1.0\nelement vertex " + std::to_string(NUM * NUM) +
+                     "\nproperty float x\nproperty float y\nproperty float z\nelement face " +
+                     std::to_string(fluffy::render::NumTriangles(Single)) +
+                     "\nproperty list uchar uint vertex_indices\nend_header\n";
+   auto Append = [&](auto Value) { Ply.append(reinterpret_cast<char const*>(&Value), sizeof(Value)); };
+   for (std::size_t Idx = 0; Idx < fluffy::render::NumVertices(Single); ++Idx)
+   {
+      Append(float(Single.X[Idx]));
+      Append(float(Single.Y[Idx]));
+      Append(float(Single.Z[Idx]));
+   }
+   for (std::size_t Idx = 0; Idx < Single.vIndices.size(); Idx += 3)
+   {
+      Append(uint8_t(3));
+      for (std::size_t Corner = 0; Corner < 3; ++Corner) Append(Single.vIndices[Idx + Corner]);
+   }
+
+   char const* FileName = "meshloader_test.ply";
+   auto* fp = std::fopen(FileName, "wb");
+   REQUIRE(fp != nullptr);
+   std::fwrite(Ply.data(), 1, Ply.size(), fp);
+   std::fclose(fp);
+
+   auto const Begin = std::chrono::steady_clock::now();
+   bool const Loaded = fluffy::render::LoadMesh(Mesh, FileName);
+   auto const End = std::chrono::steady_clock::now();
+   std::remove(FileName);
+   auto const US = std::chrono::duration<double, std::micro>(End - Begin).count();
+   INFO("mesh loader: " << US << " us");
+   REQUIRE(Loaded);
+   REQUIRE(Mesh.X == Single.X);
+   REQUIRE(Mesh.Y == Single.Y);
+   REQUIRE(Mesh.vIndices == Single.vIndices);
+
+   REQUIRE_FALSE(fluffy::render::LoadMesh(Mesh, "no such file.obj"));
+}
+
+TEST_CASE("geometrycache", "[write][open]")
+{
+   /**
+    * A mesh with edges and a sampled spline are written and read back in place.
+    */
+   fluffy::render::mesh Mesh{};
+   constexpr uint32_t NUM = 40;
+   testmeshes::AddGrid(Mesh, NUM,
+                       [](uint32_t Col, uint32_t Row) { return fluffy::math3d::Point(Col, Row, Col * Row); });
+   for (std::size_t Idx = 0; Idx < fluffy::render::NumVertices(Mesh); ++Idx)
+   {
+      Mesh.vColors[Idx] = {0.5, Mesh.Y[Idx] / NUM, 1, 0};
+   }
+   fluffy::render::EdgesFromTriangles(Mesh);
+   auto const Spline = fluffy::splines::SplineTestCatmullRom();
+
+   fluffy::cache::cache_builder Builder{};
+   fluffy::cache::AddMesh(Builder, 1, Mesh);
+   fluffy::cache::AddSpline(Builder, 2, Spline);
+   std::string const FileName = "geometrycache_test.fgc";
+   REQUIRE(fluffy::cache::WriteCache(Builder, FileName));
+
+   fluffy::cache::geometry_cache Cache{};
+   REQUIRE(fluffy::cache::OpenCache(Cache, FileName));
+
+   auto const View = fluffy::cache::FindMesh(Cache, 1);
+   REQUIRE(fluffy::render::NumVertices(View) == NUM * NUM);
+   REQUIRE(View.X.data() >= static_cast<void const*>(Cache.File.ptrData));
+   REQUIRE(reinterpret_cast<std::uintptr_t>(View.Z.data()) % fluffy::cache::SECTION_ALIGN == 0);
+   REQUIRE(std::equal(View.X.begin(), View.X.end(), Mesh.X.begin(), Mesh.X.end()));
+   REQUIRE(std::equal(View.Z.begin(), View.Z.end(), Mesh.Z.begin(), Mesh.Z.end()));
+   REQUIRE(std::equal(View.vIndices.begin(), View.vIndices.end(), Mesh.vIndices.begin(), Mesh.vIndices.end()));
+   REQUIRE(std::equal(View.vEdges.begin(), View.vEdges.end(), Mesh.vEdges.begin(), Mesh.vEdges.end()));
+   REQUIRE(View.vColors[NUM * 3].Y == Mesh.vColors[NUM * 3].Y);
+
+   /** The view is drawn in place, exactly as the mesh it came from. */
+   auto const MatrixConversion = fluffy::math3d::Translation(0, 0, 1);
+   std::vector<fluffy::render::vertice_3d> vFromMesh{};
+   std::vector<fluffy::render::vertice_3d> vFromView{};
+   fluffy::render::TransformMesh(Mesh, MatrixConversion, vFromMesh);
+   fluffy::render::TransformMesh(View, MatrixConversion, vFromView);
+   REQUIRE(vFromView.size() == vFromMesh.size());
+   REQUIRE(vFromView.back().X == vFromMesh.back().X);
+   REQUIRE(vFromView.back().Col.Y == vFromMesh.back().Col.Y);
+   REQUIRE(fluffy::render::ToMesh(View).vEdges == Mesh.vEdges);
+
+   auto const Loaded = fluffy::cache::ToSpline(fluffy::cache::FindSpline(Cache, 2));
+   REQUIRE(Loaded.CtrlPoints.size() == Spline.CtrlPoints.size());
+   REQUIRE(Loaded.vSpline.size() == Spline.vSpline.size());
+   REQUIRE(Loaded.vSpline[500].P.Y == Spline.vSpline[500].P.Y);
+   REQUIRE(fluffy::splines::SplineValueCatmullRom(Loaded, 0.3).P.X ==
+           fluffy::splines::SplineValueCatmullRom(Spline, 0.3).P.X);
+
+   REQUIRE(fluffy::render::NumVertices(fluffy::cache::FindMesh(Cache, 2)) == 0);
+   REQUIRE(fluffy::cache::FindSpline(Cache, 1).vSpline.empty());
+   fluffy::cache::CloseCache(Cache);
+
+   /**
+    * A truncated file, or one from another version, is not opened.
+    */
+   std::vector<char> vFile(std::size_t(std::filesystem::file_size(FileName)));
+   {
+      auto* fp = std::fopen(FileName.c_str(), "rb");
+      REQUIRE(fp != nullptr);
+      REQUIRE(std::fread(vFile.data(), 1, vFile.size(), fp) == vFile.size());
+      std::fclose(fp);
+   }
+   auto Rewrite = [&](std::size_t Size)
+   {
+      auto* fp = std::fopen(FileName.c_str(), "wb");
+      REQUIRE(fp != nullptr);
+      std::fwrite(vFile.data(), 1, Size, fp);
+      std::fclose(fp);
+   };
+   Rewrite(vFile.size() - 8);
+   REQUIRE_FALSE(fluffy::cache::OpenCache(Cache, FileName));
+   vFile[offsetof(fluffy::cache::file_header, Version)] += 1;
+   Rewrite(vFile.size());
+   REQUIRE_FALSE(fluffy::cache::OpenCache(Cache, FileName));
+   REQUIRE(Cache.Sections.empty());
+
+   std::remove(FileName.c_str());
+}
+
+TEST_CASE("geometrycache", "[nocolors]")
+{
+   /**
+    * A mesh without colors is found again, and is drawn with the default color as the mesh is.
+    */
+   fluffy::render::mesh Mesh{};
+   testmeshes::AddGrid(Mesh, 4, [](uint32_t Col, uint32_t Row) { return fluffy::math3d::Point(Col, Row, 1); });
+   Mesh.vColors.clear();
+
+   fluffy::cache::cache_builder Builder{};
+   fluffy::cache::AddMesh(Builder, 1, Mesh);
+   std::string const FileName = "geometrycache_nocolors_test.fgc";
+   REQUIRE(fluffy::cache::WriteCache(Builder, FileName));
+
+   fluffy::cache::geometry_cache Cache{};
+   REQUIRE(fluffy::cache::OpenCache(Cache, FileName));
+   auto const View = fluffy::cache::FindMesh(Cache, 1);
+   REQUIRE(fluffy::render::NumVertices(View) == 16);
+   REQUIRE(fluffy::render::NumTriangles(View) == fluffy::render::NumTriangles(Mesh));
+   REQUIRE(View.vColors.empty());
+
+   auto const MatrixConversion = fluffy::math3d::Translation(0, 0, 1);
+   std::vector<fluffy::render::vertice_3d> vFromMesh{};
+   std::vector<fluffy::render::vertice_3d> vFromView{};
+   fluffy::render::TransformMesh(Mesh, MatrixConversion, vFromMesh);
+   fluffy::render::TransformMesh(View, MatrixConversion, vFromView);
+   REQUIRE(vFromView.size() == vFromMesh.size());
+   REQUIRE(vFromView.back().X == vFromMesh.back().X);
+   REQUIRE(vFromView.back().Col.Y == vFromMesh.back().Col.Y);
+
+   fluffy::cache::CloseCache(Cache);
+   std::remove(FileName.c_str());
+}
+
+TEST_CASE("meshlod", "[simplify][selectlod]")
+{
+   /**
+    * A sphere is simplified into a chain of levels, and the level follows the distance.
+    */
+   fluffy::render::mesh Sphere{};
+   constexpr uint32_t SLICES = 64;
+   constexpr uint32_t STACKS = 32;
+   for (uint32_t Stack = 0; Stack <= STACKS; ++Stack)
+   {
+      auto const Phi = M_PI * Stack / STACKS;
+      for (uint32_t Slice = 0; Slice < SLICES; ++Slice)
+      {
+         auto const Theta = 2 * M_PI * Slice / SLICES;
+         fluffy::render::AddVertex(Sphere,
+                                   fluffy::math3d::Point(std::sin(Phi) * std::cos(Theta), std::cos(Phi),
+                                                         std::sin(Phi) * std::sin(Theta)),
+                                   {1, 1, 1, 0});
+      }
+   }
+   for (uint32_t Stack = 0; Stack < STACKS; ++Stack)
+   {
+      for (uint32_t Slice = 0; Slice < SLICES; ++Slice)
+      {
+         auto const I0 = Stack * SLICES + Slice;
+         auto const I1 = Stack * SLICES + (Slice + 1) % SLICES;
+         if (Stack > 0) fluffy::render::AddTriangle(Sphere, I0, I1, I0 + SLICES);
+         if (Stack + 1 < STACKS) fluffy::render::AddTriangle(Sphere, I1, I1 + SLICES, I0 + SLICES);
+      }
+   }
+   auto const NumFull = fluffy::render::NumTriangles(Sphere);
+
+   auto const Start = std::chrono::steady_clock::now();
+   auto const Chain = fluffy::render::BuildLodChain(Sphere, 6);
+   auto const Micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+   INFO("BuildLodChain of " << NumFull << " triangles in " << Micros << " us");
+
+   REQUIRE(Chain.vLevels.size() == 6);
+   REQUIRE(fluffy::render::NumTriangles(Chain.vLevels[0]) == NumFull);
+   REQUIRE(Chain.vErrors[0] == 0);
+   for (std::size_t Level = 1; Level < Chain.vLevels.size(); ++Level)
+   {
+      auto const& Mesh = Chain.vLevels[Level];
+      REQUIRE(fluffy::render::NumTriangles(Mesh) <= fluffy::render::NumTriangles(Chain.vLevels[Level - 1]) / 2);
+      REQUIRE(Chain.vErrors[Level] > Chain.vErrors[Level - 1]);
+
+      /** The vertices stay close to the sphere, within the error of the level. */
+      for (std::size_t Idx = 0; Idx < fluffy::render::NumVertices(Mesh); ++Idx)
+      {
+         auto const R = std::sqrt(Mesh.X[Idx] * Mesh.X[Idx] + Mesh.Y[Idx] * Mesh.Y[Idx] + Mesh.Z[Idx] * Mesh.Z[Idx]);
+         REQUIRE(std::abs(R - 1) <= Chain.vErrors[Level] + 0.05);
+      }
+   }
+   REQUIRE(std::abs(Chain.Radius - 1) < 1e-9);
+
+   auto const Proj = fluffy::render::Projection(800, 600, fluffy::math3d::Deg2Rad(60), 0.1, 1000);
+   auto const Near = fluffy::render::SelectLod(Chain, fluffy::math3d::Translation(0, 0, 3), Proj);
+   auto const Far = fluffy::render::SelectLod(Chain, fluffy::math3d::Translation(0, 0, 300), Proj);
+   REQUIRE(Near == 0);
+   REQUIRE(Far > Near);
+   auto const Tiny = fluffy::render::SelectLod(Chain, fluffy::math3d::Translation(0, 0, 30000), Proj);
+   REQUIRE(Tiny == Chain.vLevels.size() - 1);
+   REQUIRE(fluffy::render::ProjectedRadius(Chain.Center, 1, fluffy::math3d::Translation(0, 0, -5), Proj) == 0);
+   auto const Pixels = fluffy::render::ProjectedRadius(Chain.Center, 1, fluffy::math3d::Translation(0, 0, 10), Proj);
+   REQUIRE(std::abs(Pixels - 300 / std::tan(fluffy::math3d::Deg2Rad(30)) / 9) < 0.5);
+
+   /**
+    * A flat grid collapses without error and keeps its outline.
+    */
+   fluffy::render::mesh Grid{};
+   constexpr uint32_t NUM = 20;
+   testmeshes::AddGrid(Grid, NUM, [](uint32_t Col, uint32_t Row) { return fluffy::math3d::Point(Col, Row, 0); });
+   auto const Flat = fluffy::render::SimplifyMesh(Grid, 2);
+   REQUIRE(Flat.Error < 1e-6);
+   REQUIRE(fluffy::render::NumTriangles(Flat.Mesh) < 100);
+   REQUIRE(std::abs(*std::min_element(Flat.Mesh.X.begin(), Flat.Mesh.X.end())) < 1e-6);
+   REQUIRE(std::abs(*std::max_element(Flat.Mesh.X.begin(), Flat.Mesh.X.end()) - (NUM - 1)) < 1e-6);
+   REQUIRE(std::abs(*std::max_element(Flat.Mesh.Y.begin(), Flat.Mesh.Y.end()) - (NUM - 1)) < 1e-6);
+   for (auto const Z : Flat.Mesh.Z) REQUIRE(std::abs(Z) < 1e-9);
+   INFO("Flat grid down to " << fluffy::render::NumTriangles(Flat.Mesh) << " triangles");
+}
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/
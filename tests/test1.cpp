@@ -1,9 +1,25 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include "../src/lib/blend.hpp"
+#include "../src/lib/framecapture.hpp"
+#include "../src/lib/framepipeline.hpp"
+#include "../src/lib/frameprofiler.hpp"
+#include "../src/lib/framescheduler.hpp"
+#include "../src/lib/pixelformat.hpp"
 #include "../src/lib/splines.hpp"
+#include "../src/lib/textbuffer.hpp"
 #include "../src/lib/triangle2d.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
 
 unsigned int Factorial(unsigned int number) { return number <= 1 ? number : Factorial(number - 1) * number; }
 
@@ -326,6 +342,258 @@ TEST_CASE("render2d", "[Magnitude2]")
    REQUIRE(L == fluffy::math3d::FLOAT(M_SQRT2));
 }
 
+TEST_CASE("render2d", "[fixed point]")
+{
+   using fluffy::render::vertice_2d;
+   using fluffy::render::vertice_2d_fx;
+   static_assert(sizeof(vertice_2d_fx) == 8);
+
+   auto const F = fluffy::render::ToFixed(vertice_2d{1.5, -0.25});
+   REQUIRE(F.X == 24);
+   REQUIRE(F.Y == -4);
+
+   auto const Nearest = fluffy::render::ToFixed(vertice_2d{0.03, 0.1});
+   REQUIRE(Nearest.X == 0);
+   REQUIRE(Nearest.Y == 2);
+
+   auto const Clamped = fluffy::render::ToFixed(vertice_2d{1e12, -1e12});
+   REQUIRE(Clamped.X == vertice_2d_fx::LIMIT);
+   REQUIRE(Clamped.Y == -vertice_2d_fx::LIMIT);
+
+   /**
+    * Same triangle as in [Check Area 1], the area is exact in 1/256 of a pixel squared.
+    */
+   vertice_2d_fx const V0{0, 0};
+   vertice_2d_fx const V1{16, 16};
+   vertice_2d_fx const V2{16, 0};
+   REQUIRE(fluffy::render::EdgeCross(V0, V2, V1) == 256);
+   REQUIRE(fluffy::render::EdgeCross(V0, V1, V2) == -256);
+   REQUIRE(fluffy::render::EdgeCross(V0, V1, vertice_2d_fx{8, 8}) == 0);
+
+   /** The guard band is wide enough that the edge function does not overflow. */
+   vertice_2d_fx const Min{-vertice_2d_fx::LIMIT, -vertice_2d_fx::LIMIT};
+   vertice_2d_fx const MaxX{vertice_2d_fx::LIMIT, -vertice_2d_fx::LIMIT};
+   vertice_2d_fx const MaxY{-vertice_2d_fx::LIMIT, vertice_2d_fx::LIMIT};
+   auto const Side = int64_t(2) * vertice_2d_fx::LIMIT;
+   REQUIRE(fluffy::render::EdgeCross(Min, MaxX, MaxY) == Side * Side);
+
+   /** Y is pointing down, a left edge goes up and a top edge goes to the right. */
+   REQUIRE(fluffy::render::IsTopLeft({0, 16}, {0, 0}) == true);
+   REQUIRE(fluffy::render::IsTopLeft({0, 0}, {16, 0}) == true);
+   REQUIRE(fluffy::render::IsTopLeft({0, 0}, {0, 16}) == false);
+   REQUIRE(fluffy::render::IsTopLeft({16, 0}, {0, 0}) == false);
+
+   /** Exactly one of the two triangles that share an edge owns it. */
+   REQUIRE(fluffy::render::IsTopLeft(V0, V1) != fluffy::render::IsTopLeft(V1, V0));
+}
+
+TEST_CASE("render2d", "[batch inside]")
+{
+   using fluffy::render::vertice_2d;
+
+   /**
+    * Points on a quarter pixel grid hit the edges and vertices exactly. The odd count leaves a tail.
+    */
+   vertice_2d const V0{2, 1};
+   vertice_2d const V1{9, 8};
+   vertice_2d const V2{1, 7};
+   std::vector<vertice_2d> vPoints{};
+   for (int Y = 0; Y <= 40; ++Y)
+   {
+      for (int X = 0; X <= 40; ++X)
+      {
+         vPoints.push_back({X * fluffy::math3d::FLOAT(0.25), Y * fluffy::math3d::FLOAT(0.25)});
+      }
+   }
+   REQUIRE(vPoints.size() % 4 != 0);
+
+   std::vector<uint64_t> vMask((vPoints.size() + 63) / 64, ~uint64_t(0));
+   auto const NumInside = fluffy::render::IsinsideMask(vPoints, V0, V1, V2, vMask);
+
+   std::size_t NumExpected{};
+   bool Same = true;
+   for (std::size_t Idx = 0; Idx < vPoints.size(); ++Idx)
+   {
+      auto const Expected = fluffy::render::Isinside(vPoints[Idx], V0, V1, V2);
+      NumExpected += Expected;
+      Same = Same && Expected == bool(vMask[Idx / 64] >> (Idx % 64) & 1);
+   }
+   REQUIRE(Same);
+   REQUIRE(NumInside == NumExpected);
+   REQUIRE(NumInside > 0);
+   REQUIRE(vMask.back() >> (vPoints.size() % 64) == 0);
+
+   /** Only the points that fit in the mask are tested. */
+   uint64_t Word{};
+   REQUIRE(fluffy::render::IsinsideMask(vPoints, V0, V1, V2, std::span<uint64_t>(&Word, 1)) ==
+           std::size_t(std::popcount(vMask[0])));
+}
+
+TEST_CASE("render2d", "[hit test]")
+{
+   using fluffy::render::vertice_2d;
+
+   /**
+    * A grid of squares split in two, so each point inside the grid hits one triangle, or two when it
+    * is on a shared edge.
+    */
+   fluffy::render::triangle_set_2d Set{};
+   for (int Y = 0; Y < 3; ++Y)
+   {
+      for (int X = 0; X < 3; ++X)
+      {
+         vertice_2d const P00{fluffy::math3d::FLOAT(X), fluffy::math3d::FLOAT(Y)};
+         vertice_2d const P10{fluffy::math3d::FLOAT(X + 1), fluffy::math3d::FLOAT(Y)};
+         vertice_2d const P01{fluffy::math3d::FLOAT(X), fluffy::math3d::FLOAT(Y + 1)};
+         vertice_2d const P11{fluffy::math3d::FLOAT(X + 1), fluffy::math3d::FLOAT(Y + 1)};
+         fluffy::render::AddTriangle(Set, P00, P10, P11);
+         fluffy::render::AddTriangle(Set, P00, P11, P01);
+      }
+   }
+   fluffy::render::AddTriangle(Set, {10, 10}, {12, 10}, {12, 12});
+   REQUIRE(fluffy::render::Size(Set) == 19);
+
+   std::vector<uint64_t> vMask(1);
+   for (auto const& P : {vertice_2d{0.75, 0.25}, vertice_2d{1.5, 1.5}, vertice_2d{2.25, 2.9}, vertice_2d{5, 5},
+                         vertice_2d{11.5, 10.5}})
+   {
+      auto const NumHits = fluffy::render::HitTestMask(Set, P, vMask);
+
+      std::size_t NumExpected{};
+      uint64_t Expected{};
+      for (std::size_t Idx = 0; Idx < fluffy::render::Size(Set); ++Idx)
+      {
+         vertice_2d const V0{Set.X0[Idx], Set.Y0[Idx]};
+         vertice_2d const V1{Set.X1[Idx], Set.Y1[Idx]};
+         vertice_2d const V2{Set.X2[Idx], Set.Y2[Idx]};
+         if (fluffy::render::Isinside(P, V0, V1, V2))
+         {
+            Expected |= uint64_t(1) << Idx;
+            ++NumExpected;
+         }
+      }
+      REQUIRE(vMask[0] == Expected);
+      REQUIRE(NumHits == NumExpected);
+   }
+
+   REQUIRE(fluffy::render::HitTestMask(Set, {0.75, 0.25}, vMask) == 1);
+   REQUIRE(vMask[0] == 1);
+   REQUIRE(fluffy::render::HitTestMask(Set, {1.5, 1.5}, vMask) == 2);
+   REQUIRE(fluffy::render::HitTestMask(Set, {11.5, 10.5}, vMask) == 1);
+   REQUIRE(vMask[0] == uint64_t(1) << 18);
+   REQUIRE(fluffy::render::HitTestMask(Set, {5, 5}, vMask) == 0);
+
+   fluffy::render::Clear(Set);
+   REQUIRE(fluffy::render::Size(Set) == 0);
+}
+
+TEST_CASE("render2d", "[spatial grid]")
+{
+   using fluffy::math3d::FLOAT;
+   using fluffy::render::bounding_box;
+   using fluffy::render::vertice_2d;
+
+   fluffy::render::spatial_grid_2d Grid{};
+   fluffy::render::InitSpatialGrid(Grid, {{0, 0}, {640, 480}}, 32);
+   REQUIRE(Grid.NumCellsX == 20);
+   REQUIRE(Grid.NumCellsY == 15);
+
+   /**
+    * Random boxes, some of them large and some partly or fully outside the grid.
+    */
+   std::mt19937 Generator(42);
+   std::uniform_real_distribution<FLOAT> Position(-100, 740);
+   std::uniform_real_distribution<FLOAT> Extent(0, 40);
+   auto RandomBox = [&]() -> bounding_box
+   {
+      vertice_2d const Min{Position(Generator), Position(Generator)};
+      auto const Scale = Extent(Generator) < 2 ? FLOAT(8) : FLOAT(1);
+      return {Min, Min + vertice_2d{Extent(Generator) * Scale, Extent(Generator) * Scale}};
+   };
+
+   std::vector<bounding_box> vBoxes{};
+   std::vector<uint32_t> vIds{};
+   for (int Idx = 0; Idx < 2000; ++Idx)
+   {
+      vBoxes.push_back(RandomBox());
+      vIds.push_back(fluffy::render::Insert(Grid, vBoxes.back()));
+   }
+
+   /** Move every third box and remove every seventh. */
+   std::vector<bool> vAlive(vBoxes.size(), true);
+   for (std::size_t Idx = 0; Idx < vBoxes.size(); Idx += 3)
+   {
+      vBoxes[Idx] = RandomBox();
+      REQUIRE(fluffy::render::Move(Grid, vIds[Idx], vBoxes[Idx]));
+   }
+   for (std::size_t Idx = 0; Idx < vBoxes.size(); Idx += 7)
+   {
+      REQUIRE(fluffy::render::Remove(Grid, vIds[Idx]));
+      vAlive[Idx] = false;
+   }
+   REQUIRE(fluffy::render::Remove(Grid, vIds[0]) == false);
+   REQUIRE(fluffy::render::Move(Grid, vIds[0], vBoxes[0]) == false);
+   REQUIRE(Grid.NumItems == 2000 - 286);
+
+   auto Contains = [](bounding_box const& Box, vertice_2d const& P)
+   { return Box.Min.X <= P.X && P.X <= Box.Max.X && Box.Min.Y <= P.Y && P.Y <= Box.Max.Y; };
+   auto Overlaps = [](bounding_box const& A, bounding_box const& B)
+   { return A.Min.X <= B.Max.X && B.Min.X <= A.Max.X && A.Min.Y <= B.Max.Y && B.Min.Y <= A.Max.Y; };
+   auto DistanceSq = [](bounding_box const& Box, vertice_2d const& P)
+   {
+      auto const DX = std::max({Box.Min.X - P.X, FLOAT(0), P.X - Box.Max.X});
+      auto const DY = std::max({Box.Min.Y - P.Y, FLOAT(0), P.Y - Box.Max.Y});
+      return DX * DX + DY * DY;
+   };
+
+   std::vector<uint32_t> vResult{};
+   bool SamePoint = true;
+   bool SameRect = true;
+   bool SameNearest = true;
+   for (int Query = 0; Query < 200; ++Query)
+   {
+      vertice_2d const P{Position(Generator), Position(Generator)};
+      std::vector<uint32_t> vExpected{};
+      for (std::size_t Idx = 0; Idx < vBoxes.size(); ++Idx)
+      {
+         if (vAlive[Idx] && Contains(vBoxes[Idx], P)) vExpected.push_back(vIds[Idx]);
+      }
+      fluffy::render::QueryPoint(Grid, P, vResult);
+      std::sort(vResult.begin(), vResult.end());
+      SamePoint = SamePoint && vResult == vExpected;
+
+      auto const Rect = RandomBox();
+      vExpected.clear();
+      for (std::size_t Idx = 0; Idx < vBoxes.size(); ++Idx)
+      {
+         if (vAlive[Idx] && Overlaps(vBoxes[Idx], Rect)) vExpected.push_back(vIds[Idx]);
+      }
+      fluffy::render::QueryRect(Grid, Rect, vResult);
+      std::sort(vResult.begin(), vResult.end());
+      SameRect = SameRect && vResult == vExpected;
+
+      /** Ties in the distance are broken by the lowest id. */
+      std::vector<std::pair<FLOAT, uint32_t>> vByDistance{};
+      for (std::size_t Idx = 0; Idx < vBoxes.size(); ++Idx)
+      {
+         if (vAlive[Idx]) vByDistance.push_back({DistanceSq(vBoxes[Idx], P), vIds[Idx]});
+      }
+      std::sort(vByDistance.begin(), vByDistance.end());
+      constexpr std::size_t K = 5;
+      vExpected.clear();
+      for (std::size_t Idx = 0; Idx < K; ++Idx) vExpected.push_back(vByDistance[Idx].second);
+      REQUIRE(fluffy::render::QueryNearest(Grid, P, K, vResult) == K);
+      SameNearest = SameNearest && vResult == vExpected;
+   }
+   REQUIRE(SamePoint);
+   REQUIRE(SameRect);
+   REQUIRE(SameNearest);
+
+   /** Removed ids are reused, the last one removed first. */
+   REQUIRE(fluffy::render::Insert(Grid, {{1, 1}, {2, 2}}) == vIds[1995]);
+   REQUIRE(fluffy::render::QueryNearest(Grid, {1, 1}, 1, vResult) == 1);
+}
+
 TEST_CASE("math3d", "[IdentityMatrix]")
 {
    auto I = fluffy::math3d::I();
@@ -649,6 +917,169 @@ TEST_CASE("splines", "[splineinit]")
 #endif
 }
 
+TEST_CASE("splines", "[splineedit]")
+{
+   /**
+    * Edit a long spline and compare it with one built from scratch from the same points.
+    */
+   std::mt19937 Rng(7);
+   std::uniform_real_distribution<fluffy::math3d::FLOAT> Dist(-10, 10);
+   std::vector<fluffy::math3d::tup> vP{};
+   for (int Idx = 0; Idx < 10000; ++Idx) vP.push_back(fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng)));
+
+   constexpr std::size_t SAMPLES = 16;
+   auto Spline = fluffy::splines::InitCatmullRom(vP);
+   fluffy::splines::SampleCatmullRom(Spline, SAMPLES);
+   REQUIRE(fluffy::splines::NumCtrlPoints(Spline) == vP.size());
+   REQUIRE(Spline.vSegSamples.size() == vP.size() - 1);
+   REQUIRE(Spline.vSegSamples.back().size() == SAMPLES);
+   REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) == 0);
+
+   auto RequireSameAsRebuilt = [&]()
+   {
+      auto Rebuilt = fluffy::splines::InitCatmullRom(vP);
+      fluffy::splines::SampleCatmullRom(Rebuilt, SAMPLES);
+      REQUIRE(Spline.CtrlPoints.size() == Rebuilt.CtrlPoints.size());
+      REQUIRE(Spline.vSegSamples.size() == Rebuilt.vSegSamples.size());
+      REQUIRE(Spline.CtrlPoints.front().X == Rebuilt.CtrlPoints.front().X);
+      REQUIRE(Spline.CtrlPoints.back().Y == Rebuilt.CtrlPoints.back().Y);
+      for (std::size_t Seg = 0; Seg < Rebuilt.vSegSamples.size(); ++Seg)
+      {
+         REQUIRE(Spline.vSegSamples[Seg].size() == SAMPLES);
+         for (std::size_t Idx = 0; Idx < SAMPLES; ++Idx)
+         {
+            auto const A = fluffy::splines::SampleValueCatmullRom(Spline, Seg, Idx);
+            auto const B = fluffy::splines::SampleValueCatmullRom(Rebuilt, Seg, Idx);
+            if (A.P.X != B.P.X || A.P.Y != B.P.Y || A.P.Z != B.P.Z || A.t != B.t || A.Idx != B.Idx)
+            {
+               INFO("Sample " << Idx << " of segment " << Seg << " differs");
+               REQUIRE(false);
+            }
+         }
+      }
+   };
+
+   /** A move recomputes at most four segments, wherever it is on the spline. */
+   for (std::size_t Idx : {std::size_t(0), std::size_t(1), std::size_t(5000), vP.size() - 2, vP.size() - 1})
+   {
+      vP[Idx] = fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng));
+      REQUIRE(fluffy::splines::SetCtrlPoint(Spline, Idx, vP[Idx]));
+      REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) <= 4 * SAMPLES);
+   }
+   RequireSameAsRebuilt();
+
+   /** Only moves are timed, inserts and removes also move the tail of the points and matrices. */
+   auto const Start = std::chrono::steady_clock::now();
+   for (std::size_t Idx = 0; Idx < 1000; ++Idx)
+   {
+      fluffy::splines::SetCtrlPoint(Spline, 4000, fluffy::math3d::Point(Idx, 0, 0));
+      fluffy::splines::UpdateSamplesCatmullRom(Spline);
+   }
+   auto const Micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+   INFO("SetCtrlPoint and UpdateSamplesCatmullRom: " << Micros / 1000 << " us per move");
+   vP[4000] = fluffy::math3d::Point(999, 0, 0);
+
+   /**
+    * Edits at both ends resample the segments around each of them and nothing in between,
+    * also when an insert moves the segments of the last edit.
+    */
+   auto const Untouched = Spline.vSegSamples.size() / 2;
+   auto const Saved = Spline.vSegSamples[Untouched][0].X;
+   Spline.vSegSamples[Untouched][0].X = 1e9;
+   vP.front() = fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng));
+   vP.back() = fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng));
+   REQUIRE(fluffy::splines::SetCtrlPoint(Spline, 0, vP.front()));
+   REQUIRE(fluffy::splines::SetCtrlPoint(Spline, vP.size() - 1, vP.back()));
+   auto const Inserted = fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng));
+   vP.insert(vP.begin() + 2000, Inserted);
+   REQUIRE(fluffy::splines::InsertCtrlPoint(Spline, 2000, Inserted));
+   REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) == (2 + 2 + 4) * SAMPLES);
+   REQUIRE(Spline.vSegSamples[Untouched + 1][0].X == 1e9);
+   Spline.vSegSamples[Untouched + 1][0].X = Saved;
+   RequireSameAsRebuilt();
+
+   /** Inserts and removes at both ends and in the middle. */
+   for (std::size_t Idx : {std::size_t(0), std::size_t(1), std::size_t(3000), vP.size() - 1, vP.size()})
+   {
+      auto const P = fluffy::math3d::Point(Dist(Rng), Dist(Rng), Dist(Rng));
+      vP.insert(vP.begin() + std::ptrdiff_t(Idx), P);
+      REQUIRE(fluffy::splines::InsertCtrlPoint(Spline, Idx, P));
+   }
+   REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) > 0);
+   RequireSameAsRebuilt();
+
+   for (int Edit = 0; Edit < 5; ++Edit)
+   {
+      std::size_t const Idx[5] = {0, 1, 7000, vP.size() - 2, vP.size() - 1};
+      vP.erase(vP.begin() + std::ptrdiff_t(Idx[Edit]));
+      REQUIRE(fluffy::splines::RemoveCtrlPoint(Spline, Idx[Edit]));
+      REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) <= 4 * SAMPLES);
+   }
+   RequireSameAsRebuilt();
+
+   /** Segments listed by an edit move down when a later remove takes out a segment before them. */
+   vP.erase(vP.begin() + 5001);
+   vP.erase(vP.begin() + 5000);
+   REQUIRE(fluffy::splines::RemoveCtrlPoint(Spline, 5001));
+   REQUIRE(fluffy::splines::RemoveCtrlPoint(Spline, 5000));
+   REQUIRE(fluffy::splines::UpdateSamplesCatmullRom(Spline) <= 5 * SAMPLES);
+   RequireSameAsRebuilt();
+   REQUIRE_FALSE(fluffy::splines::SetCtrlPoint(Spline, vP.size(), {}));
+   REQUIRE_FALSE(fluffy::splines::InsertCtrlPoint(Spline, vP.size() + 1, {}));
+
+   /** Two points is the shortest spline. */
+   auto Short = fluffy::splines::InitCatmullRom({fluffy::math3d::Point(0, 0, 0), fluffy::math3d::Point(1, 0, 0)});
+   REQUIRE(fluffy::splines::InsertCtrlPoint(Short, 1, fluffy::math3d::Point(0.5, 1, 0)));
+   REQUIRE(Short.vMatSeg.size() == 2);
+   REQUIRE(fluffy::splines::RemoveCtrlPoint(Short, 0));
+   REQUIRE_FALSE(fluffy::splines::RemoveCtrlPoint(Short, 0));
+   REQUIRE(Short.vMatSeg.size() == 1);
+}
+
+TEST_CASE("splines", "[tessellate]")
+{
+   /**
+    * The forward differences give the points of the segment matrices, also where a segment
+    * starts between two samples.
+    */
+   auto const Spline = fluffy::splines::SplineTestCatmullRom();
+   auto const NumSegments = Spline.vMatSeg.size();
+   for (std::size_t Num : {std::size_t(1), std::size_t(7), std::size_t(10000)})
+   {
+      std::vector<fluffy::math3d::tup> vOut(Num);
+      fluffy::splines::TessellateCatmullRom(Spline, vOut);
+      for (std::size_t Idx = 0; Idx < Num; ++Idx)
+      {
+         auto const Seg = Idx * NumSegments / Num;
+         auto const u = fluffy::math3d::FLOAT(Idx * NumSegments) / fluffy::math3d::FLOAT(Num) - Seg;
+         auto const P = fluffy::math3d::MultSpline(u, Spline.vMatSeg[Seg]);
+         REQUIRE(std::abs(vOut[Idx].X - P.X) < 1e-9);
+         REQUIRE(std::abs(vOut[Idx].Y - P.Y) < 1e-9);
+         REQUIRE(std::abs(vOut[Idx].Z - P.Z) < 1e-9);
+         REQUIRE(vOut[Idx].W == 1);
+      }
+   }
+
+   /** Ten thousand samples with the per point evaluation and with the forward differences. */
+   std::vector<fluffy::math3d::tup> vOut(10000);
+   auto Start = std::chrono::steady_clock::now();
+   for (std::size_t Idx = 0; Idx < vOut.size(); ++Idx)
+   {
+      auto const t = fluffy::math3d::FLOAT(Idx) / fluffy::math3d::FLOAT(vOut.size());
+      vOut[Idx] = fluffy::splines::SplineValueCatmullRom(Spline, t).P;
+   }
+   auto const PerPoint = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+   Start = std::chrono::steady_clock::now();
+   fluffy::splines::TessellateCatmullRom(Spline, vOut);
+   auto const Forward = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+   INFO("SplineValueCatmullRom " << PerPoint << " us, TessellateCatmullRom " << Forward << " us");
+   REQUIRE(std::abs(vOut.back().X - Spline.CtrlPoints[Spline.CtrlPoints.size() - 2].X) < 1e-3);
+
+   std::vector<fluffy::math3d::tup> vEmpty(3, fluffy::math3d::Point(5, 5, 5));
+   fluffy::splines::TessellateCatmullRom(fluffy::splines::spline_catmull_rom{}, vEmpty);
+   REQUIRE(vEmpty[0].X == 5);
+}
+
 TEST_CASE("math3d", "[lerppoints]")
 {
    auto P0 = fluffy::math3d::Point(0, 0, 0);
@@ -679,3 +1110,341 @@ TEST_CASE("math3d", "[vectorfrompoints]")
    REQUIRE(MS == fluffy::math3d::FLOAT(3));
    REQUIRE(Mag == fluffy::math3d::FLOAT(std::sqrt(3)));
 }
+
+TEST_CASE("textbuffer", "[formatting]")
+{
+   fluffy::render::text_buffer Buffer{"t="};
+   fluffy::render::AppendFixed(Buffer, 0.5);
+   fluffy::render::Append(Buffer, " ");
+   fluffy::render::AppendInt(Buffer, -42);
+   fluffy::render::Append(Buffer, "fps");
+   REQUIRE(Buffer == "t=0.500000 -42fps");
+   REQUIRE(Buffer.size() == 17);
+
+   fluffy::render::Clear(Buffer);
+   REQUIRE(Buffer.empty() == true);
+   REQUIRE(Buffer.c_str()[0] == '\0');
+
+   fluffy::render::AppendFixed(Buffer, 1.23456, 2);
+   REQUIRE(Buffer == "1.23");
+
+   /**
+    * Text that does not fit is truncated and the buffer stays null terminated.
+    */
+   for (int Idx = 0; Idx < 100; ++Idx) fluffy::render::Append(Buffer, "ab");
+   REQUIRE(Buffer.size() == fluffy::render::text_buffer::CAPACITY);
+   REQUIRE(Buffer.c_str()[fluffy::render::text_buffer::CAPACITY] == '\0');
+}
+
+TEST_CASE("blend", "[blendpixel]")
+{
+   using fluffy::render::blend_mode;
+
+   REQUIRE(fluffy::render::BlendPixel(0x00123456, 0x00FF0000, blend_mode::OPAQUE) == 0x00FF0000);
+   REQUIRE(fluffy::render::BlendPixel(0x00123456, 0xFFFF0000, blend_mode::ALPHA) == 0x00FF0000);
+   REQUIRE(fluffy::render::BlendPixel(0x00123456, 0x00FF0000, blend_mode::ALPHA) == 0x00123456);
+   REQUIRE(fluffy::render::BlendPixel(0x00000000, 0x80FFFFFF, blend_mode::ALPHA) == 0x00808080);
+   REQUIRE(fluffy::render::BlendPixel(0xFF808080, 0xFFFFFFFF, blend_mode::ADDITIVE) == 0xFFFFFFFF);
+   REQUIRE(fluffy::render::BlendPixel(0x00101010, 0x80202020, blend_mode::ADDITIVE) == 0x00202020);
+}
+
+TEST_CASE("blend", "[blendspan]")
+{
+   using fluffy::render::blend_mode;
+
+   /**
+    * The SIMD spans must give the same pixels as the scalar BlendPixel, also for the tail.
+    */
+   std::vector<uint32_t> vDst(37);
+   std::vector<uint32_t> vSrc(37);
+   uint32_t Seed{12345};
+   auto Next = [&Seed]() -> uint32_t { return Seed = Seed * 1664525u + 1013904223u; };
+   for (size_t Idx = 0; Idx < vDst.size(); ++Idx)
+   {
+      vDst[Idx] = Next();
+      vSrc[Idx] = Next();
+   }
+
+   for (auto Blend : {blend_mode::OPAQUE, blend_mode::ALPHA, blend_mode::ADDITIVE})
+   {
+      auto vSpan = vDst;
+      fluffy::render::BlendSpan(vSpan.data(), vSrc.data(), vSpan.size(), Blend);
+      for (size_t Idx = 0; Idx < vDst.size(); ++Idx)
+      {
+         REQUIRE(vSpan[Idx] == fluffy::render::BlendPixel(vDst[Idx], vSrc[Idx], Blend));
+      }
+
+      vSpan = vDst;
+      fluffy::render::BlendSpan(vSpan.data(), vSpan.size(), 0x7F40C080, Blend);
+      for (size_t Idx = 0; Idx < vDst.size(); ++Idx)
+      {
+         REQUIRE(vSpan[Idx] == fluffy::render::BlendPixel(vDst[Idx], 0x7F40C080, Blend));
+      }
+   }
+}
+
+TEST_CASE("blend", "[lerpcolor]")
+{
+   REQUIRE(fluffy::render::LerpColor(0x00000000u, 0xFFFFFFFFu, 0.f) == 0x00000000u);
+   REQUIRE(fluffy::render::LerpColor(0x00000000u, 0xFFFFFFFFu, 1.f) == 0xFFFFFFFFu);
+   REQUIRE(fluffy::render::LerpColor(0x00FF0000u, 0x000000FFu, 0.5f) == 0x007F007Fu);
+   REQUIRE(fluffy::render::LerpColor(0x80102030u, 0x80102030u, 0.3f) == 0x80102030u);
+   REQUIRE(fluffy::render::LerpColor(0x00FF0000u, 0x000000FFu, 0.5) == 0x007F007Fu);
+   REQUIRE(fluffy::render::LerpColor8(0x00FF0000u, 0x000000FFu, 128) == 0x007F007Fu);
+
+   std::vector<uint32_t> vFrom{0x00000000, 0xFF000000, 0x00FFFFFF, 0x12345678};
+   std::vector<uint32_t> vTo{0xFFFFFFFF, 0x00000000, 0x00000000, 0x87654321};
+   std::vector<uint32_t> vOut(vFrom.size());
+   fluffy::render::LerpColor(vFrom.data(), vTo.data(), vOut.data(), vOut.size(), 0.25f);
+   for (std::size_t Idx = 0; Idx < vOut.size(); ++Idx)
+   {
+      REQUIRE(vOut[Idx] == fluffy::render::LerpColor(vFrom[Idx], vTo[Idx], 0.25f));
+   }
+   REQUIRE(vOut[0] == 0x3F3F3F3Fu);
+}
+
+TEST_CASE("pixelformat", "[encode]")
+{
+   using fluffy::render::pixel_format;
+   using rgb565 = fluffy::render::pixel_traits<pixel_format::RGB565>;
+   using index8 = fluffy::render::pixel_traits<pixel_format::INDEX8>;
+
+   REQUIRE(rgb565::Encode(0x00FFFFFF) == 0xFFFF);
+   REQUIRE(rgb565::Encode(0x00FF0000) == 0xF800);
+   REQUIRE(rgb565::Decode(0xFFFF) == 0x00FFFFFF);
+   REQUIRE(rgb565::Decode(rgb565::Encode(0x00108420)) == 0x00108621);
+
+   REQUIRE(index8::Encode(0x00FFFFFF) == 0xFF);
+   REQUIRE(index8::Encode(0x0000FF00) == 0x1C);
+   for (int Idx = 0; Idx < 256; ++Idx)
+   {
+      REQUIRE(index8::Encode(fluffy::render::Palette332(uint8_t(Idx))) == Idx);
+   }
+}
+
+TEST_CASE("pixelformat", "[writespan]")
+{
+   using fluffy::render::blend_mode;
+   using fluffy::render::pixel_format;
+   using rgb565 = fluffy::render::pixel_traits<pixel_format::RGB565>;
+
+   std::vector<uint16_t> vSpan(9, rgb565::Encode(0x00000000));
+   fluffy::render::WriteSpanAs<pixel_format::RGB565>(vSpan.data(), vSpan.size(), 0x80FFFFFF, blend_mode::ALPHA);
+   for (auto Pixel : vSpan)
+   {
+      REQUIRE(Pixel == rgb565::Encode(fluffy::render::BlendPixel(0x00000000, 0x80FFFFFF, blend_mode::ALPHA)));
+   }
+
+   std::vector<uint32_t> vSpan32(9, 0x00102030);
+   fluffy::render::WriteSpanAs<pixel_format::ARGB8888>(vSpan32.data(), vSpan32.size(), 0x40FF0000, blend_mode::ALPHA);
+   REQUIRE(vSpan32[8] == fluffy::render::BlendPixel(0x00102030, 0x40FF0000, blend_mode::ALPHA));
+}
+
+TEST_CASE("framepipeline", "[snapshots]")
+{
+   struct snapshot
+   {
+      int Frame{};
+      int Copy[64]{};
+   };
+
+   fluffy::pipeline::frame_pipeline<snapshot> Pipeline{};
+   int Frame{};
+   fluffy::pipeline::StartPipeline(Pipeline,
+                                   [&Frame](snapshot &Next)
+                                   {
+                                      ++Frame;
+                                      Next.Frame = Frame;
+                                      for (auto &Value : Next.Copy) Value = Frame;
+                                   });
+
+   /**
+    * Every frame arrives once and in order, and is not touched while it is held.
+    */
+   for (int Expected = 1; Expected <= 200; ++Expected)
+   {
+      auto const *ptrSnapshot = fluffy::pipeline::AcquireFrame(Pipeline);
+      REQUIRE(ptrSnapshot != nullptr);
+      REQUIRE(ptrSnapshot->Frame == Expected);
+      std::this_thread::yield();
+      auto const Intact = std::all_of(std::begin(ptrSnapshot->Copy), std::end(ptrSnapshot->Copy),
+                                      [Expected](int Value) { return Value == Expected; });
+      REQUIRE(Intact);
+   }
+
+   fluffy::pipeline::StopPipeline(Pipeline);
+   REQUIRE(fluffy::pipeline::AcquireFrame(Pipeline) == nullptr);
+   REQUIRE(Pipeline.Frame == 200);
+}
+
+TEST_CASE("framescheduler", "[pacing]")
+{
+   fluffy::timing::frame_scheduler Scheduler{};
+   fluffy::timing::InitFrameScheduler(Scheduler, 500);
+   REQUIRE(Scheduler.PeriodNS == 2000000);
+
+   /**
+    * The deadlines are on a fixed grid, so 25 frames take 25 periods and never end early.
+    * Catching up is allowed here, so a busy machine does not make the test drop frames.
+    */
+   Scheduler.MaxCatchUp = 1000;
+   auto const Begin = fluffy::timing::NowNS();
+   for (int Idx = 0; Idx < 25; ++Idx)
+   {
+      REQUIRE(fluffy::timing::WaitForNextFrame(Scheduler) >= 0);
+   }
+   REQUIRE(fluffy::timing::NowNS() - Begin >= 25 * Scheduler.PeriodNS);
+   REQUIRE(Scheduler.NumFrames == 25);
+   REQUIRE(Scheduler.NumDropped == 0);
+
+   /**
+    * A frame that is far too late drops the missed deadlines instead of bursting.
+    */
+   Scheduler.MaxCatchUp = 2;
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   REQUIRE(fluffy::timing::WaitForNextFrame(Scheduler) >= 2 * Scheduler.PeriodNS);
+   REQUIRE(Scheduler.NumDropped >= 8);
+   REQUIRE(Scheduler.NextDeadlineNS + Scheduler.PeriodNS > fluffy::timing::NowNS());
+
+   REQUIRE(fluffy::timing::LatenessPercentileNS(Scheduler, 100) == Scheduler.MaxLatenessNS);
+   REQUIRE(fluffy::timing::LatenessPercentileNS(Scheduler, 0) <= fluffy::timing::LatenessPercentileNS(Scheduler, 50));
+}
+
+TEST_CASE("frameprofiler", "[zones]")
+{
+   static fluffy::timing::frame_profiler Profiler{};
+   fluffy::timing::SetZoneName(Profiler, 0, "draw");
+   fluffy::timing::SetZoneName(Profiler, 1, "present");
+
+   /**
+    * Zone 0 is entered twice per frame, so the per frame time is the sum of both samples.
+    */
+   for (std::int64_t Frame = 1; Frame <= 100; ++Frame)
+   {
+      fluffy::timing::BeginProfilerFrame(Profiler);
+      fluffy::timing::RecordSample(Profiler, 0, 0, Frame * 10);
+      fluffy::timing::RecordSample(Profiler, 0, 0, Frame * 10);
+      fluffy::timing::RecordSample(Profiler, 1, 0, 5);
+   }
+   fluffy::timing::BeginProfilerFrame(Profiler);
+   fluffy::timing::RecordSample(Profiler, 0, 0, 1000000);  // The current frame is not complete.
+
+   REQUIRE(fluffy::timing::ZoneLastFrameNS(Profiler, 0) == 2000);
+   REQUIRE(fluffy::timing::ZoneLastFrameNS(Profiler, 1) == 5);
+   REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, 0, 0) == 20);
+   REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, 0, 50) == 1020);
+   REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, 0, 100) == 2000);
+   REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, 1, 99) == 5);
+   REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, 2, 99) == 0);
+
+   /**
+    * Wrap the ring buffer from two threads at once. Only the newest samples are kept.
+    */
+   {
+      auto Record = [](std::uint32_t Zone)
+      {
+         for (std::size_t Idx = 0; Idx < fluffy::timing::frame_profiler::CAPACITY; ++Idx)
+         {
+            fluffy::timing::profile_zone Scope(Profiler, Zone);
+         }
+      };
+      std::thread Other(Record, 1);
+      Record(0);
+      Other.join();
+   }
+   fluffy::timing::BeginProfilerFrame(Profiler);
+   REQUIRE(Profiler.Head == 301 + 2 * fluffy::timing::frame_profiler::CAPACITY);
+
+   /**
+    * All the samples left are from the last frame. How they are split between the two zones
+    * depends on how the threads were scheduled.
+    */
+   REQUIRE(fluffy::timing::ZoneLastFrameNS(Profiler, 0) + fluffy::timing::ZoneLastFrameNS(Profiler, 1) > 0);
+   for (std::uint32_t Zone = 0; Zone < 2; ++Zone)
+   {
+      auto const LastFrameNS = fluffy::timing::ZoneLastFrameNS(Profiler, Zone);
+      REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, Zone, 0) == LastFrameNS);
+      REQUIRE(fluffy::timing::ZonePercentileNS(Profiler, Zone, 100) == LastFrameNS);
+   }
+   REQUIRE(fluffy::timing::WriteProfileCSV(Profiler, "frameprofiler_test.csv"));
+   std::remove("frameprofiler_test.csv");
+}
+
+TEST_CASE("framecapture", "[ppm][y4m]")
+{
+   auto ReadFile = [](char const* FileName) -> std::vector<std::uint8_t>
+   {
+      std::vector<std::uint8_t> vBytes{};
+      if (auto* fp = std::fopen(FileName, "rb"))
+      {
+         for (int C = std::fgetc(fp); C != EOF; C = std::fgetc(fp)) vBytes.push_back(std::uint8_t(C));
+         std::fclose(fp);
+      }
+      return vBytes;
+   };
+
+   /**
+    * Two rows of two RGB565 pixels with padding at the end of the rows.
+    */
+   std::uint16_t const Pixels[] = {0xF800, 0x07E0, 0xDEAD, 0x001F, 0xFFFF, 0xDEAD};
+   constexpr int PITCH = 3 * sizeof(std::uint16_t);
+
+   {
+      fluffy::capture::frame_capture Capture{};
+      REQUIRE(fluffy::capture::StartCapture(Capture, fluffy::capture::capture_format::PPM, "capture_test_", 2, 2, 60));
+      REQUIRE(fluffy::capture::CaptureFrame(Capture, Pixels, PITCH, fluffy::render::pixel_format::RGB565, 2, 2));
+      REQUIRE_FALSE(fluffy::capture::CaptureFrame(Capture, Pixels, PITCH, fluffy::render::pixel_format::RGB565, 3, 2));
+      fluffy::capture::StopCapture(Capture);
+      REQUIRE(Capture.NumWritten == 1);
+      REQUIRE(Capture.NumDropped == 0);
+      REQUIRE(Capture.NumRejected == 1);
+   }
+
+   auto const vPPM = ReadFile("capture_test_000000.ppm");
+   std::vector<std::uint8_t> const vExpected = {'P', '6', '\n', '2', ' ', '2', '\n', '2', '5', '5', '\n',  //
+                                                0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+   REQUIRE(vPPM == vExpected);
+   std::remove("capture_test_000000.ppm");
+
+   /**
+    * Y4M is one stream with a header and a FRAME marker followed by the Y, U and V planes.
+    */
+   {
+      fluffy::capture::frame_capture Capture{};
+      auto const Format = fluffy::capture::capture_format::Y4M;
+      REQUIRE(fluffy::capture::StartCapture(Capture, Format, "capture_test.y4m", 2, 2, 30));
+      for (int Idx = 0; Idx < 3; ++Idx)
+      {
+         while (!fluffy::capture::CaptureFrame(Capture, Pixels, PITCH, fluffy::render::pixel_format::RGB565, 2, 2))
+         {
+            std::this_thread::yield();
+         }
+      }
+   }
+
+   auto const vY4M = ReadFile("capture_test.y4m");
+   std::string const Header = "YUV4MPEG2 W2 H2 F30:1 Ip A1:1 C444 XCOLORRANGE=FULL\nFRAME\n";
+   REQUIRE(vY4M.size() == Header.size() + 3 * (12 + 6) - 6);
+   REQUIRE(std::string(vY4M.begin(), vY4M.begin() + Header.size()) == Header);
+
+   auto const* ptrY = vY4M.data() + Header.size();
+   REQUIRE(int(ptrY[0]) == 77);   // Red.
+   REQUIRE(int(ptrY[1]) == 149);  // Green.
+   REQUIRE(int(ptrY[2]) == 29);   // Blue.
+   REQUIRE(int(ptrY[3]) == 255);  // White.
+   REQUIRE(int(ptrY[4 + 3]) == 128);
+   REQUIRE(int(ptrY[8 + 3]) == 128);
+
+   /**
+    * Saturated red and blue must clamp to 255 in V and U, not wrap to 0.
+    */
+   auto const* ptrU = ptrY + 4;
+   auto const* ptrV = ptrY + 8;
+   REQUIRE(int(ptrU[0]) == 85);   // Red.
+   REQUIRE(int(ptrV[0]) == 255);  // Red.
+   REQUIRE(int(ptrU[1]) == 43);   // Green.
+   REQUIRE(int(ptrV[1]) == 21);   // Green.
+   REQUIRE(int(ptrU[2]) == 255);  // Blue.
+   REQUIRE(int(ptrV[2]) == 107);  // Blue.
+   std::remove("capture_test.y4m");
+}
@@ -0,0 +1,98 @@
+#ifndef TESTS_TESTMESHES_HPP_9124B7E9_AAE5_4FAE_AECD_5230D05B6B48
+#define TESTS_TESTMESHES_HPP_9124B7E9_AAE5_4FAE_AECD_5230D05B6B48
+
+/**
+ * Meshes shared by the tests.
+ *
+ * License : MIT. See bottom of file.
+ * Copyright : Willy Clarke.
+ */
+
+#include <cstdint>
+
+#include "../src/lib/mesh.hpp"
+
+namespace testmeshes
+{
+/**
+ * Add Num x Num vertices at Position(Col, Row), row by row, and two triangles per cell.
+ * Cell I is split into I, I + 1, I + Num + 1 and I, I + Num + 1, I + Num.
+ */
+template <typename POSITION>
+auto AddGrid(fluffy::render::mesh& Mesh,                    //!<
+             uint32_t Num,                                  //!<
+             POSITION&& Position,                           //!< (uint32_t Col, uint32_t Row) -> tup.
+             fluffy::math3d::tup const& Col = {1, 1, 1, 0}  //!<
+             )                                              //!<
+    -> void
+{
+   auto const First = static_cast<uint32_t>(fluffy::render::NumVertices(Mesh));
+   for (uint32_t Row = 0; Row < Num; ++Row)
+   {
+      for (uint32_t Column = 0; Column < Num; ++Column)
+      {
+         fluffy::render::AddVertex(Mesh, Position(Column, Row), Col);
+      }
+   }
+   for (uint32_t Row = 0; Row + 1 < Num; ++Row)
+   {
+      for (uint32_t Column = 0; Column + 1 < Num; ++Column)
+      {
+         auto const I = First + Row * Num + Column;
+         fluffy::render::AddTriangle(Mesh, I, I + 1, I + Num + 1);
+         fluffy::render::AddTriangle(Mesh, I, I + Num + 1, I + Num);
+      }
+   }
+}
+
+/**
+ * Add a closed box with sides of 2 * Half around Center, with shared corners numbered and
+ * wound as the cube in the wireframe app. Corner Idx is at +X when Idx & 1, -Y when Idx & 2
+ * and +Z when Idx & 4.
+ */
+inline auto AddBox(fluffy::render::mesh& Mesh,                    //!<
+                   fluffy::math3d::tup const& Center,             //!<
+                   fluffy::math3d::FLOAT Half,                    //!<
+                   fluffy::math3d::tup const& Col = {1, 1, 1, 0}  //!<
+                   )                                              //!<
+    -> void
+{
+   auto const First = static_cast<uint32_t>(fluffy::render::NumVertices(Mesh));
+   for (int Idx = 0; Idx < 8; ++Idx)
+   {
+      auto const P = fluffy::math3d::Point(Center.X + ((Idx & 1) ? Half : -Half),
+                                           Center.Y + ((Idx & 2) ? -Half : Half),
+                                           Center.Z + ((Idx & 4) ? Half : -Half));
+      fluffy::render::AddVertex(Mesh, P, Col);
+   }
+   static constexpr uint32_t Faces[6][4] = {
+       {0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5},
+   };
+   for (auto const& Face : Faces)
+   {
+      fluffy::render::AddTriangle(Mesh, First + Face[0], First + Face[1], First + Face[2]);
+      fluffy::render::AddTriangle(Mesh, First + Face[0], First + Face[2], First + Face[3]);
+   }
+}
+};  // end of namespace testmeshes
+#endif
+
+/**
+* The MIT License (MIT)
+Copyright © 2023 <copyright holders>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the “Software”), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+Ref: https://mit-license.org
+*/